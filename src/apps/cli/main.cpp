@@ -453,6 +453,10 @@ static int cmd_exec(const SCL::ParseResult &result) {
     }
     auto driver = inferenceReg->driver();
 
+    // Preload the models of the singers as soon as the package is ready, the inferences below
+    // are initialized with the same session args
+    inferenceReg->setAutoPreload(true);
+
     // Load package
     DS::LibrarySpec *lib;
 
@@ -1,5 +1,6 @@
 #include "inferenceregistry.h"
 
+#include <algorithm>
 #include <list>
 #include <mutex>
 #include <unordered_map>
@@ -24,6 +25,9 @@ namespace dsinfer {
 
         InferenceDriver *driver = nullptr;
         std::unordered_map<std::string, InferenceInterpreter *> interpreters;
+
+        bool autoPreload = false;
+        JsonValue preloadArgs;
     };
 
     InferenceRegistry::~InferenceRegistry() = default;
@@ -77,6 +81,62 @@ namespace dsinfer {
         return impl.driver;
     }
 
+    bool InferenceRegistry::preload(const SingerSpec *singer, const JsonValue &args,
+                                    Error *error) {
+        auto driver = this->driver();
+        if (!driver) {
+            if (error) {
+                *error = {
+                    Error::LibraryNotFound,
+                    "inference driver is not set up",
+                };
+            }
+            return false;
+        }
+
+        // Collect the models of the imported inferences, each once
+        std::vector<std::filesystem::path> paths;
+        for (const auto &imp : std::as_const(singer->imports())) {
+            auto inferences = findInferences(imp.inference);
+            if (inferences.empty()) {
+                continue;
+            }
+            auto spec = inferences.front();
+            auto interp = static_cast<InferenceSpec::Impl *>(spec->_impl.get())->interp;
+            if (!interp) {
+                continue;
+            }
+            for (auto &path : interp->models(spec)) {
+                if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+                    paths.push_back(std::move(path));
+                }
+            }
+        }
+        if (paths.empty()) {
+            return true;
+        }
+        return driver->preload(paths, args, error);
+    }
+
+    void InferenceRegistry::setAutoPreload(bool enabled, const JsonValue &args) {
+        __stdc_impl_t;
+        std::unique_lock<std::shared_mutex> lock(impl.env_mtx());
+        impl.autoPreload = enabled;
+        impl.preloadArgs = args;
+    }
+
+    bool InferenceRegistry::autoPreload() const {
+        __stdc_impl_t;
+        std::shared_lock<std::shared_mutex> lock(impl.env_mtx());
+        return impl.autoPreload;
+    }
+
+    JsonValue InferenceRegistry::autoPreloadArgs() const {
+        __stdc_impl_t;
+        std::shared_lock<std::shared_mutex> lock(impl.env_mtx());
+        return impl.preloadArgs;
+    }
+
     std::string InferenceRegistry::specKey() const {
         static std::string _key("inferences");
         return _key;
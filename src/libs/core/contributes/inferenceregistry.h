@@ -4,6 +4,7 @@
 #include <dsinfer/contributeregistry.h>
 #include <dsinfer/inferencedriver.h>
 #include <dsinfer/inferencespec.h>
+#include <dsinfer/singerspec.h>
 
 namespace dsinfer {
 
@@ -19,6 +20,17 @@ namespace dsinfer {
 
         InferenceDriver *driver() const;
 
+    public:
+        // Starts loading the models of the inferences imported by `singer` in the background,
+        // for the sessions the inferences later open with `args`
+        bool preload(const SingerSpec *singer, const JsonValue &args, Error *error);
+
+        // Preloads every singer as soon as its library is ready, which requires the driver to
+        // be set up before the library is opened
+        void setAutoPreload(bool enabled, const JsonValue &args = {});
+        bool autoPreload() const;
+        JsonValue autoPreloadArgs() const;
+
     protected:
         std::string specKey() const override;
         ContributeSpec *parseSpec(const std::filesystem::path &basePath, const JsonValue &config,
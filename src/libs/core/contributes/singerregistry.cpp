@@ -111,6 +111,12 @@ namespace dsinfer {
                         return false;
                     }
                 }
+
+                // Preload the models, a failure shows up again when the inferences initialize
+                if (inferenceReg->autoPreload()) {
+                    std::ignore =
+                        inferenceReg->preload(singerSpec, inferenceReg->autoPreloadArgs(), nullptr);
+                }
                 return true;
             }
             case ContributeSpec::Finished: {
@@ -0,0 +1,268 @@
+#include "jsonstreamreader.h"
+
+#include <cctype>
+
+namespace dsinfer {
+
+    class JsonStreamReader::Impl {
+    public:
+        enum State {
+            Start,
+            InArray,
+            End,
+            Failed,
+        };
+
+        explicit Impl(std::istream &stream, std::string key)
+            : buf(stream.rdbuf()), key(std::move(key)) {
+        }
+
+        int peek() {
+            return buf ? buf->sgetc() : std::char_traits<char>::eof();
+        }
+
+        int get() {
+            return buf ? buf->sbumpc() : std::char_traits<char>::eof();
+        }
+
+        int skipSpace() {
+            int c;
+            while ((c = peek()) != std::char_traits<char>::eof() && std::isspace(c)) {
+                buf->sbumpc();
+            }
+            return c;
+        }
+
+        bool expect(char expected) {
+            if (skipSpace() != expected) {
+                return fail(std::string("expected '") + expected + "'");
+            }
+            get();
+            return true;
+        }
+
+        bool fail(const std::string &message) {
+            state = Failed;
+            error = Error(Error::InvalidFormat, "Invalid JSON stream at element " +
+                                                    std::to_string(count) + ": " + message);
+            return false;
+        }
+
+        // Consumes a string whose opening quote has been read
+        bool scanString(std::string *out) {
+            while (true) {
+                int c = get();
+                if (c == std::char_traits<char>::eof()) {
+                    return fail("unterminated string");
+                }
+                if (out) {
+                    out->push_back(char(c));
+                }
+                if (c == '"') {
+                    return true;
+                }
+                if (c == '\\') {
+                    c = get();
+                    if (c == std::char_traits<char>::eof()) {
+                        return fail("unterminated string");
+                    }
+                    if (out) {
+                        out->push_back(char(c));
+                    }
+                }
+            }
+        }
+
+        // Consumes one value without interpreting it, its text is appended to `out` if given
+        bool scanValue(std::string *out) {
+            int depth = 0;
+            int c = skipSpace();
+            do {
+                if (c == std::char_traits<char>::eof()) {
+                    return fail("unexpected end of input");
+                }
+                switch (c) {
+                    case '"':
+                        get();
+                        if (out) {
+                            out->push_back('"');
+                        }
+                        if (!scanString(out)) {
+                            return false;
+                        }
+                        break;
+                    case '[':
+                    case '{':
+                        get();
+                        if (out) {
+                            out->push_back(char(c));
+                        }
+                        depth++;
+                        break;
+                    case ']':
+                    case '}':
+                        if (depth == 0) {
+                            return fail("unexpected '" + std::string(1, char(c)) + "'");
+                        }
+                        get();
+                        if (out) {
+                            out->push_back(char(c));
+                        }
+                        depth--;
+                        break;
+                    case ',':
+                        if (depth == 0) {
+                            return fail("unexpected ','");
+                        }
+                        get();
+                        if (out) {
+                            out->push_back(',');
+                        }
+                        break;
+                    default:
+                        // Scalars end at a delimiter, which is left in the stream
+                        get();
+                        if (out) {
+                            out->push_back(char(c));
+                        }
+                        if (depth == 0) {
+                            while ((c = peek()) != std::char_traits<char>::eof() &&
+                                   !std::isspace(c) && c != ',' && c != ']' && c != '}') {
+                                get();
+                                if (out) {
+                                    out->push_back(char(c));
+                                }
+                            }
+                        }
+                        break;
+                }
+                c = depth > 0 ? peek() : 0;
+            } while (depth > 0);
+            return true;
+        }
+
+        // Positions the stream after the opening bracket of the array
+        bool start() {
+            int c = skipSpace();
+            if (c == '[') {
+                get();
+                state = InArray;
+                return true;
+            }
+            if (c != '{' || key.empty()) {
+                return fail("document is not an array");
+            }
+            get();
+            if (skipSpace() == '}') {
+                return fail("missing key \"" + key + "\"");
+            }
+            std::string name;
+            while (true) {
+                if (!expect('"')) {
+                    return false;
+                }
+                name = "\"";
+                if (!scanString(&name)) {
+                    return false;
+                }
+                if (!expect(':')) {
+                    return false;
+                }
+                std::string errMsg;
+                auto nameValue = JsonValue::fromJson(name, false, &errMsg);
+                if (!errMsg.empty()) {
+                    return fail(errMsg);
+                }
+                if (nameValue.toString() == key) {
+                    if (!expect('[')) {
+                        return false;
+                    }
+                    state = InArray;
+                    return true;
+                }
+                if (!scanValue(nullptr)) {
+                    return false;
+                }
+                c = skipSpace();
+                get();
+                if (c == '}') {
+                    return fail("missing key \"" + key + "\"");
+                }
+                if (c != ',') {
+                    return fail("expected ',' or '}'");
+                }
+            }
+        }
+
+        std::streambuf *buf;
+        std::string key;
+        State state = Start;
+        size_t count = 0;
+        Error error;
+        std::string text;
+    };
+
+    JsonStreamReader::JsonStreamReader(std::istream &stream, const std::string &key)
+        : _impl(std::make_unique<Impl>(stream, key)) {
+    }
+
+    JsonStreamReader::~JsonStreamReader() = default;
+
+    bool JsonStreamReader::readNext(JsonValue &value, Error *error) {
+        __stdc_impl_t;
+        if (impl.state == Impl::Start && !impl.start()) {
+            if (error) {
+                *error = impl.error;
+            }
+            return false;
+        }
+        if (impl.state == Impl::InArray) {
+            int c = impl.skipSpace();
+            if (impl.count > 0) {
+                impl.get();
+                if (c == ']') {
+                    impl.state = Impl::End;
+                    return false;
+                }
+                if (c != ',') {
+                    impl.fail("expected ',' or ']'");
+                }
+            } else if (c == ']') {
+                impl.get();
+                impl.state = Impl::End;
+                return false;
+            }
+        }
+        if (impl.state != Impl::InArray) {
+            if (error && impl.state == Impl::Failed) {
+                *error = impl.error;
+            }
+            return false;
+        }
+
+        impl.text.clear();
+        if (!impl.scanValue(&impl.text)) {
+            if (error) {
+                *error = impl.error;
+            }
+            return false;
+        }
+        std::string errMsg;
+        value = JsonValue::fromJson(impl.text, false, &errMsg);
+        if (!errMsg.empty()) {
+            impl.fail(errMsg);
+            if (error) {
+                *error = impl.error;
+            }
+            return false;
+        }
+        impl.count++;
+        return true;
+    }
+
+    size_t JsonStreamReader::index() const {
+        __stdc_impl_t;
+        return impl.count;
+    }
+
+}
@@ -0,0 +1,40 @@
+#ifndef JSONSTREAMREADER_H
+#define JSONSTREAMREADER_H
+
+#include <istream>
+
+#include <dsinfer/error.h>
+#include <dsinfer/jsonvalue.h>
+
+namespace dsinfer {
+
+    /**
+     * @brief Reads the elements of a JSON array from a stream one at a time.
+     *
+     * The array is either the top level value of the document, or the value of \a key in the top
+     * level object. Only the text of the element being read is buffered, so the memory used does
+     * not depend on the length of the array, and no input after the current element is consumed.
+     */
+    class DSINFER_EXPORT JsonStreamReader {
+    public:
+        explicit JsonStreamReader(std::istream &stream, const std::string &key = {});
+        ~JsonStreamReader();
+
+    public:
+        // Returns false at the end of the array or when the input is invalid, in which case
+        // error is set and every later call fails as well
+        bool readNext(JsonValue &value, Error *error = nullptr);
+
+        // Number of elements read so far
+        size_t index() const;
+
+    protected:
+        class Impl;
+        std::unique_ptr<Impl> _impl;
+
+        STDCORELIB_DISABLE_COPY(JsonStreamReader)
+    };
+
+}
+
+#endif // JSONSTREAMREADER_H
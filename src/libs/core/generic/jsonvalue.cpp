@@ -1,20 +1,1176 @@
 #include "jsonvalue.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+
 #include <nlohmann/json.hpp>
 
+#ifdef DSINFER_JSON_SIMDJSON
+#  include <simdjson.h>
+#endif
+
 namespace dsinfer {
 
+    JsonBinary::JsonBinary() : _ptr(nullptr), _size(0) {
+    }
+
+    JsonBinary::JsonBinary(const uint8_t *data, size_t size) : JsonBinary(std::vector<uint8_t>(data, data + size)) {
+    }
+
+    JsonBinary::JsonBinary(std::vector<uint8_t> &&bytes) {
+        auto buffer = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+        _ptr = buffer->data();
+        _size = buffer->size();
+        _owner = std::move(buffer);
+    }
+
+    JsonBinary::JsonBinary(std::shared_ptr<const void> owner, const uint8_t *data, size_t size)
+        : _owner(std::move(owner)), _ptr(data), _size(size) {
+    }
+
+    JsonBinary::~JsonBinary() = default;
+
+    JsonBinary::JsonBinary(const JsonBinary &other) = default;
+
+    JsonBinary &JsonBinary::operator=(const JsonBinary &other) = default;
+
+    JsonBinary::JsonBinary(JsonBinary &&other) noexcept
+        : _owner(std::move(other._owner)), _ptr(other._ptr), _size(other._size) {
+        other._ptr = nullptr;
+        other._size = 0;
+    }
+
+    JsonBinary &JsonBinary::operator=(JsonBinary &&other) noexcept {
+        _owner = std::move(other._owner);
+        _ptr = other._ptr;
+        _size = other._size;
+        other._ptr = nullptr;
+        other._size = 0;
+        return *this;
+    }
+
+    std::vector<uint8_t> JsonBinary::toVector() const {
+        return {begin(), end()};
+    }
+
+    template <class T>
+    static inline JsonBinary adoptVector(std::vector<T> &&data) {
+        auto buffer = std::make_shared<std::vector<T>>(std::move(data));
+        auto ptr = reinterpret_cast<const uint8_t *>(buffer->data());
+        auto size = buffer->size() * sizeof(T);
+        return {std::move(buffer), ptr, size};
+    }
+
+    template <class T>
+    static inline T readElement(const uint8_t *data, size_t i) {
+        T value;
+        std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    JsonTypedArray::JsonTypedArray() : _type(Float64) {
+    }
+
+    JsonTypedArray::JsonTypedArray(ElementType type, const JsonBinary &data) : _type(type), _data(data) {
+    }
+
+    JsonTypedArray::JsonTypedArray(const float *data, size_t size)
+        : _type(Float32), _data(reinterpret_cast<const uint8_t *>(data), size * sizeof(float)) {
+    }
+
+    JsonTypedArray::JsonTypedArray(const double *data, size_t size)
+        : _type(Float64), _data(reinterpret_cast<const uint8_t *>(data), size * sizeof(double)) {
+    }
+
+    JsonTypedArray::JsonTypedArray(const int64_t *data, size_t size)
+        : _type(Int64), _data(reinterpret_cast<const uint8_t *>(data), size * sizeof(int64_t)) {
+    }
+
+    JsonTypedArray::JsonTypedArray(const bool *data, size_t size) : _type(Bool) {
+        std::vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = data[i] ? 1 : 0;
+        }
+        _data = JsonBinary(std::move(bytes));
+    }
+
+    JsonTypedArray::JsonTypedArray(std::vector<float> &&data) : _type(Float32), _data(adoptVector(std::move(data))) {
+    }
+
+    JsonTypedArray::JsonTypedArray(std::vector<double> &&data) : _type(Float64), _data(adoptVector(std::move(data))) {
+    }
+
+    JsonTypedArray::JsonTypedArray(std::vector<int64_t> &&data) : _type(Int64), _data(adoptVector(std::move(data))) {
+    }
+
+    JsonTypedArray::~JsonTypedArray() = default;
+
+    JsonTypedArray::JsonTypedArray(const JsonTypedArray &other) = default;
+
+    JsonTypedArray &JsonTypedArray::operator=(const JsonTypedArray &other) = default;
+
+    JsonTypedArray::JsonTypedArray(JsonTypedArray &&other) noexcept = default;
+
+    JsonTypedArray &JsonTypedArray::operator=(JsonTypedArray &&other) noexcept = default;
+
+    size_t JsonTypedArray::elementSize(ElementType type) {
+        switch (type) {
+            case Float32:
+                return sizeof(float);
+            case Float64:
+                return sizeof(double);
+            case Int64:
+                return sizeof(int64_t);
+            case Bool:
+                return sizeof(uint8_t);
+        }
+        return 1;
+    }
+
+    double JsonTypedArray::toDouble(size_t i) const {
+        switch (_type) {
+            case Float32:
+                return readElement<float>(_data.data(), i);
+            case Float64:
+                return readElement<double>(_data.data(), i);
+            case Int64:
+                return double(readElement<int64_t>(_data.data(), i));
+            case Bool:
+                return _data.data()[i] ? 1 : 0;
+        }
+        return 0;
+    }
+
+    int64_t JsonTypedArray::toInt64(size_t i) const {
+        switch (_type) {
+            case Float32:
+                return int64_t(readElement<float>(_data.data(), i));
+            case Float64:
+                return int64_t(readElement<double>(_data.data(), i));
+            case Int64:
+                return readElement<int64_t>(_data.data(), i);
+            case Bool:
+                return _data.data()[i] ? 1 : 0;
+        }
+        return 0;
+    }
+
+    bool JsonTypedArray::toBool(size_t i) const {
+        switch (_type) {
+            case Float32:
+            case Float64:
+                return toDouble(i) != 0;
+            case Int64:
+                return toInt64(i) != 0;
+            case Bool:
+                return _data.data()[i] != 0;
+        }
+        return false;
+    }
+
+    class JsonArena::Impl {
+    public:
+        explicit Impl(size_t blockSize) : blockSize(blockSize) {
+        }
+
+        ~Impl() {
+            for (auto block : blocks) {
+                ::operator delete(block);
+            }
+        }
+
+        // Requests larger than a quarter block are left to the heap
+        char *allocate(size_t size) {
+            if (size > blockSize / 4) {
+                return nullptr;
+            }
+            if (size_t(end - current) < size) {
+                current = static_cast<char *>(::operator new(blockSize));
+                end = current + blockSize;
+                blocks.push_back(current);
+                stats.blocks++;
+            }
+            auto result = current;
+            current += size;
+            stats.allocations++;
+            stats.bytes += size;
+            refs.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+
+        void release() {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+        // Held by the scope and by every allocation that has not been freed yet
+        std::atomic<size_t> refs = 1;
+        size_t blockSize;
+        std::vector<char *> blocks;
+        char *current = nullptr;
+        char *end = nullptr;
+        Impl *previous = nullptr;
+        Statistics stats;
+
+        static thread_local Impl *threadArena;
+    };
+
+    thread_local JsonArena::Impl *JsonArena::Impl::threadArena = nullptr;
+
+    JsonArena::JsonArena(size_t blockSize) : _impl(new Impl(blockSize)) {
+        _impl->previous = Impl::threadArena;
+        Impl::threadArena = _impl;
+    }
+
+    JsonArena::~JsonArena() {
+        Impl::threadArena = _impl->previous;
+        _impl->release();
+    }
+
+    JsonArena::Statistics JsonArena::statistics() const {
+        return _impl->stats;
+    }
+
+    // Allocator of the JSON tree. Storage comes from the innermost JsonArena of the calling thread
+    // or from the heap, a header in front of it records which one so that any instance on any
+    // thread can free it.
+    template <class T>
+    class JsonAllocator {
+    public:
+        using value_type = T;
+
+        JsonAllocator() noexcept = default;
+        template <class U>
+        JsonAllocator(const JsonAllocator<U> &) noexcept {
+        }
+
+        T *allocate(size_t n) {
+            static_assert(alignof(T) <= HeaderSize, "over-aligned type");
+            if (n > (std::numeric_limits<size_t>::max() - 2 * HeaderSize) / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            auto size = (n * sizeof(T) + 2 * HeaderSize - 1) / HeaderSize * HeaderSize;
+            auto arena = JsonArena::Impl::threadArena;
+            char *block = arena ? arena->allocate(size) : nullptr;
+            if (!block) {
+                arena = nullptr;
+                block = static_cast<char *>(::operator new(size));
+            }
+            *reinterpret_cast<JsonArena::Impl **>(block) = arena;
+            return reinterpret_cast<T *>(block + HeaderSize);
+        }
+
+        void deallocate(T *p, size_t) noexcept {
+            auto block = reinterpret_cast<char *>(p) - HeaderSize;
+            if (auto arena = *reinterpret_cast<JsonArena::Impl **>(block)) {
+                arena->release();
+            } else {
+                ::operator delete(block);
+            }
+        }
+
+        template <class U>
+        bool operator==(const JsonAllocator<U> &) const noexcept {
+            return true;
+        }
+        template <class U>
+        bool operator!=(const JsonAllocator<U> &) const noexcept {
+            return false;
+        }
+
+    private:
+        static constexpr size_t HeaderSize = alignof(std::max_align_t);
+    };
+
+    // Binary type of the JSON tree: a JsonBinary with the container interface that
+    // nlohmann::basic_json requires. The binary readers append byte by byte, which detaches the
+    // buffer from any other owner first.
+    class JsonBinaryContainer : public JsonBinary {
+    public:
+        using value_type = uint8_t;
+        using iterator = const uint8_t *;
+        using const_iterator = const uint8_t *;
+
+        JsonBinaryContainer() = default;
+        JsonBinaryContainer(const JsonBinary &binary) : JsonBinary(binary) {
+        }
+        JsonBinaryContainer(JsonBinary &&binary) : JsonBinary(std::move(binary)) {
+        }
+        JsonBinaryContainer(const std::vector<uint8_t> &bytes) : JsonBinary(bytes.data(), bytes.size()) {
+        }
+        JsonBinaryContainer(std::vector<uint8_t> &&bytes) : JsonBinary(std::move(bytes)) {
+        }
+
+        inline const_iterator cbegin() const {
+            return begin();
+        }
+        inline const_iterator cend() const {
+            return end();
+        }
+        inline const uint8_t &back() const {
+            return _ptr[_size - 1];
+        }
+
+        void push_back(uint8_t byte) {
+            auto &buffer = writableBuffer();
+            buffer.push_back(byte);
+            _ptr = buffer.data();
+            _size = buffer.size();
+        }
+        template <class InputIt>
+        iterator insert(const_iterator pos, InputIt first, InputIt last) {
+            auto offset = pos - begin();
+            auto &buffer = writableBuffer();
+            buffer.insert(buffer.begin() + offset, first, last);
+            _ptr = buffer.data();
+            _size = buffer.size();
+            return _ptr + offset;
+        }
+        void clear() {
+            JsonBinary::operator=(JsonBinary());
+            _buffer = nullptr;
+        }
+
+        bool operator==(const JsonBinaryContainer &other) const {
+            return _size == other._size && std::equal(begin(), end(), other.begin());
+        }
+        bool operator!=(const JsonBinaryContainer &other) const {
+            return !(*this == other);
+        }
+        bool operator<(const JsonBinaryContainer &other) const {
+            return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        std::vector<uint8_t> &writableBuffer() {
+            if (!_buffer || _owner.use_count() != 1) {
+                auto buffer = std::make_shared<std::vector<uint8_t>>(begin(), end());
+                _buffer = buffer.get();
+                _owner = std::move(buffer);
+            }
+            return *_buffer;
+        }
+
+        // The growable vector behind _owner, set once push_back() has detached the buffer
+        std::vector<uint8_t> *_buffer = nullptr;
+    };
+
+    using Json = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t,
+                                      std::uint64_t, double, JsonAllocator, nlohmann::adl_serializer,
+                                      JsonBinaryContainer>;
+
     class JsonValueContainer {
     public:
-        nlohmann::json json;
+        Json json;
+    };
+
+    static inline std::shared_ptr<JsonValueContainer> newContainer() {
+        return std::allocate_shared<JsonValueContainer>(JsonAllocator<JsonValueContainer>());
+    }
+
+    // CBOR tags of RFC 8746 for little endian typed arrays. RFC 8746 has none for booleans, they
+    // take a private tag from the first come first served range, so that a uint8 typed array
+    // (tag 64) of another producer stays a plain binary
+    enum TypedArrayTag : uint64_t {
+        TagSInt64LE = 79,
+        TagFloat32LE = 85,
+        TagFloat64LE = 86,
+        TagBool = 0x64730062, // "ds", 0, "b"
+    };
+
+    static bool typedArrayType(const Json &json, JsonTypedArray::ElementType &type) {
+        if (!json.is_binary()) {
+            return false;
+        }
+        const auto &binary = json.get_binary();
+        if (!binary.has_subtype()) {
+            return false;
+        }
+        switch (binary.subtype()) {
+            case TagFloat32LE:
+                type = JsonTypedArray::Float32;
+                return true;
+            case TagFloat64LE:
+                type = JsonTypedArray::Float64;
+                return true;
+            case TagSInt64LE:
+                type = JsonTypedArray::Int64;
+                return true;
+            case TagBool:
+                type = JsonTypedArray::Bool;
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    static inline bool isTypedArrayJson(const Json &json) {
+        JsonTypedArray::ElementType type;
+        return typedArrayType(json, type);
+    }
+
+    static Json typedArrayJson(const JsonTypedArray &array) {
+        TypedArrayTag tag = TagFloat64LE;
+        switch (array.elementType()) {
+            case JsonTypedArray::Float32:
+                tag = TagFloat32LE;
+                break;
+            case JsonTypedArray::Float64:
+                tag = TagFloat64LE;
+                break;
+            case JsonTypedArray::Int64:
+                tag = TagSInt64LE;
+                break;
+            case JsonTypedArray::Bool:
+                tag = TagBool;
+                break;
+        }
+        return Json::binary_t(JsonBinaryContainer(array.binary()), tag);
+    }
+
+    static inline JsonTypedArray typedArrayOf(const Json &json, JsonTypedArray::ElementType type) {
+        return {type, json.get_binary()};
+    }
+
+    // Element `i` of a typed array node as a scalar node
+    static Json typedArrayElement(const Json &json, size_t i) {
+        JsonTypedArray::ElementType type;
+        if (!typedArrayType(json, type)) {
+            return {};
+        }
+        auto data = json.get_binary().data();
+        switch (type) {
+            case JsonTypedArray::Float32:
+                return readElement<float>(data, i);
+            case JsonTypedArray::Float64:
+                return readElement<double>(data, i);
+            case JsonTypedArray::Int64:
+                return readElement<int64_t>(data, i);
+            case JsonTypedArray::Bool:
+                return data[i] != 0;
+        }
+        return {};
+    }
+
+    static inline size_t typedArraySize(const Json &json, JsonTypedArray::ElementType type) {
+        return json.get_binary().size() / JsonTypedArray::elementSize(type);
+    }
+
+    static size_t jsonArraySize(const Json &json) {
+        JsonTypedArray::ElementType type;
+        return typedArrayType(json, type) ? typedArraySize(json, type) : json.size();
+    }
+
+    static bool jsonEquals(const Json &a, const Json &b);
+
+    // Typed arrays compare equal to plain arrays holding the same elements
+    static bool jsonArrayEquals(const Json &a, const Json &b) {
+        auto size = jsonArraySize(a);
+        if (size != jsonArraySize(b)) {
+            return false;
+        }
+        bool typedA = isTypedArrayJson(a);
+        bool typedB = isTypedArrayJson(b);
+        for (size_t i = 0; i < size; ++i) {
+            if (typedA || typedB) {
+                auto elementA = typedA ? typedArrayElement(a, i) : a[i];
+                auto elementB = typedB ? typedArrayElement(b, i) : b[i];
+                if (!jsonEquals(elementA, elementB)) {
+                    return false;
+                }
+            } else if (!jsonEquals(a[i], b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool jsonEquals(const Json &a, const Json &b) {
+        bool arrayA = a.is_array() || isTypedArrayJson(a);
+        bool arrayB = b.is_array() || isTypedArrayJson(b);
+        if (arrayA || arrayB) {
+            return arrayA && arrayB && jsonArrayEquals(a, b);
+        }
+        if (a.is_object() && b.is_object()) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            const auto &objectB = b.get_ref<const Json::object_t &>();
+            for (const auto &item : a.get_ref<const Json::object_t &>()) {
+                auto it = objectB.find(item.first);
+                if (it == objectB.end() || !jsonEquals(item.second, it->second)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return a == b;
+    }
+
+    static JsonValue::Type jsonType(const Json &json) {
+        JsonValue::Type type = JsonValue::Undefined;
+        switch (json.type()) {
+            case Json::value_t::null:
+                type = JsonValue::Null;
+                break;
+            case Json::value_t::object:
+                type = JsonValue::Object;
+                break;
+            case Json::value_t::array:
+                type = JsonValue::Array;
+                break;
+            case Json::value_t::string:
+                type = JsonValue::String;
+                break;
+            case Json::value_t::boolean:
+                type = JsonValue::Bool;
+                break;
+            case Json::value_t::number_integer:
+            case Json::value_t::number_unsigned:
+                type = JsonValue::Integer;
+                break;
+            case Json::value_t::number_float:
+                type = JsonValue::Double;
+                break;
+            case Json::value_t::binary:
+                type = isTypedArrayJson(json) ? JsonValue::Array : JsonValue::Binary;
+                break;
+            default:
+                break;
+        }
+        return type;
+    }
+
+    static bool jsonToBool(const Json &json, bool defaultValue) {
+        if (json.is_boolean()) {
+            return json.get<bool>();
+        }
+        return defaultValue;
+    }
+
+    static int jsonToInt(const Json &json, int defaultValue) {
+        switch (json.type()) {
+            case Json::value_t::number_integer:
+                return int(json.get<int64_t>());
+            case Json::value_t::number_unsigned:
+                return int(json.get<uint64_t>());
+            case Json::value_t::number_float:
+                return int(json.get<double>());
+            default:
+                break;
+        }
+        return defaultValue;
+    }
+
+    static int64_t jsonToInt64(const Json &json, int64_t defaultValue) {
+        switch (json.type()) {
+            case Json::value_t::number_integer:
+                return json.get<int64_t>();
+            case Json::value_t::number_unsigned:
+                return int64_t(json.get<uint64_t>());
+            case Json::value_t::number_float:
+                return int64_t(json.get<double>());
+            default:
+                break;
+        }
+        return defaultValue;
+    }
+
+    static double jsonToDouble(const Json &json, double defaultValue) {
+        switch (json.type()) {
+            case Json::value_t::number_integer:
+                return double(json.get<int64_t>());
+            case Json::value_t::number_unsigned:
+                return double(json.get<uint64_t>());
+            case Json::value_t::number_float:
+                return json.get<double>();
+            default:
+                break;
+        }
+        return defaultValue;
+    }
+
+    static std::string jsonToString(const Json &json, const std::string &defaultValue) {
+        if (json.is_string()) {
+            return json.get<std::string>();
+        }
+        return defaultValue;
+    }
+
+    static std::vector<uint8_t> jsonToBinary(const Json &json,
+                                             const std::vector<uint8_t> &defaultValue) {
+        if (json.is_binary() && !isTypedArrayJson(json)) {
+            return json.get_binary().toVector();
+        }
+        return defaultValue;
+    }
+
+    static JsonBinary jsonToBinaryView(const Json &json) {
+        if (json.is_binary() && !isTypedArrayJson(json)) {
+            return json.get_binary();
+        }
+        return {};
+    }
+
+    template <class Source>
+    static JsonTypedArray packTypedArray(JsonTypedArray::ElementType type, const Source &source, size_t size) {
+        switch (type) {
+            case JsonTypedArray::Float32: {
+                std::vector<float> data(size);
+                for (size_t i = 0; i < size; ++i) {
+                    data[i] = float(source.toDouble(i));
+                }
+                return data;
+            }
+            case JsonTypedArray::Float64: {
+                std::vector<double> data(size);
+                for (size_t i = 0; i < size; ++i) {
+                    data[i] = source.toDouble(i);
+                }
+                return data;
+            }
+            case JsonTypedArray::Int64: {
+                std::vector<int64_t> data(size);
+                for (size_t i = 0; i < size; ++i) {
+                    data[i] = source.toInt64(i);
+                }
+                return data;
+            }
+            case JsonTypedArray::Bool: {
+                std::vector<uint8_t> data(size);
+                for (size_t i = 0; i < size; ++i) {
+                    data[i] = source.toBool(i) ? 1 : 0;
+                }
+                return {JsonTypedArray::Bool, std::move(data)};
+            }
+        }
+        return {type, {}};
+    }
+
+    static JsonTypedArray jsonToTypedArray(const Json &json, JsonTypedArray::ElementType type) {
+        JsonTypedArray::ElementType sourceType;
+        if (typedArrayType(json, sourceType)) {
+            auto source = typedArrayOf(json, sourceType);
+            if (sourceType == type) {
+                return source;
+            }
+            return packTypedArray(type, source, source.size());
+        }
+        if (json.is_array()) {
+            struct ArraySource {
+                const Json &json;
+                double toDouble(size_t i) const {
+                    return jsonToDouble(json[i], 0);
+                }
+                int64_t toInt64(size_t i) const {
+                    return jsonToInt64(json[i], 0);
+                }
+                bool toBool(size_t i) const {
+                    const auto &item = json[i];
+                    return item.is_boolean() ? item.get<bool>() : jsonToDouble(item, 0) != 0;
+                }
+            };
+            return packTypedArray(type, ArraySource{json}, json.size());
+        }
+        return {type, {}};
+    }
+
+    // Same output as nlohmann::basic_json::dump(), except that typed arrays are written as arrays of
+    // numbers instead of binaries
+    class JsonWriter {
+    public:
+        JsonWriter(std::string &result, int indent)
+            : out(nlohmann::detail::output_adapter<char, std::string>(result)), serializer(out, ' '),
+              pretty(indent >= 0), indentStep(indent >= 0 ? indent : 0) {
+        }
+
+        void write(const Json &json, unsigned int currentIndent) {
+            JsonTypedArray::ElementType type;
+            if (typedArrayType(json, type)) {
+                auto size = typedArraySize(json, type);
+                writeArray(size, currentIndent, [&](size_t i, unsigned int) {
+                    serializer.dump(typedArrayElement(json, i), pretty, false, indentStep);
+                });
+                return;
+            }
+            switch (json.type()) {
+                case Json::value_t::array: {
+                    writeArray(json.size(), currentIndent, [&](size_t i, unsigned int newIndent) {
+                        write(json[i], newIndent);
+                    });
+                    break;
+                }
+                case Json::value_t::object: {
+                    if (json.empty()) {
+                        out->write_characters("{}", 2);
+                        break;
+                    }
+                    auto newIndent = currentIndent + indentStep;
+                    out->write_character('{');
+                    bool first = true;
+                    for (const auto &item : json.get_ref<const Json::object_t &>()) {
+                        if (!first) {
+                            out->write_character(',');
+                        }
+                        first = false;
+                        if (pretty) {
+                            out->write_character('\n');
+                            writeIndent(newIndent);
+                        }
+                        serializer.dump(Json(item.first), pretty, false, indentStep);
+                        out->write_characters(pretty ? ": " : ":", pretty ? 2 : 1);
+                        write(item.second, newIndent);
+                    }
+                    if (pretty) {
+                        out->write_character('\n');
+                        writeIndent(currentIndent);
+                    }
+                    out->write_character('}');
+                    break;
+                }
+                default:
+                    serializer.dump(json, pretty, false, indentStep, currentIndent);
+                    break;
+            }
+        }
+
+    private:
+        template <class F>
+        void writeArray(size_t size, unsigned int currentIndent, F writeItem) {
+            if (size == 0) {
+                out->write_characters("[]", 2);
+                return;
+            }
+            auto newIndent = currentIndent + indentStep;
+            out->write_character('[');
+            for (size_t i = 0; i < size; ++i) {
+                if (i > 0) {
+                    out->write_character(',');
+                }
+                if (pretty) {
+                    out->write_character('\n');
+                    writeIndent(newIndent);
+                }
+                writeItem(i, newIndent);
+            }
+            if (pretty) {
+                out->write_character('\n');
+                writeIndent(currentIndent);
+            }
+            out->write_character(']');
+        }
+
+        void writeIndent(unsigned int indent) {
+            for (unsigned int i = 0; i < indent; ++i) {
+                out->write_character(' ');
+            }
+        }
+
+        nlohmann::detail::output_adapter_t<char> out;
+        nlohmann::detail::serializer<Json> serializer;
+        bool pretty;
+        unsigned int indentStep;
+    };
+
+#ifdef DSINFER_JSON_SIMDJSON
+    // Builds the tree through the on-demand API of simdjson, which only decodes a number when its
+    // node is built. Non-negative integers become unsigned like they do in nlohmann's parser.
+    static simdjson::error_code simdjsonToJson(simdjson::ondemand::value value, Json &json) {
+        using namespace simdjson;
+        ondemand::json_type type;
+        if (auto err = value.type().get(type)) {
+            return err;
+        }
+        switch (type) {
+            case ondemand::json_type::array: {
+                ondemand::array array;
+                if (auto err = value.get_array().get(array)) {
+                    return err;
+                }
+                json = Json::array_t();
+                auto &items = json.get_ref<Json::array_t &>();
+                for (auto item : array) {
+                    ondemand::value itemValue;
+                    if (auto err = item.get(itemValue)) {
+                        return err;
+                    }
+                    if (auto err = simdjsonToJson(itemValue, items.emplace_back())) {
+                        return err;
+                    }
+                }
+                break;
+            }
+            case ondemand::json_type::object: {
+                ondemand::object object;
+                if (auto err = value.get_object().get(object)) {
+                    return err;
+                }
+                json = Json::object_t();
+                auto &fields = json.get_ref<Json::object_t &>();
+                for (auto field : object) {
+                    std::string_view key;
+                    if (auto err = field.unescaped_key().get(key)) {
+                        return err;
+                    }
+                    ondemand::value fieldValue;
+                    if (auto err = field.value().get(fieldValue)) {
+                        return err;
+                    }
+                    if (auto err = simdjsonToJson(fieldValue, fields[std::string(key)])) {
+                        return err;
+                    }
+                }
+                break;
+            }
+            case ondemand::json_type::number: {
+                ondemand::number_type numberType;
+                if (auto err = value.get_number_type().get(numberType)) {
+                    return err;
+                }
+                if (numberType == ondemand::number_type::signed_integer) {
+                    int64_t n;
+                    if (auto err = value.get_int64().get(n)) {
+                        return err;
+                    }
+                    json = n >= 0 ? Json(uint64_t(n)) : Json(n);
+                } else if (numberType == ondemand::number_type::unsigned_integer) {
+                    uint64_t n;
+                    if (auto err = value.get_uint64().get(n)) {
+                        return err;
+                    }
+                    json = n;
+                } else {
+                    double n;
+                    if (auto err = value.get_double().get(n)) {
+                        return err;
+                    }
+                    json = n;
+                }
+                break;
+            }
+            case ondemand::json_type::string: {
+                std::string_view str;
+                if (auto err = value.get_string().get(str)) {
+                    return err;
+                }
+                json = std::string(str);
+                break;
+            }
+            case ondemand::json_type::boolean: {
+                bool b;
+                if (auto err = value.get_bool().get(b)) {
+                    return err;
+                }
+                json = b;
+                break;
+            }
+            case ondemand::json_type::null: {
+                bool isNull;
+                if (auto err = value.is_null().get(isNull)) {
+                    return err;
+                }
+                if (!isNull) {
+                    return N_ATOM_ERROR;
+                }
+                json = nullptr;
+                break;
+            }
+            default:
+                return INCORRECT_TYPE;
+        }
+        return SUCCESS;
+    }
+
+    // Returns false for anything the fast path does not handle: invalid input, comments and scalar
+    // documents are left to nlohmann's parser
+    static bool simdjsonParse(const std::string &text, Json &json) {
+        static thread_local simdjson::ondemand::parser parser;
+        simdjson::padded_string padded;
+        simdjson::padded_string_view view(text.data(), text.size(), text.capacity());
+        if (view.padding() < simdjson::SIMDJSON_PADDING) {
+            padded = simdjson::padded_string(text);
+            view = padded;
+        }
+        simdjson::ondemand::document doc;
+        if (parser.iterate(view).get(doc)) {
+            return false;
+        }
+        simdjson::ondemand::value root;
+        if (doc.get_value().get(root) || simdjsonToJson(root, json)) {
+            return false;
+        }
+        return doc.at_end();
+    }
+#endif
+
+    // CBOR decoder producing the same tree as Json::from_cbor() with tags stored, except that
+    // definite length byte strings refer to the input buffer instead of being copied
+    class CborReader {
+    public:
+        explicit CborReader(const JsonBinary &input)
+            : input(input), pos(input.data()), end(input.data() + input.size()) {
+        }
+
+        // Data after the top level value is ignored as by the non-strict Json::from_cbor()
+        Json read() {
+            Json json;
+            readValue(json, 0);
+            return json;
+        }
+
+    private:
+        enum {
+            MaxDepth = 1024,
+        };
+
+        static constexpr uint64_t Indefinite = uint64_t(-1);
+
+        [[noreturn]] void fail(const char *message) const {
+            throw std::runtime_error("CBOR parse error at byte " +
+                                     std::to_string(pos - input.data()) + ": " + message);
+        }
+
+        uint8_t readByte() {
+            if (pos == end) {
+                fail("unexpected end of input");
+            }
+            return *pos++;
+        }
+
+        uint64_t readBigEndian(int bytes) {
+            if (end - pos < bytes) {
+                fail("unexpected end of input");
+            }
+            uint64_t result = 0;
+            for (int i = 0; i < bytes; ++i) {
+                result = (result << 8) | *pos++;
+            }
+            return result;
+        }
+
+        uint64_t readArgument(uint8_t info) {
+            if (info < 24) {
+                return info;
+            }
+            switch (info) {
+                case 24:
+                    return readBigEndian(1);
+                case 25:
+                    return readBigEndian(2);
+                case 26:
+                    return readBigEndian(4);
+                case 27:
+                    return readBigEndian(8);
+                case 31:
+                    return Indefinite;
+                default:
+                    break;
+            }
+            fail("invalid additional information");
+        }
+
+        bool readBreak() {
+            if (pos != end && *pos == 0xFF) {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        const uint8_t *readBytes(uint64_t size) {
+            if (uint64_t(end - pos) < size) {
+                fail("unexpected end of input");
+            }
+            auto data = pos;
+            pos += size;
+            return data;
+        }
+
+        // Appends the chunks of an indefinite length string, which must be of the same major type
+        template <class Container>
+        void readChunks(uint8_t major, Container &result) {
+            while (!readBreak()) {
+                auto byte = readByte();
+                auto size = readArgument(byte & 0x1F);
+                if ((byte >> 5) != major || size == Indefinite) {
+                    fail("invalid chunk of indefinite length string");
+                }
+                auto data = readBytes(size);
+                result.insert(result.end(), data, data + size);
+            }
+        }
 
-        void func() {
-            auto it = json.begin();
-            it++;
+        static double halfToDouble(uint16_t half) {
+            int exp = (half >> 10) & 0x1F;
+            unsigned int mant = half & 0x3FF;
+            double val;
+            switch (exp) {
+                case 0:
+                    val = std::ldexp(mant, -24);
+                    break;
+                case 31:
+                    val = mant == 0 ? std::numeric_limits<double>::infinity()
+                                    : std::numeric_limits<double>::quiet_NaN();
+                    break;
+                default:
+                    val = std::ldexp(mant + 1024, exp - 25);
+                    break;
+            }
+            return (half & 0x8000) ? -val : val;
+        }
+
+        void readValue(Json &json, int depth) {
+            if (depth > MaxDepth) {
+                fail("nesting too deep");
+            }
+            auto byte = readByte();
+            auto major = uint8_t(byte >> 5);
+            auto info = uint8_t(byte & 0x1F);
+            switch (major) {
+                case 0:
+                    json = readArgument(info);
+                    if (info == 31) {
+                        fail("invalid additional information");
+                    }
+                    break;
+                case 1: {
+                    auto arg = readArgument(info);
+                    if (info == 31) {
+                        fail("invalid additional information");
+                    }
+                    json = int64_t(-1) - int64_t(arg);
+                    break;
+                }
+                case 2: {
+                    auto size = readArgument(info);
+                    if (size == Indefinite) {
+                        std::vector<uint8_t> bytes;
+                        readChunks(major, bytes);
+                        json = Json::binary_t(JsonBinaryContainer(std::move(bytes)));
+                    } else {
+                        auto data = readBytes(size);
+                        json = Json::binary_t(JsonBinaryContainer(JsonBinary(input.owner(), data, size)));
+                    }
+                    break;
+                }
+                case 3: {
+                    auto size = readArgument(info);
+                    if (size == Indefinite) {
+                        std::string str;
+                        readChunks(major, str);
+                        json = std::move(str);
+                    } else {
+                        auto data = readBytes(size);
+                        json = std::string(reinterpret_cast<const char *>(data), size);
+                    }
+                    break;
+                }
+                case 4: {
+                    auto size = readArgument(info);
+                    json = Json::array_t();
+                    auto &array = json.get_ref<Json::array_t &>();
+                    if (size == Indefinite) {
+                        while (!readBreak()) {
+                            readValue(array.emplace_back(), depth + 1);
+                        }
+                    } else {
+                        // Every element takes at least one byte
+                        array.reserve(std::min<uint64_t>(size, end - pos));
+                        for (uint64_t i = 0; i < size; ++i) {
+                            readValue(array.emplace_back(), depth + 1);
+                        }
+                    }
+                    break;
+                }
+                case 5: {
+                    auto size = readArgument(info);
+                    json = Json::object_t();
+                    auto &object = json.get_ref<Json::object_t &>();
+                    Json key;
+                    for (uint64_t i = 0; size == Indefinite || i < size; ++i) {
+                        if (size == Indefinite && readBreak()) {
+                            break;
+                        }
+                        if (pos != end && (*pos >> 5) != 3) {
+                            fail("map key is not a string");
+                        }
+                        readValue(key, depth + 1);
+                        readValue(object[key.get_ref<const std::string &>()], depth + 1);
+                    }
+                    break;
+                }
+                case 6: {
+                    // Like Json::from_cbor(), tags 6 to 20 are ignored, 0 to 5 and 21 to 23 are
+                    // rejected and the others are only stored on byte strings
+                    auto tag = readArgument(info);
+                    if (tag == Indefinite) {
+                        fail("invalid additional information");
+                    }
+                    if (info < 24) {
+                        if (tag < 6 || tag > 20) {
+                            fail("unsupported tag");
+                        }
+                        readValue(json, depth + 1);
+                        break;
+                    }
+                    if (pos != end && (*pos >> 5) != 2) {
+                        fail("tagged value is not a byte string");
+                    }
+                    readValue(json, depth + 1);
+                    json.get_binary().set_subtype(tag);
+                    break;
+                }
+                default: {
+                    switch (info) {
+                        case 20:
+                            json = false;
+                            break;
+                        case 21:
+                            json = true;
+                            break;
+                        case 22:
+                            json = nullptr;
+                            break;
+                        case 25:
+                            json = halfToDouble(uint16_t(readBigEndian(2)));
+                            break;
+                        case 26: {
+                            auto bits = uint32_t(readBigEndian(4));
+                            float val;
+                            std::memcpy(&val, &bits, sizeof(val));
+                            json = double(val);
+                            break;
+                        }
+                        case 27: {
+                            auto bits = readBigEndian(8);
+                            double val;
+                            std::memcpy(&val, &bits, sizeof(val));
+                            json = val;
+                            break;
+                        }
+                        default:
+                            fail("unsupported simple value");
+                    }
+                    break;
+                }
+            }
         }
+
+        const JsonBinary &input;
+        const uint8_t *pos;
+        const uint8_t *end;
     };
 
-    JsonValue::JsonValue(Type type) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(Type type) : _data(newContainer()) {
         auto &json = _data->json;
         switch (type) {
             case Null: {
@@ -37,14 +1193,14 @@ namespace dsinfer {
                 break;
             }
             case Binary:
-                json = nlohmann::json::binary_t();
+                json = Json::binary_t();
                 break;
             case Array: {
-                json = nlohmann::json::array();
+                json = Json::array();
                 break;
             }
             case Object: {
-                json = nlohmann::json::object();
+                json = Json::object();
                 break;
             }
             case Undefined: {
@@ -54,60 +1210,105 @@ namespace dsinfer {
         }
     }
 
-    JsonValue::JsonValue(bool b) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(bool b) : _data(newContainer()) {
         auto &json = _data->json;
         json = b;
     }
 
-    JsonValue::JsonValue(double n) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(double n) : _data(newContainer()) {
         auto &json = _data->json;
         json = n;
     }
 
-    JsonValue::JsonValue(int n) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(int n) : _data(newContainer()) {
         auto &json = _data->json;
         json = n;
     }
 
-    JsonValue::JsonValue(int64_t n) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(int64_t n) : _data(newContainer()) {
         auto &json = _data->json;
         json = n;
     }
 
-    JsonValue::JsonValue(const std::string &s) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const std::string &s) : _data(newContainer()) {
         auto &json = _data->json;
         json = s;
     }
 
-    JsonValue::JsonValue(const char *s) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const char *s) : _data(newContainer()) {
         auto &json = _data->json;
         json = s;
     }
 
-    JsonValue::JsonValue(const std::vector<uint8_t> &bytes) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const std::vector<uint8_t> &bytes) : _data(newContainer()) {
+        auto &json = _data->json;
+        json = Json::binary_t(bytes);
+    }
+
+    JsonValue::JsonValue(std::vector<uint8_t> &&bytes) : _data(newContainer()) {
+        auto &json = _data->json;
+        json = Json::binary_t(std::move(bytes));
+    }
+
+    JsonValue::JsonValue(const uint8_t *data, int size) : _data(newContainer()) {
         auto &json = _data->json;
-        json = nlohmann::json::binary_t(bytes);
+        json = Json::binary_t(JsonBinary(data, size));
     }
 
-    JsonValue::JsonValue(const uint8_t *data, int size) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const JsonBinary &binary) : _data(newContainer()) {
         auto &json = _data->json;
-        json = std::vector<uint8_t>(data, data + size);
+        json = Json::binary_t(binary);
     }
 
-    JsonValue::JsonValue(const _Array &a) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const JsonTypedArray &array) : _data(newContainer()) {
         auto &json = _data->json;
+        json = typedArrayJson(array);
+    }
+
+    JsonValue::JsonValue(const _Array &a) : _data(newContainer()) {
+        auto &json = _data->json;
+        json = Json::array();
+        json.get_ref<Json::array_t &>().reserve(a.size());
         for (const auto &item : a) {
             json.push_back(item._data->json);
         }
     }
 
-    JsonValue::JsonValue(const _Object &o) : _data(std::make_shared<JsonValueContainer>()) {
+    JsonValue::JsonValue(const _Object &o) : _data(newContainer()) {
         auto &json = _data->json;
+        json = Json::object();
         for (const auto &it : o) {
             json[it.first] = it.second._data->json;
         }
     }
 
+    // Moves the node out of a container that nobody else refers to, copies it otherwise
+    static inline Json takeJson(std::shared_ptr<JsonValueContainer> &data) {
+        if (data.use_count() == 1) {
+            return std::move(data->json);
+        }
+        return data->json;
+    }
+
+    JsonValue::JsonValue(_Array &&a) : _data(newContainer()) {
+        auto &json = _data->json;
+        json = Json::array();
+        json.get_ref<Json::array_t &>().reserve(a.size());
+        for (auto &item : a) {
+            json.push_back(takeJson(item._data));
+        }
+        a.clear();
+    }
+
+    JsonValue::JsonValue(_Object &&o) : _data(newContainer()) {
+        auto &json = _data->json;
+        json = Json::object();
+        for (auto &it : o) {
+            json[it.first] = takeJson(it.second._data);
+        }
+        o.clear();
+    }
+
     JsonValue::~JsonValue() = default;
 
     JsonValue::JsonValue(const JsonValue &other) = default;
@@ -117,103 +1318,49 @@ namespace dsinfer {
     JsonValue::JsonValue(JsonValue &&other) noexcept = default;
 
     JsonValue::Type JsonValue::type() const {
-        JsonValue::Type type = Undefined;
-        switch (_data->json.type()) {
-            case nlohmann::json_abi_v3_11_3::detail::value_t::null:
-                type = Null;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::object:
-                type = Object;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::array:
-                type = Array;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::string:
-                type = String;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::boolean:
-                type = Bool;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_integer:
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_unsigned:
-                type = Integer;
-                break;
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_float:
-                type = Double;
-                break;
-            case nlohmann::detail::value_t::binary:
-                type = Binary;
-                break;
-            default:
-                break;
-        }
-        return type;
+        return jsonType(_data->json);
     }
     bool JsonValue::toBool(bool defaultValue) const {
-        auto &json = _data->json;
-        if (json.is_boolean()) {
-            return json.get<bool>();
-        }
-        return defaultValue;
+        return jsonToBool(_data->json, defaultValue);
     }
     int JsonValue::toInt(int defaultValue) const {
-        auto &json = _data->json;
-        switch (json.type()) {
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_integer:
-                return int(json.get<int64_t>());
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_unsigned:
-                return int(json.get<uint64_t>());
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_float:
-                return int(json.get<double>());
-            default:
-                break;
-        }
-        return defaultValue;
+        return jsonToInt(_data->json, defaultValue);
     }
     int64_t JsonValue::toInt64(int64_t defaultValue) const {
-        auto &json = _data->json;
-        switch (json.type()) {
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_integer:
-                return json.get<int64_t>();
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_unsigned:
-                return int64_t(json.get<uint64_t>());
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_float:
-                return int64_t(json.get<double>());
-            default:
-                break;
-        }
-        return defaultValue;
+        return jsonToInt64(_data->json, defaultValue);
     }
     double JsonValue::toDouble(double defaultValue) const {
-        auto &json = _data->json;
-        switch (json.type()) {
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_integer:
-                return json.get<int>();
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_unsigned:
-                return json.get<unsigned int>();
-            case nlohmann::json_abi_v3_11_3::detail::value_t::number_float:
-                return json.get<double>();
-            default:
-                break;
-        }
-        return defaultValue;
+        return jsonToDouble(_data->json, defaultValue);
     }
     std::string JsonValue::toString(const std::string &defaultValue) const {
-        auto &json = _data->json;
-        if (json.is_string()) {
-            return json.get<std::string>();
-        }
-        return defaultValue;
+        return jsonToString(_data->json, defaultValue);
     }
     std::vector<uint8_t> JsonValue::toBinary(const std::vector<uint8_t> &defaultValue) const {
-        auto &json = _data->json;
-        if (json.is_binary()) {
-            return json.get_binary();
-        }
-        return defaultValue;
+        return jsonToBinary(_data->json, defaultValue);
+    }
+    JsonBinary JsonValue::toBinaryView() const {
+        return jsonToBinaryView(_data->json);
+    }
+    bool JsonValue::isTypedArray() const {
+        return isTypedArrayJson(_data->json);
+    }
+    JsonTypedArray JsonValue::toTypedArray(JsonTypedArray::ElementType type) const {
+        return jsonToTypedArray(_data->json, type);
     }
     JsonValue::_Array JsonValue::toArray(const _Array &defaultValue) const {
         auto &json = _data->json;
+        JsonTypedArray::ElementType type;
+        if (typedArrayType(json, type)) {
+            _Array a;
+            auto size = typedArraySize(json, type);
+            a.reserve(size);
+            for (size_t i = 0; i < size; ++i) {
+                JsonValue val;
+                val._data->json = typedArrayElement(json, i);
+                a.push_back(val);
+            }
+            return a;
+        }
         if (json.is_array()) {
             _Array a;
             a.reserve(json.size());
@@ -262,20 +1409,38 @@ namespace dsinfer {
             val._data->json = json[i];
             return val;
         }
+        JsonTypedArray::ElementType type;
+        if (typedArrayType(json, type)) {
+            if (i < 0 || size_t(i) >= typedArraySize(json, type)) {
+                return {Undefined};
+            }
+            JsonValue val;
+            val._data->json = typedArrayElement(json, i);
+            return val;
+        }
         return {Undefined};
     }
     bool JsonValue::operator==(const JsonValue &other) const {
-        return _data->json == other._data->json;
+        return jsonEquals(_data->json, other._data->json);
     }
     std::string JsonValue::toJson(int indent) const {
-        return _data->json.dump(indent);
+        std::string result;
+        JsonWriter writer(result, indent);
+        writer.write(_data->json, 0);
+        return result;
     }
     JsonValue JsonValue::fromJson(const std::string &json, bool ignore_comments,
                                   std::string *error) {
         JsonValue val;
+#ifdef DSINFER_JSON_SIMDJSON
+        if (simdjsonParse(json, val._data->json)) {
+            return val;
+        }
+        val._data->json = nullptr;
+#endif
         try {
-            auto ex = nlohmann::json::parse(json, nullptr, true, ignore_comments);
-            val._data->json = ex;
+            auto ex = Json::parse(json, nullptr, true, ignore_comments);
+            val._data->json = std::move(ex);
         } catch (const std::exception &e) {
             if (error)
                 *error = e.what();
@@ -284,13 +1449,17 @@ namespace dsinfer {
     }
 
     std::vector<uint8_t> JsonValue::toCbor() const {
-        return nlohmann::json::to_cbor(_data->json);
+        return Json::to_cbor(_data->json);
+    }
+
+    void JsonValue::toCbor(std::vector<uint8_t> &out) const {
+        Json::to_cbor(_data->json, out);
     }
 
     JsonValue JsonValue::fromCbor(const std::vector<uint8_t> &cbor, std::string *error) {
         JsonValue val;
         try {
-            auto ex = nlohmann::json::from_cbor(cbor, false, true);
+            auto ex = Json::from_cbor(cbor, false, true, Json::cbor_tag_handler_t::store);
             val._data->json = ex;
         } catch (const std::exception &e) {
             if (error)
@@ -299,4 +1468,267 @@ namespace dsinfer {
         return val;
     }
 
-}
\ No newline at end of file
+    JsonValue JsonValue::fromCbor(const JsonBinary &cbor, std::string *error) {
+        JsonValue val;
+        try {
+            val._data->json = CborReader(cbor).read();
+        } catch (const std::exception &e) {
+            if (error)
+                *error = e.what();
+        }
+        return val;
+    }
+
+
+    JsonBuilder::JsonBuilder(JsonValue::Type type) : _type(type), _value(type) {
+    }
+
+    JsonBuilder::~JsonBuilder() = default;
+
+    JsonBuilder &JsonBuilder::reserve(size_t size) {
+        auto &json = _value._data->json;
+        if (json.is_array()) {
+            json.get_ref<Json::array_t &>().reserve(size);
+        }
+        return *this;
+    }
+
+    JsonBuilder &JsonBuilder::append(const JsonValue &value) {
+        auto &json = _value._data->json;
+        if (json.is_array()) {
+            json.push_back(value._data->json);
+        }
+        return *this;
+    }
+
+    JsonBuilder &JsonBuilder::append(JsonValue &&value) {
+        auto &json = _value._data->json;
+        if (json.is_array()) {
+            json.push_back(takeJson(value._data));
+        }
+        return *this;
+    }
+
+    JsonBuilder &JsonBuilder::insert(const std::string &key, const JsonValue &value) {
+        auto &json = _value._data->json;
+        if (json.is_object()) {
+            json[key] = value._data->json;
+        }
+        return *this;
+    }
+
+    JsonBuilder &JsonBuilder::insert(const std::string &key, JsonValue &&value) {
+        auto &json = _value._data->json;
+        if (json.is_object()) {
+            json[key] = takeJson(value._data);
+        }
+        return *this;
+    }
+
+    JsonValue JsonBuilder::build() {
+        JsonValue value(_type);
+        value.swap(_value);
+        return value;
+    }
+
+    static inline const Json *jsonNode(const void *node) {
+        return static_cast<const Json *>(node);
+    }
+
+    // Same as JsonValueRef::npos, the reference points to a whole node
+    static constexpr size_t NoElement = size_t(-1);
+
+    // Resolves a reference, elements of typed arrays are materialized into `element`
+    static inline const Json *resolveRef(const void *node, size_t index, Json &element) {
+        if (!node || index == NoElement) {
+            return jsonNode(node);
+        }
+        element = typedArrayElement(*jsonNode(node), index);
+        return &element;
+    }
+
+    JsonValueRef::JsonValueRef(const JsonValue &value) : _node(&value._data->json), _index(npos) {
+    }
+
+    JsonValueRef::Type JsonValueRef::type() const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        if (!json) {
+            return JsonValue::Undefined;
+        }
+        return jsonType(*json);
+    }
+    bool JsonValueRef::isTypedArray() const {
+        return _node && _index == npos && isTypedArrayJson(*jsonNode(_node));
+    }
+    bool JsonValueRef::toBool(bool defaultValue) const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        return json ? jsonToBool(*json, defaultValue) : defaultValue;
+    }
+    int JsonValueRef::toInt(int defaultValue) const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        return json ? jsonToInt(*json, defaultValue) : defaultValue;
+    }
+    int64_t JsonValueRef::toInt64(int64_t defaultValue) const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        return json ? jsonToInt64(*json, defaultValue) : defaultValue;
+    }
+    double JsonValueRef::toDouble(double defaultValue) const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        return json ? jsonToDouble(*json, defaultValue) : defaultValue;
+    }
+    std::string JsonValueRef::toString(const std::string &defaultValue) const {
+        if (!_node || _index != npos) {
+            return defaultValue;
+        }
+        return jsonToString(*jsonNode(_node), defaultValue);
+    }
+    std::string_view JsonValueRef::toStringView(std::string_view defaultValue) const {
+        if (!_node || _index != npos) {
+            return defaultValue;
+        }
+        auto str = jsonNode(_node)->get_ptr<const Json::string_t *>();
+        return str ? std::string_view(*str) : defaultValue;
+    }
+    std::vector<uint8_t> JsonValueRef::toBinary(const std::vector<uint8_t> &defaultValue) const {
+        if (!_node || _index != npos) {
+            return defaultValue;
+        }
+        return jsonToBinary(*jsonNode(_node), defaultValue);
+    }
+    JsonBinary JsonValueRef::toBinaryView() const {
+        if (!_node || _index != npos) {
+            return {};
+        }
+        return jsonToBinaryView(*jsonNode(_node));
+    }
+    JsonTypedArray JsonValueRef::toTypedArray(JsonTypedArray::ElementType type) const {
+        if (!_node || _index != npos) {
+            return {type, {}};
+        }
+        return jsonToTypedArray(*jsonNode(_node), type);
+    }
+    JsonArrayRef JsonValueRef::toArray() const {
+        JsonArrayRef a;
+        if (_node && _index == npos) {
+            auto &json = *jsonNode(_node);
+            JsonTypedArray::ElementType type;
+            if (json.is_array()) {
+                a._node = _node;
+                a._size = json.size();
+            } else if (typedArrayType(json, type)) {
+                a._node = _node;
+                a._size = typedArraySize(json, type);
+            }
+        }
+        return a;
+    }
+    JsonObjectRef JsonValueRef::toObject() const {
+        JsonObjectRef o;
+        if (_node && _index == npos && jsonNode(_node)->is_object()) {
+            // Json stores objects in a std::map, so the items are already sorted
+            auto &obj = jsonNode(_node)->get_ref<const Json::object_t &>();
+            o._items.reserve(obj.size());
+            for (const auto &item : obj) {
+                o._items.emplace_back(item.first, JsonValueRef(&item.second));
+            }
+        }
+        return o;
+    }
+    JsonValue JsonValueRef::toValue() const {
+        Json element;
+        auto json = resolveRef(_node, _index, element);
+        if (!json) {
+            return {JsonValue::Undefined};
+        }
+        JsonValue val;
+        val._data->json = *json;
+        return val;
+    }
+    size_t JsonValueRef::size() const {
+        if (!_node || _index != npos) {
+            return 0;
+        }
+        auto &json = *jsonNode(_node);
+        JsonTypedArray::ElementType type;
+        if (typedArrayType(json, type)) {
+            return typedArraySize(json, type);
+        }
+        return (json.is_array() || json.is_object()) ? json.size() : 0;
+    }
+    JsonValueRef JsonValueRef::operator[](std::string_view key) const {
+        if (!_node || _index != npos || !jsonNode(_node)->is_object()) {
+            return {};
+        }
+        auto &obj = jsonNode(_node)->get_ref<const Json::object_t &>();
+        // The object comparator is transparent, no temporary key is created
+        auto it = obj.find(key);
+        if (it == obj.end()) {
+            return {};
+        }
+        return JsonValueRef(&it->second);
+    }
+    JsonValueRef JsonValueRef::operator[](int i) const {
+        if (i < 0) {
+            return {};
+        }
+        return toArray().at(size_t(i));
+    }
+    bool JsonValueRef::operator==(const JsonValueRef &other) const {
+        Json element, otherElement;
+        auto json = resolveRef(_node, _index, element);
+        auto otherJson = resolveRef(other._node, other._index, otherElement);
+        if (!json || !otherJson) {
+            return json == otherJson;
+        }
+        return jsonEquals(*json, *otherJson);
+    }
+
+    JsonValueRef JsonArrayRef::at(size_t i) const {
+        if (i >= _size) {
+            return {};
+        }
+        auto &json = *jsonNode(_node);
+        if (json.is_binary()) {
+            // Elements of a typed array
+            return JsonValueRef(_node, i);
+        }
+        return JsonValueRef(&json[i]);
+    }
+
+    JsonObjectRef::JsonObjectRef() = default;
+
+    JsonObjectRef::~JsonObjectRef() = default;
+
+    JsonObjectRef::JsonObjectRef(const JsonObjectRef &other) = default;
+
+    JsonObjectRef &JsonObjectRef::operator=(const JsonObjectRef &other) = default;
+
+    JsonObjectRef::JsonObjectRef(JsonObjectRef &&other) noexcept = default;
+
+    JsonObjectRef &JsonObjectRef::operator=(JsonObjectRef &&other) noexcept = default;
+
+    JsonObjectRef::const_iterator JsonObjectRef::find(std::string_view key) const {
+        auto it = std::lower_bound(_items.begin(), _items.end(), key,
+                                   [](const value_type &item, std::string_view key) {
+                                       return item.first < key;
+                                   });
+        if (it == _items.end() || it->first != key) {
+            return _items.end();
+        }
+        return it;
+    }
+
+    JsonValueRef JsonObjectRef::operator[](std::string_view key) const {
+        auto it = find(key);
+        if (it == _items.end()) {
+            return {};
+        }
+        return it->second;
+    }
+
+}
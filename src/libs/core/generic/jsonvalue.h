@@ -1,8 +1,13 @@
 #ifndef JSONVALUE_H
 #define JSONVALUE_H
 
+#include <cstdint>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <dsinfer/dsinferglobal.h>
@@ -11,6 +16,123 @@ namespace dsinfer {
 
     class JsonValueContainer;
 
+    /**
+     * @brief Immutable, reference counted byte buffer used for binary JSON values.
+     *
+     * Copying a JsonBinary only copies the reference. A buffer can adopt an existing allocation,
+     * in which case \a owner keeps the memory alive for as long as any copy of the buffer exists.
+     */
+    class DSINFER_EXPORT JsonBinary {
+    public:
+        JsonBinary();
+        JsonBinary(const uint8_t *data, size_t size);
+        JsonBinary(std::vector<uint8_t> &&bytes);
+        JsonBinary(std::shared_ptr<const void> owner, const uint8_t *data, size_t size);
+        ~JsonBinary();
+
+        JsonBinary(const JsonBinary &other);
+        JsonBinary &operator=(const JsonBinary &other);
+
+        JsonBinary(JsonBinary &&other) noexcept;
+        JsonBinary &operator=(JsonBinary &&other) noexcept;
+
+        inline const uint8_t *data() const {
+            return _ptr;
+        }
+        inline size_t size() const {
+            return _size;
+        }
+        inline bool empty() const {
+            return _size == 0;
+        }
+        inline const uint8_t *begin() const {
+            return _ptr;
+        }
+        inline const uint8_t *end() const {
+            return _ptr + _size;
+        }
+
+        // Keeps the memory alive, pass it along with data() to share the buffer without copying
+        inline const std::shared_ptr<const void> &owner() const {
+            return _owner;
+        }
+
+        std::vector<uint8_t> toVector() const;
+
+    protected:
+        std::shared_ptr<const void> _owner;
+        const uint8_t *_ptr;
+        size_t _size;
+    };
+
+    /**
+     * @brief Packed array of numbers that share one element type.
+     *
+     * The elements are stored contiguously in a JsonBinary, so a JsonValue holding a typed array
+     * costs one node instead of one node per element. Typed arrays report JsonValue::Array and are
+     * written as plain number arrays by toJson(). In CBOR they are encoded with the typed array tags
+     * of RFC 8746 (little endian; bool elements, which RFC 8746 has no tag for, use the private
+     * tag 0x64730062) and keep their element type.
+     */
+    class DSINFER_EXPORT JsonTypedArray {
+    public:
+        enum ElementType {
+            Float32,
+            Float64,
+            Int64,
+            Bool,
+        };
+
+        JsonTypedArray();
+        JsonTypedArray(ElementType type, const JsonBinary &data);
+        JsonTypedArray(const float *data, size_t size);
+        JsonTypedArray(const double *data, size_t size);
+        JsonTypedArray(const int64_t *data, size_t size);
+        JsonTypedArray(const bool *data, size_t size);
+        JsonTypedArray(std::vector<float> &&data);
+        JsonTypedArray(std::vector<double> &&data);
+        JsonTypedArray(std::vector<int64_t> &&data);
+        ~JsonTypedArray();
+
+        JsonTypedArray(const JsonTypedArray &other);
+        JsonTypedArray &operator=(const JsonTypedArray &other);
+
+        JsonTypedArray(JsonTypedArray &&other) noexcept;
+        JsonTypedArray &operator=(JsonTypedArray &&other) noexcept;
+
+        static size_t elementSize(ElementType type);
+
+        inline ElementType elementType() const {
+            return _type;
+        }
+        inline size_t size() const {
+            return _data.size() / elementSize(_type);
+        }
+        inline bool empty() const {
+            return size() == 0;
+        }
+
+        // Raw elements in host byte order, not necessarily aligned
+        inline const void *data() const {
+            return _data.data();
+        }
+        inline const JsonBinary &binary() const {
+            return _data;
+        }
+
+        double toDouble(size_t i) const;
+        int64_t toInt64(size_t i) const;
+        bool toBool(size_t i) const;
+
+    protected:
+        ElementType _type;
+        JsonBinary _data;
+    };
+
+    class JsonValueRef;
+
+    class JsonBuilder;
+
     class DSINFER_EXPORT JsonValue {
     public:
         enum Type {
@@ -36,9 +158,15 @@ namespace dsinfer {
         JsonValue(const std::string &s);
         JsonValue(const char *s);
         JsonValue(const std::vector<uint8_t> &bytes);
+        JsonValue(std::vector<uint8_t> &&bytes);
         JsonValue(const uint8_t *data, int size);
+        JsonValue(const JsonBinary &binary);
+        JsonValue(const JsonTypedArray &array);
         JsonValue(const _Array &a);
         JsonValue(const _Object &o);
+        // Children that are not shared with other JsonValue instances are moved instead of copied
+        JsonValue(_Array &&a);
+        JsonValue(_Object &&o);
         ~JsonValue();
 
         JsonValue(const JsonValue &other);
@@ -82,6 +210,7 @@ namespace dsinfer {
         inline bool isUndefined() const {
             return type() == Undefined;
         }
+        bool isTypedArray() const;
 
         bool toBool(bool defaultValue = false) const;
         int toInt(int defaultValue = 0) const;
@@ -89,6 +218,11 @@ namespace dsinfer {
         double toDouble(double defaultValue = 0) const;
         std::string toString(const std::string &defaultValue = {}) const;
         std::vector<uint8_t> toBinary(const std::vector<uint8_t> &defaultValue = {}) const;
+        // Shares the binary payload instead of copying it, empty if the value is not binary
+        JsonBinary toBinaryView() const;
+        // Shares the storage of a typed array of the same element type, packs and converts the
+        // elements of any other array, empty if the value is not an array
+        JsonTypedArray toTypedArray(JsonTypedArray::ElementType type) const;
         _Array toArray(const _Array &defaultValue = {}) const;
         _Object toObject(const _Object &defaultValue = {}) const;
 
@@ -112,16 +246,297 @@ namespace dsinfer {
                                   std::string *error = nullptr);
 
         std::vector<uint8_t> toCbor() const;
+        void toCbor(std::vector<uint8_t> &out) const; // appends to out
         static JsonValue fromCbor(const std::vector<uint8_t> &cbor, std::string *error = nullptr);
 
+        // Byte strings in the result refer to the memory of cbor and share its owner instead of
+        // being copied. If cbor has no owner, the memory must outlive the result.
+        static JsonValue fromCbor(const JsonBinary &cbor, std::string *error = nullptr);
+
     protected:
         std::shared_ptr<JsonValueContainer> _data;
+
+        friend class JsonValueRef;
+        friend class JsonBuilder;
     };
 
     using JsonObject = JsonValue::_Object;
 
     using JsonArray = JsonValue::_Array;
 
+    /**
+     * @brief Assembles a JSON array or object in place.
+     *
+     * Values passed as rvalues are moved into the result unless another JsonValue still shares
+     * them, so large payloads such as tensors are not copied while the tree is being built.
+     */
+    class DSINFER_EXPORT JsonBuilder {
+    public:
+        explicit JsonBuilder(JsonValue::Type type = JsonValue::Object);
+        ~JsonBuilder();
+
+        // Only valid for an array builder
+        JsonBuilder &reserve(size_t size);
+        JsonBuilder &append(const JsonValue &value);
+        JsonBuilder &append(JsonValue &&value);
+
+        // Only valid for an object builder
+        JsonBuilder &insert(const std::string &key, const JsonValue &value);
+        JsonBuilder &insert(const std::string &key, JsonValue &&value);
+
+        // Takes the assembled value out, the builder is empty afterwards
+        JsonValue build();
+
+    protected:
+        JsonValue::Type _type;
+        JsonValue _value;
+
+        STDCORELIB_DISABLE_COPY(JsonBuilder)
+    };
+
+    template <class T>
+    class JsonAllocator;
+
+    /**
+     * @brief Scope in which new JsonValue nodes of the current thread are allocated from an arena.
+     *
+     * While the scope is active, JsonValue nodes and their array and object storage created on
+     * the constructing thread are taken from large blocks instead of individual heap allocations.
+     * Large arrays, strings and binary payloads still use the heap. The blocks are released in one
+     * go once the scope has ended and every node allocated from them has been destroyed, so
+     * values may safely outlive the scope and be released on any thread. Scopes can be nested,
+     * the innermost one is used.
+     */
+    class DSINFER_EXPORT JsonArena {
+    public:
+        explicit JsonArena(size_t blockSize = 64 * 1024);
+        ~JsonArena();
+
+        struct Statistics {
+            size_t allocations = 0; // served from the arena
+            size_t bytes = 0;       // including per allocation headers
+            size_t blocks = 0;
+        };
+        Statistics statistics() const;
+
+    protected:
+        class Impl;
+        Impl *_impl;
+
+        template <class T>
+        friend class JsonAllocator;
+
+        STDCORELIB_DISABLE_COPY(JsonArena)
+    };
+
+    class JsonArrayRef;
+
+    class JsonObjectRef;
+
+    /**
+     * @brief Read-only view of a node inside a JsonValue tree.
+     *
+     * Unlike JsonValue::toArray(), JsonValue::toObject() and JsonValue::operator[](), which copy
+     * the requested subtree, a JsonValueRef points into the existing tree. It is only valid as long
+     * as the JsonValue it was obtained from is alive. A lookup that misses yields an Undefined
+     * reference.
+     */
+    class DSINFER_EXPORT JsonValueRef {
+    public:
+        using Type = JsonValue::Type;
+
+        inline JsonValueRef() : _node(nullptr), _index(npos) {
+        }
+        JsonValueRef(const JsonValue &value);
+
+        Type type() const;
+        inline bool isNull() const {
+            return type() == JsonValue::Null;
+        }
+        inline bool isBool() const {
+            return type() == JsonValue::Bool;
+        }
+        inline bool isInt() const {
+            return type() == JsonValue::Integer;
+        }
+        inline bool isDouble() const {
+            return type() == JsonValue::Double;
+        }
+        inline bool isString() const {
+            return type() == JsonValue::String;
+        }
+        inline bool isBinary() const {
+            return type() == JsonValue::Binary;
+        }
+        inline bool isArray() const {
+            return type() == JsonValue::Array;
+        }
+        inline bool isObject() const {
+            return type() == JsonValue::Object;
+        }
+        inline bool isUndefined() const {
+            return type() == JsonValue::Undefined;
+        }
+        bool isTypedArray() const;
+
+        bool toBool(bool defaultValue = false) const;
+        int toInt(int defaultValue = 0) const;
+        int64_t toInt64(int64_t defaultValue = 0) const;
+        double toDouble(double defaultValue = 0) const;
+        std::string toString(const std::string &defaultValue = {}) const;
+        std::string_view toStringView(std::string_view defaultValue = {}) const;
+        std::vector<uint8_t> toBinary(const std::vector<uint8_t> &defaultValue = {}) const;
+        JsonBinary toBinaryView() const;
+        JsonTypedArray toTypedArray(JsonTypedArray::ElementType type) const;
+        JsonArrayRef toArray() const;
+        JsonObjectRef toObject() const;
+
+        // Deep copy of the referenced subtree
+        JsonValue toValue() const;
+
+        // Number of elements of an array or an object, 0 otherwise
+        size_t size() const;
+
+        inline JsonValueRef operator[](const std::string &key) const {
+            return operator[](std::string_view(key));
+        }
+        inline JsonValueRef operator[](const char *key) const {
+            return operator[](std::string_view(key));
+        }
+        JsonValueRef operator[](std::string_view key) const;
+        JsonValueRef operator[](int i) const;
+
+        bool operator==(const JsonValueRef &other) const;
+        inline bool operator!=(const JsonValueRef &other) const {
+            return !(*this == other);
+        }
+
+    protected:
+        explicit inline JsonValueRef(const void *node, size_t index = npos) : _node(node), _index(index) {
+        }
+
+        static constexpr size_t npos = size_t(-1);
+
+        // Either a node, or a typed array node and the index of one of its elements
+        const void *_node;
+        size_t _index;
+
+        friend class JsonArrayRef;
+        friend class JsonObjectRef;
+    };
+
+    /**
+     * @brief Span-like read-only view of a JSON array.
+     */
+    class DSINFER_EXPORT JsonArrayRef {
+    public:
+        class const_iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = JsonValueRef;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = JsonValueRef;
+
+            inline const_iterator(const JsonArrayRef *a, size_t i) : a(a), i(i) {
+            }
+
+            inline JsonValueRef operator*() const {
+                return a->at(i);
+            }
+            inline const_iterator &operator++() {
+                ++i;
+                return *this;
+            }
+            inline const_iterator operator++(int) {
+                auto it = *this;
+                ++i;
+                return it;
+            }
+            inline bool operator==(const const_iterator &other) const {
+                return i == other.i;
+            }
+            inline bool operator!=(const const_iterator &other) const {
+                return i != other.i;
+            }
+
+        private:
+            const JsonArrayRef *a;
+            size_t i;
+        };
+
+        inline JsonArrayRef() : _node(nullptr), _size(0) {
+        }
+
+        inline size_t size() const {
+            return _size;
+        }
+        inline bool empty() const {
+            return _size == 0;
+        }
+
+        JsonValueRef at(size_t i) const;
+        inline JsonValueRef operator[](size_t i) const {
+            return at(i);
+        }
+
+        inline const_iterator begin() const {
+            return {this, 0};
+        }
+        inline const_iterator end() const {
+            return {this, _size};
+        }
+
+    protected:
+        const void *_node;
+        size_t _size;
+
+        friend class JsonValueRef;
+    };
+
+    /**
+     * @brief Map-like read-only view of a JSON object, iterated in key order.
+     */
+    class DSINFER_EXPORT JsonObjectRef {
+    public:
+        using value_type = std::pair<std::string_view, JsonValueRef>;
+        using const_iterator = std::vector<value_type>::const_iterator;
+
+        JsonObjectRef();
+        ~JsonObjectRef();
+
+        JsonObjectRef(const JsonObjectRef &other);
+        JsonObjectRef &operator=(const JsonObjectRef &other);
+
+        JsonObjectRef(JsonObjectRef &&other) noexcept;
+        JsonObjectRef &operator=(JsonObjectRef &&other) noexcept;
+
+        inline size_t size() const {
+            return _items.size();
+        }
+        inline bool empty() const {
+            return _items.empty();
+        }
+
+        const_iterator find(std::string_view key) const;
+        inline bool contains(std::string_view key) const {
+            return find(key) != end();
+        }
+        JsonValueRef operator[](std::string_view key) const;
+
+        inline const_iterator begin() const {
+            return _items.begin();
+        }
+        inline const_iterator end() const {
+            return _items.end();
+        }
+
+    protected:
+        std::vector<value_type> _items;
+
+        friend class JsonValueRef;
+    };
+
 }
 
 #endif // JSONVALUE_H
@@ -9,6 +9,15 @@ namespace dsinfer {
 
     InferenceDriver::~InferenceDriver() = default;
 
+    bool InferenceDriver::preload(const std::vector<std::filesystem::path> &paths,
+                                  const JsonValue &args, Error *error) {
+        return true;
+    }
+
+    bool InferenceDriver::executeCommand(const JsonValue &input, JsonValue *output) {
+        return false;
+    }
+
     namespace {
 
     }
@@ -1,6 +1,9 @@
 #ifndef INFERENCEDRIVER_H
 #define INFERENCEDRIVER_H
 
+#include <vector>
+#include <filesystem>
+
 #include <dsinfer/error.h>
 #include <dsinfer/inferencesession.h>
 #include <dsinfer/inferencetask.h>
@@ -20,6 +23,16 @@ namespace dsinfer {
         virtual InferenceTask *createTask() = 0;
         virtual InferenceContext *createContext() = 0;
 
+        // Starts loading the models in the background and returns at once, so that the
+        // sessions opening them later with the same `args` find them loaded. Does nothing by
+        // default
+        virtual bool preload(const std::vector<std::filesystem::path> &paths,
+                             const JsonValue &args, Error *error);
+
+        // Runs a command of the driver, such as querying its statistics, the supported commands
+        // are specific to each driver. Unsupported by default
+        virtual bool executeCommand(const JsonValue &input, JsonValue *output);
+
     public:
         STDCORELIB_DISABLE_COPY(InferenceDriver)
     };
@@ -15,4 +15,9 @@ namespace dsinfer {
         return false;
     }
 
+    std::vector<std::filesystem::path>
+        InferenceInterpreter::models(const InferenceSpec *spec) const {
+        return {};
+    }
+
 }
\ No newline at end of file
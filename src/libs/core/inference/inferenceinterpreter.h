@@ -1,6 +1,9 @@
 #ifndef INFERENCEINTERPRETER_H
 #define INFERENCEINTERPRETER_H
 
+#include <vector>
+#include <filesystem>
+
 #include <dsinfer/inferencespec.h>
 #include <dsinfer/inference.h>
 
@@ -18,6 +21,9 @@ namespace dsinfer {
         virtual bool validate(const InferenceSpec *spec, const JsonValue &importOptions,
                               std::string *message) const;
 
+        // The model files the inferences of `spec` open, for preloading. None by default
+        virtual std::vector<std::filesystem::path> models(const InferenceSpec *spec) const;
+
         virtual Inference *create(const InferenceSpec *spec, const JsonValue &options,
                                   Error *error) = 0;
 
@@ -0,0 +1,397 @@
+#include "batchscheduler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "onnxdriver_logger.h"
+#include "sessionimage.h"
+#include "tensorcopy.h"
+
+namespace dsinfer::onnxdriver {
+
+    // Interval at which waiting runs check whether all runs of their batch were terminated
+    static constexpr std::chrono::milliseconds kTerminationPollInterval{10};
+
+    // Stacked inputs that tell a model where the padding of each row starts, besides masks
+    static const char *const kLengthInputs[] = {"lengths", "durations"};
+
+    static std::vector<bool> stackedInputs(const SessionImage &image) {
+        std::vector<bool> stacked(image.inputNames.size());
+        for (size_t i = 0; i < stacked.size(); ++i) {
+            auto typeInfo = image.session.GetInputTypeInfo(i);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR) {
+                continue;
+            }
+            auto shape = typeInfo.GetTensorTypeAndShapeInfo().GetShape();
+            stacked[i] = !shape.empty() && shape[0] < 0;
+        }
+        return stacked;
+    }
+
+    struct BatchScheduler::Request {
+        const SharedValueMap *inputs = nullptr;
+        RunHandle *handle = nullptr;
+        int64_t rows = 0;
+        std::vector<std::vector<int64_t>> shapes; // by input index
+
+        SharedValueMap outputs;
+        Error error;
+    };
+
+    struct BatchScheduler::Batch {
+        std::vector<Request *> requests;
+        bool closed = false; // no more runs may join
+        bool finished = false;
+
+        // Terminated once every run of the batch is
+        RunHandle handle;
+    };
+
+    BatchScheduler::BatchScheduler(SessionImage &image, int maxSize,
+                                   std::chrono::microseconds window)
+        : m_image(image), m_maxSize(maxSize), m_window(window), m_stacked(stackedInputs(image)) {
+    }
+
+    BatchScheduler::~BatchScheduler() = default;
+
+    bool BatchScheduler::isBatchable(const SessionImage &image, std::string *reason) {
+        const auto setReason = [reason](const std::string &message) {
+            if (reason) {
+                *reason = message;
+            }
+            return false;
+        };
+
+        auto stacked = stackedInputs(image);
+        if (std::find(stacked.begin(), stacked.end(), true) == stacked.end()) {
+            return setReason("no input has a dynamic first axis");
+        }
+        bool padded = false;
+        bool masked = false;
+        for (size_t i = 0; i < image.inputNames.size(); ++i) {
+            const auto &name = image.inputNames[i];
+            auto typeInfo = image.session.GetInputTypeInfo(i);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR ||
+                elementSize(typeInfo.GetTensorTypeAndShapeInfo().GetElementType()) == 0) {
+                return setReason("input \"" + name + "\" is not a numeric tensor");
+            }
+            if (!stacked[i]) {
+                continue;
+            }
+            auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+            auto shape = tensorInfo.GetShape();
+            if (std::any_of(shape.begin() + 1, shape.end(), [](int64_t dim) { return dim < 0; })) {
+                padded = true;
+            }
+            if (tensorInfo.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL ||
+                std::find(std::begin(kLengthInputs), std::end(kLengthInputs), name) !=
+                    std::end(kLengthInputs)) {
+                masked = true;
+            }
+        }
+        if (padded && !masked) {
+            return setReason("no mask or lengths input tells the model where the padding is");
+        }
+
+        // Every axis of an output must be known to cut it back for each run
+        for (size_t i = 0; i < image.outputInfos.size(); ++i) {
+            const auto &info = image.outputInfos[i];
+            const auto &name = image.outputNames[i];
+            if (!info.derivable || info.dims.empty() || elementSize(info.type) == 0) {
+                return setReason("the shape of output \"" + name +
+                                 "\" doesn't follow from the input shapes");
+            }
+            const auto &first = info.dims[0];
+            if (first.input < 0 || !stacked[first.input] || first.axis != 0) {
+                return setReason("the first axis of output \"" + name +
+                                 "\" is not the first axis of a stacked input");
+            }
+            for (size_t j = 1; j < info.dims.size(); ++j) {
+                const auto &dim = info.dims[j];
+                if (dim.input >= 0 && stacked[dim.input] && dim.axis == 0) {
+                    return setReason("output \"" + name + "\" has the batch axis at " +
+                                     std::to_string(j));
+                }
+            }
+        }
+        return true;
+    }
+
+    bool BatchScheduler::isCompatible(const Batch &batch, const Request &request) const {
+        if (batch.closed || batch.requests.size() >= size_t(m_maxSize)) {
+            return false;
+        }
+        const auto &first = *batch.requests.front();
+        const auto &inputNames = m_image.inputNames;
+        for (size_t i = 0; i < inputNames.size(); ++i) {
+            const auto &a = *first.inputs->at(inputNames[i]);
+            const auto &b = *request.inputs->at(inputNames[i]);
+            if (a.GetTensorTypeAndShapeInfo().GetElementType() !=
+                b.GetTensorTypeAndShapeInfo().GetElementType()) {
+                return false;
+            }
+            const auto &shapeA = first.shapes[i];
+            const auto &shapeB = request.shapes[i];
+            if (m_stacked[i]) {
+                if (shapeA.size() != shapeB.size()) {
+                    return false;
+                }
+                continue;
+            }
+            // Inputs that are not stacked are given once for the whole batch
+            if (shapeA != shapeB) {
+                return false;
+            }
+            auto size = a.GetTensorSizeInBytes();
+            if (size != b.GetTensorSizeInBytes() ||
+                (size > 0 &&
+                 std::memcmp(a.GetTensorRawData(), b.GetTensorRawData(), size) != 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool BatchScheduler::run(const SharedValueMap &inputs, RunHandle &handle,
+                             SharedValueMap &outputs, Error *error) {
+        if (m_maxSize <= 1) {
+            return false;
+        }
+
+        // The stacked inputs of a run must agree on its number of rows
+        Request request;
+        request.inputs = &inputs;
+        request.handle = &handle;
+        request.rows = -1;
+        const auto &inputNames = m_image.inputNames;
+        request.shapes.resize(inputNames.size());
+        for (size_t i = 0; i < inputNames.size(); ++i) {
+            const auto &value = *inputs.at(inputNames[i]);
+            if (!value.IsTensor()) {
+                return false;
+            }
+            auto tensorInfo = value.GetTensorTypeAndShapeInfo();
+            if (elementSize(tensorInfo.GetElementType()) == 0) {
+                return false;
+            }
+            auto &shape = request.shapes[i];
+            shape = tensorInfo.GetShape();
+            if (!m_stacked[i]) {
+                continue;
+            }
+            if (shape.empty() || shape[0] <= 0 ||
+                (request.rows >= 0 && shape[0] != request.rows)) {
+                return false;
+            }
+            request.rows = shape[0];
+        }
+        if (request.rows <= 0) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_collecting && isCompatible(*m_collecting, request)) {
+            auto batch = m_collecting;
+            batch->requests.push_back(&request);
+            if (batch->requests.size() >= size_t(m_maxSize)) {
+                batch->closed = true;
+                m_collecting.reset();
+                m_cv.notify_all();
+            }
+            waitForBatch(lock, *batch, request);
+        } else {
+            // Nothing to wait for if no other run is in flight on the image
+            if (m_image.activeRuns <= 1) {
+                return false;
+            }
+
+            // A batch that can't take this run stops collecting, this run leads a new one
+            if (m_collecting) {
+                m_collecting->closed = true;
+                m_cv.notify_all();
+            }
+            auto batch = std::make_shared<Batch>();
+            batch->requests.push_back(&request);
+            m_collecting = batch;
+
+            m_cv.wait_for(lock, m_window, [&batch] { return batch->closed; });
+            batch->closed = true;
+            if (m_collecting == batch) {
+                m_collecting.reset();
+            }
+            if (batch->requests.size() == 1) {
+                return false;
+            }
+
+            lock.unlock();
+            execute(*batch);
+            lock.lock();
+            batch->finished = true;
+            m_cv.notify_all();
+        }
+
+        if (!request.error.ok()) {
+            if (error) {
+                *error = std::move(request.error);
+            }
+            outputs.clear();
+            return true;
+        }
+        outputs = std::move(request.outputs);
+        return true;
+    }
+
+    void BatchScheduler::waitForBatch(std::unique_lock<std::mutex> &lock, Batch &batch,
+                                      Request &request) {
+        // The run leading the batch is busy running it, the others cancel it if they all
+        // were terminated
+        while (!m_cv.wait_for(lock, kTerminationPollInterval,
+                              [&batch] { return batch.finished; })) {
+            if (!batch.closed || batch.handle.isTerminated()) {
+                continue;
+            }
+            if (std::all_of(batch.requests.begin(), batch.requests.end(),
+                            [](const Request *r) { return r->handle->isTerminated(); })) {
+                batch.handle.terminate();
+            }
+        }
+    }
+
+    void BatchScheduler::execute(Batch &batch) {
+        const auto &inputNames = m_image.inputNames;
+        const auto &outputNames = m_image.outputNames;
+
+        // Runs terminated while the batch was collecting are left out
+        std::vector<Request *> requests;
+        for (auto request : batch.requests) {
+            if (request->handle->isTerminated()) {
+                request->error = Error(Error::SessionError, "Run was terminated");
+            } else {
+                requests.push_back(request);
+            }
+        }
+        if (requests.empty()) {
+            return;
+        }
+
+        const auto fail = [&requests](const std::string &message) {
+            for (auto request : requests) {
+                request->error = Error(Error::SessionError, message);
+            }
+        };
+
+        int64_t totalRows = 0;
+        for (auto request : requests) {
+            totalRows += request->rows;
+        }
+
+        try {
+            Ort::AllocatorWithDefaultOptions allocator;
+            Ort::IoBinding binding(m_image.session);
+
+            // Stacked inputs are padded with zeros to the longest run on every other axis
+            std::vector<Ort::Value> stackedValues;
+            for (size_t i = 0; i < inputNames.size(); ++i) {
+                const auto &name = inputNames[i];
+                const auto &first = *requests.front()->inputs->at(name);
+                if (!m_stacked[i]) {
+                    binding.BindInput(name.c_str(), first);
+                    continue;
+                }
+
+                auto type = first.GetTensorTypeAndShapeInfo().GetElementType();
+                auto shape = requests.front()->shapes[i];
+                shape[0] = totalRows;
+                for (auto request : requests) {
+                    const auto &runShape = request->shapes[i];
+                    for (size_t j = 1; j < shape.size(); ++j) {
+                        shape[j] = std::max(shape[j], runShape[j]);
+                    }
+                }
+
+                auto value = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), type);
+                auto dst = static_cast<char *>(value.GetTensorMutableRawData());
+                std::memset(dst, 0, value.GetTensorSizeInBytes());
+
+                auto size = elementSize(type);
+                auto dstStrides = byteStrides(shape, size);
+                int64_t row = 0;
+                for (auto request : requests) {
+                    const auto &runShape = request->shapes[i];
+                    const auto &runValue = *request->inputs->at(name);
+                    if (std::find(runShape.begin(), runShape.end(), 0) == runShape.end()) {
+                        copyBlock(static_cast<const char *>(runValue.GetTensorRawData()),
+                                  byteStrides(runShape, size).data(),
+                                  dst + row * dstStrides[0], dstStrides.data(), runShape.data(),
+                                  shape.size());
+                    }
+                    row += request->rows;
+                }
+                binding.BindInput(name.c_str(), value);
+                stackedValues.push_back(std::move(value));
+            }
+
+            auto memInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+            for (const auto &name : outputNames) {
+                binding.BindOutput(name.c_str(), memInfo);
+            }
+
+            onnxdriver_log().debug("BatchScheduler - Running %1 runs with %2 rows in a batch",
+                                   requests.size(), totalRows);
+            m_image.session.Run(batch.handle.runOptions(), binding);
+            auto outputValues = binding.GetOutputValues();
+
+            // Each run gets its rows, cut to the lengths of its own inputs
+            for (size_t i = 0; i < outputValues.size(); ++i) {
+                const auto &value = outputValues[i];
+                const auto &info = m_image.outputInfos[i];
+                auto tensorInfo = value.GetTensorTypeAndShapeInfo();
+                auto shape = tensorInfo.GetShape();
+                if (shape.size() != info.dims.size() || shape[0] != totalRows) {
+                    fail("Output \"" + outputNames[i] + "\" of the batch has an unexpected shape");
+                    return;
+                }
+
+                auto size = elementSize(tensorInfo.GetElementType());
+                auto srcStrides = byteStrides(shape, size);
+                auto src = static_cast<const char *>(value.GetTensorRawData());
+                int64_t row = 0;
+                for (auto request : requests) {
+                    std::vector<int64_t> runShape(shape.size());
+                    runShape[0] = request->rows;
+                    for (size_t j = 1; j < shape.size(); ++j) {
+                        const auto &dim = info.dims[j];
+                        runShape[j] = shape[j];
+                        if (dim.input >= 0 && m_stacked[dim.input]) {
+                            runShape[j] =
+                                std::min(shape[j], request->shapes[dim.input][dim.axis]);
+                        }
+                    }
+
+                    auto runValue = Ort::Value::CreateTensor(allocator, runShape.data(),
+                                                             runShape.size(),
+                                                             tensorInfo.GetElementType());
+                    if (std::find(runShape.begin(), runShape.end(), 0) == runShape.end()) {
+                        copyBlock(src + row * srcStrides[0], srcStrides.data(),
+                                  static_cast<char *>(runValue.GetTensorMutableRawData()),
+                                  byteStrides(runShape, size).data(), runShape.data(),
+                                  runShape.size());
+                    }
+                    request->outputs.emplace(outputNames[i], makeSharedValue(std::move(runValue)));
+                    row += request->rows;
+                }
+            }
+        } catch (const Ort::Exception &err) {
+            fail(err.what());
+            return;
+        }
+
+        for (auto request : requests) {
+            if (request->handle->isTerminated()) {
+                request->outputs.clear();
+                request->error = Error(Error::SessionError, "Run was terminated");
+            }
+        }
+    }
+
+}
@@ -0,0 +1,71 @@
+#ifndef DSINFER_ONNXDRIVER_BATCHSCHEDULER_H
+#define DSINFER_ONNXDRIVER_BATCHSCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dsinfer/error.h>
+
+#include <onnxruntime_cxx_api.h>
+
+#include "valuemap.h"
+#include "runhandle.h"
+
+namespace dsinfer::onnxdriver {
+
+    class SessionImage;
+
+    // Stacks concurrent runs of a session image along the first axis and runs them at once.
+    //
+    // The first run of a batch waits up to the window for others, unless it is the only run of
+    // the image. Inputs whose first axis is dynamic are stacked, after padding their other axes
+    // with zeros to the longest run, so that masks and durations of the padding are false or
+    // empty. A model whose inputs may be padded must take such a mask, or the lengths of the
+    // runs, otherwise it is not batched. The other inputs, like the steps,
+    // must be equal in all runs of a batch. Every output is cut back to the rows of each run and
+    // to the lengths of its own inputs, following the symbolic dimensions of the model.
+    class BatchScheduler {
+    public:
+        BatchScheduler(SessionImage &image, int maxSize, std::chrono::microseconds window);
+        ~BatchScheduler();
+
+        BatchScheduler(const BatchScheduler &) = delete;
+        BatchScheduler &operator=(const BatchScheduler &) = delete;
+
+        // Whether the inputs and outputs of the model allow batching, otherwise `reason` is set
+        static bool isBatchable(const SessionImage &image, std::string *reason = nullptr);
+
+    public:
+        // Runs `inputs` in a batch with other runs and returns true, or returns false at once if
+        // they run alone, which the caller then does as usual. The inputs must be validated
+        bool run(const SharedValueMap &inputs, RunHandle &handle, SharedValueMap &outputs,
+                 Error *error);
+
+    protected:
+        struct Request;
+        struct Batch;
+
+        int64_t rowCount(const SharedValueMap &inputs) const;
+        bool isCompatible(const Batch &batch, const Request &request) const;
+        void execute(Batch &batch);
+        void waitForBatch(std::unique_lock<std::mutex> &lock, Batch &batch, Request &request);
+
+        SessionImage &m_image;
+        int m_maxSize;
+        std::chrono::microseconds m_window;
+
+        // By input index, whether it is stacked or must be equal in the whole batch
+        std::vector<bool> m_stacked;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::shared_ptr<Batch> m_collecting; // the batch accepting runs, if any
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_BATCHSCHEDULER_H
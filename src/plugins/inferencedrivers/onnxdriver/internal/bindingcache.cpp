@@ -0,0 +1,211 @@
+#include "bindingcache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "sessionimage.h"
+
+namespace dsinfer::onnxdriver {
+
+    // Inputs up to this size are compared with the previous run to skip binding them again
+    static constexpr size_t kMaxCachedInputSize = 256;
+
+    BindingCache::BindingCache(SessionImage &image)
+        : m_image(image), m_binding(image.session),
+          m_memInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
+          m_inputShapes(image.inputNames.size()), m_pool(image.outputNames.size()),
+          m_boundOutputs(image.outputNames.size()), m_retryShapes(image.outputNames.size()) {
+    }
+
+    BindingCache::~BindingCache() = default;
+
+    void BindingCache::bindInput(const std::string &name, const Ort::Value &value) {
+        const auto &inputNames = m_image.inputNames;
+        auto index = size_t(std::find(inputNames.begin(), inputNames.end(), name) -
+                            inputNames.begin());
+        if (index >= inputNames.size() || !value.IsTensor()) {
+            if (index < inputNames.size()) {
+                m_inputShapes[index].clear();
+            }
+            m_inputs.erase(name);
+            m_binding.BindInput(name.c_str(), value);
+            return;
+        }
+
+        auto info = value.GetTensorTypeAndShapeInfo();
+        auto &shape = m_inputShapes[index];
+        shape = info.GetShape();
+
+        auto type = info.GetElementType();
+        size_t size = 0;
+        if (type == ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING ||
+            (size = value.GetTensorSizeInBytes()) > kMaxCachedInputSize) {
+            m_inputs.erase(name);
+            m_binding.BindInput(name.c_str(), value);
+            return;
+        }
+
+        auto data = static_cast<const char *>(value.GetTensorRawData());
+        auto &cached = m_inputs[name];
+        if (cached.value && cached.type == type && cached.shape == shape &&
+            cached.data.size() == size &&
+            (size == 0 || std::memcmp(cached.data.data(), data, size) == 0)) {
+            return;
+        }
+
+        // Bind a private copy, the memory of the caller may be gone by the next run
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto copy = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), type);
+        if (size > 0) {
+            std::memcpy(copy.GetTensorMutableRawData(), data, size);
+        }
+        m_binding.BindInput(name.c_str(), copy);
+
+        cached.type = type;
+        cached.shape = shape;
+        cached.data.assign(data, data + size);
+        cached.value = std::move(copy);
+    }
+
+    bool BindingCache::deriveShape(size_t outputIndex, std::vector<int64_t> &shape) const {
+        const auto &info = m_image.outputInfos[outputIndex];
+        if (!info.derivable) {
+            return false;
+        }
+        shape.resize(info.dims.size());
+        for (size_t i = 0; i < info.dims.size(); ++i) {
+            const auto &dim = info.dims[i];
+            if (dim.input < 0) {
+                shape[i] = dim.size;
+                continue;
+            }
+            const auto &inputShape = m_inputShapes[dim.input];
+            if (size_t(dim.axis) >= inputShape.size() || inputShape[dim.axis] < 0) {
+                return false;
+            }
+            shape[i] = inputShape[dim.axis];
+        }
+        return true;
+    }
+
+    void BindingCache::bindOutputs(const SharedValueMap *outputBuffers, bool pooled) {
+        const auto &outputNames = m_image.outputNames;
+        for (size_t i = 0; i < outputNames.size(); ++i) {
+            const auto &name = outputNames[i];
+            auto &bound = m_boundOutputs[i];
+            if (outputBuffers) {
+                if (auto it = outputBuffers->find(name);
+                    it != outputBuffers->end() && it->second) {
+                    m_binding.BindOutput(name.c_str(), *it->second);
+                    bound = it->second;
+                    continue;
+                }
+            }
+
+            if (pooled && m_preallocate && deriveShape(i, m_shape)) {
+                // Reused only if nobody else holds the tensor of the previous run
+                auto &entry = m_pool[i];
+                if (!entry.value || entry.value.use_count() != 1 || entry.shape != m_shape) {
+                    Ort::AllocatorWithDefaultOptions allocator;
+                    entry.value = makeSharedValue(Ort::Value::CreateTensor(
+                        allocator, m_shape.data(), m_shape.size(), m_image.outputInfos[i].type));
+                    entry.shape = m_shape;
+                }
+                m_binding.BindOutput(name.c_str(), *entry.value);
+                bound = entry.value;
+                continue;
+            }
+
+            m_binding.BindOutput(name.c_str(), m_memInfo);
+            bound.reset();
+        }
+    }
+
+    bool BindingCache::hasPreallocatedOutputs() const {
+        for (size_t i = 0; i < m_boundOutputs.size(); ++i) {
+            if (m_boundOutputs[i] && m_boundOutputs[i] == m_pool[i].value) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void BindingCache::unbindPreallocatedOutputs() {
+        const auto &outputNames = m_image.outputNames;
+        for (size_t i = 0; i < outputNames.size(); ++i) {
+            auto &bound = m_boundOutputs[i];
+            if (bound && bound == m_pool[i].value) {
+                m_retryShapes[i] = m_pool[i].shape;
+                m_binding.BindOutput(outputNames[i].c_str(), m_memInfo);
+                bound.reset();
+            }
+        }
+    }
+
+    bool BindingCache::preallocatedShapesDiffer() {
+        auto outputValues = m_binding.GetOutputValues();
+        bool differ = false;
+        for (size_t i = 0; i < outputValues.size() && i < m_retryShapes.size(); ++i) {
+            auto &shape = m_retryShapes[i];
+            if (!shape.empty() && outputValues[i].IsTensor() &&
+                outputValues[i].GetTensorTypeAndShapeInfo().GetShape() != shape) {
+                differ = true;
+            }
+            shape.clear();
+        }
+        return differ;
+    }
+
+    void BindingCache::disablePreallocation() {
+        m_preallocate = false;
+        for (auto &entry : m_pool) {
+            entry = {};
+        }
+    }
+
+    ValueMap BindingCache::takeOutputs() {
+        const auto &outputNames = m_image.outputNames;
+        auto outputValues = m_binding.GetOutputValues();
+        m_binding.ClearBoundOutputs();
+
+        ValueMap outValueMap;
+        for (size_t i = 0; i < outputValues.size(); ++i) {
+            outValueMap.emplace(outputNames[i], std::move(outputValues[i]));
+            m_boundOutputs[i].reset();
+        }
+        return outValueMap;
+    }
+
+    SharedValueMap BindingCache::takeSharedOutputs() {
+        const auto &outputNames = m_image.outputNames;
+        auto outputValues = m_binding.GetOutputValues();
+        m_binding.ClearBoundOutputs();
+
+        // Preallocated outputs are returned as they are, so that the pool sees who uses them
+        SharedValueMap outValueMap;
+        for (size_t i = 0; i < outputValues.size(); ++i) {
+            auto &bound = m_boundOutputs[i];
+            outValueMap.emplace(outputNames[i],
+                                bound ? std::move(bound)
+                                      : makeSharedValue(std::move(outputValues[i])));
+        }
+        return outValueMap;
+    }
+
+    void BindingCache::clear() {
+        m_binding.ClearBoundInputs();
+        m_binding.ClearBoundOutputs();
+        m_inputs.clear();
+        for (auto &bound : m_boundOutputs) {
+            bound.reset();
+        }
+        for (auto &shape : m_retryShapes) {
+            shape.clear();
+        }
+    }
+
+    Ort::IoBinding &BindingCache::binding() {
+        return m_binding;
+    }
+
+}
@@ -0,0 +1,89 @@
+#ifndef DSINFER_ONNXDRIVER_BINDINGCACHE_H
+#define DSINFER_ONNXDRIVER_BINDINGCACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+#include "valuemap.h"
+
+namespace dsinfer::onnxdriver {
+
+    class SessionImage;
+
+    // Keeps the IoBinding of a session between runs. Small inputs that repeat, like the steps
+    // or the speedup, stay bound to a private copy, and outputs whose shapes follow from the
+    // input shapes are written into pooled tensors, reused once the caller has released them.
+    class BindingCache {
+    public:
+        explicit BindingCache(SessionImage &image);
+        ~BindingCache();
+
+        BindingCache(const BindingCache &) = delete;
+        BindingCache &operator=(const BindingCache &) = delete;
+
+    public:
+        // Other inputs may refer to memory of the caller, they are bound again on every run
+        void bindInput(const std::string &name, const Ort::Value &value);
+
+        // Binds each output to `outputBuffers` if it has one, to a pooled tensor if `pooled`
+        // and its shape is known, otherwise to memory allocated by onnxruntime during the run
+        void bindOutputs(const SharedValueMap *outputBuffers, bool pooled);
+
+        // Whether the bound outputs include pooled tensors, which fail the run if the shape
+        // declared by the model is wrong
+        bool hasPreallocatedOutputs() const;
+
+        // Binds the pooled outputs to memory allocated by onnxruntime, to retry a failed run
+        void unbindPreallocatedOutputs();
+
+        // Whether the retried run produced another shape than the pooled tensor of an output,
+        // in which case preallocation should be disabled
+        bool preallocatedShapesDiffer();
+
+        void disablePreallocation();
+
+        // Take the outputs of the last run and unbind them
+        ValueMap takeOutputs();
+        SharedValueMap takeSharedOutputs();
+
+        // Forgets everything bound, after a failed run
+        void clear();
+
+        Ort::IoBinding &binding();
+
+    protected:
+        struct CachedInput {
+            ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+            std::vector<int64_t> shape;
+            std::vector<char> data;
+            Ort::Value value{nullptr};
+        };
+
+        struct PooledOutput {
+            std::vector<int64_t> shape;
+            std::shared_ptr<Ort::Value> value;
+        };
+
+        bool deriveShape(size_t outputIndex, std::vector<int64_t> &shape) const;
+
+        SessionImage &m_image;
+        Ort::IoBinding m_binding;
+        Ort::MemoryInfo m_memInfo;
+        bool m_preallocate = true;
+
+        std::map<std::string, CachedInput> m_inputs;
+        std::vector<std::vector<int64_t>> m_inputShapes; // by input index, for this run
+
+        std::vector<PooledOutput> m_pool;                       // by output index
+        std::vector<std::shared_ptr<Ort::Value>> m_boundOutputs; // by output index, this run
+        std::vector<std::vector<int64_t>> m_retryShapes;        // of unbound pooled outputs
+        std::vector<int64_t> m_shape;
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_BINDINGCACHE_H
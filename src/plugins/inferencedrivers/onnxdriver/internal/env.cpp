@@ -1,6 +1,9 @@
 #include "env.h"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 #include <stdcorelib/strings.h>
@@ -16,9 +19,32 @@ namespace dsinfer::onnxdriver {
 
     static Env *g_env = nullptr;
 
+    static void loggingFuncOrt(void *param, OrtLoggingLevel severity, const char *category,
+                               const char *logid, const char *code_location, const char *message) {
+        int log_level = Log::Information;
+        switch (severity) {
+            case ORT_LOGGING_LEVEL_VERBOSE:
+                log_level = Log::Verbose;
+                break;
+            case ORT_LOGGING_LEVEL_WARNING:
+                log_level = Log::Warning;
+                break;
+            case ORT_LOGGING_LEVEL_ERROR:
+                log_level = Log::Critical;
+                break;
+            case ORT_LOGGING_LEVEL_FATAL:
+                log_level = Log::Fatal;
+                break;
+            default:
+                break;
+        }
+        Log::Category("onnxruntime").log(log_level, "[%1] %2", code_location, message);
+    }
+
     class Env::Impl {
     public:
-        bool load(const fs::path &path, ExecutionProvider ep, std::string *errorMessage) {
+        bool load(const fs::path &path, ExecutionProvider ep,
+                  const ThreadPoolOptions &threadPoolOptions, std::string *errorMessage) {
             onnxdriver_log().info("Env - Loading onnx environment");
 
             stdc::Library dylib;
@@ -77,12 +103,39 @@ namespace dsinfer::onnxdriver {
              */
             Ort::InitApi(api);
 
+            /**
+             *  5. Create the environment with the thread pools shared by all sessions
+             */
+            try {
+                Ort::ThreadingOptions threadingOptions;
+                threadingOptions.SetGlobalIntraOpNumThreads(threadPoolOptions.intraOpThreads);
+                threadingOptions.SetGlobalInterOpNumThreads(threadPoolOptions.interOpThreads);
+                threadingOptions.SetGlobalSpinControl(threadPoolOptions.allowSpinning ? 1 : 0);
+                if (threadPoolOptions.denormalAsZero) {
+                    threadingOptions.SetGlobalDenormalAsZero();
+                }
+                ortEnv = Ort::Env(threadingOptions, loggingFuncOrt, nullptr,
+                                  ORT_LOGGING_LEVEL_WARNING, "flowonnx");
+            } catch (const Ort::Exception &e) {
+                std::string msg = stdc::formatN("Failed to create environment: %1", e.what());
+                onnxdriver_log().critical("Env - %1", msg);
+                if (errorMessage) {
+                    *errorMessage = std::move(msg);
+                }
+                return false;
+            }
+            onnxdriver_log().debug(
+                "Env - Global thread pools: intra-op %1, inter-op %2, spinning %3",
+                threadPoolOptions.intraOpThreads, threadPoolOptions.interOpThreads,
+                threadPoolOptions.allowSpinning);
+
             std::swap(lib, dylib);
             loaded = true;
             ortPath = path;
             executionProvider = ep;
             ortApiBase = apiBase;
             ortApi = api;
+            this->threadPoolOptions = threadPoolOptions;
 
             onnxdriver_log().info("Env - Load successful");
             return true;
@@ -90,11 +143,33 @@ namespace dsinfer::onnxdriver {
 
         stdc::Library lib;
 
+        // Declared after the library so that it is released before the library is unloaded
+        Ort::Env ortEnv{nullptr};
+        ThreadPoolOptions threadPoolOptions;
+
         // Metadata
         bool loaded = false;
         fs::path ortPath;
         ExecutionProvider executionProvider = EP_CPU;
         int deviceIndex = 0;
+        SessionConfig defaultSessionConfig;
+        FingerprintAlgorithm fingerprintAlgorithm = FA_XXH3Tree;
+        fs::path cacheDirectory;
+        bool modelCacheEnabled = true;
+        int mmapAdvice = 0;
+
+        int executorWorkers = 0;
+        int executorQueueCapacity = 64;
+
+        // Declared after the environment so that pending tasks finish before it is released
+        std::unique_ptr<TaskExecutor> executor;
+        std::mutex executorMutex;
+
+        int batchMaxSize = 8;
+        std::chrono::microseconds batchWindow{2000};
+
+        int64_t idleCacheBytes = 0;
+        std::chrono::seconds idleCacheTtl{300};
 
         // Library data
         void *hLibrary = nullptr;
@@ -110,7 +185,8 @@ namespace dsinfer::onnxdriver {
         g_env = nullptr;
     }
 
-    bool Env::load(const fs::path &path, ExecutionProvider ep, std::string *errorMessage) {
+    bool Env::load(const fs::path &path, ExecutionProvider ep,
+                   const ThreadPoolOptions &threadPoolOptions, std::string *errorMessage) {
         __stdc_impl_t;
         if (impl.loaded) {
             std::string msg = stdc::formatN(R"(Library "%1" has been loaded [%2])", impl.ortPath, path);
@@ -120,7 +196,7 @@ namespace dsinfer::onnxdriver {
             }
             return false;
         }
-        return impl.load(path, ep, errorMessage);
+        return impl.load(path, ep, threadPoolOptions, errorMessage);
     }
 
     bool Env::isLoaded() const {
@@ -142,6 +218,16 @@ namespace dsinfer::onnxdriver {
         return impl.executionProvider;
     }
 
+    Ort::Env &Env::ortEnv() const {
+        __stdc_impl_t;
+        return impl.ortEnv;
+    }
+
+    ThreadPoolOptions Env::threadPoolOptions() const {
+        __stdc_impl_t;
+        return impl.threadPoolOptions;
+    }
+
     int Env::deviceIndex() const {
         __stdc_impl_t;
         return impl.deviceIndex;
@@ -152,6 +238,110 @@ namespace dsinfer::onnxdriver {
         impl.deviceIndex = deviceIndex;
     }
 
+    SessionConfig Env::defaultSessionConfig() const {
+        __stdc_impl_t;
+        return impl.defaultSessionConfig;
+    }
+
+    void Env::setDefaultSessionConfig(const SessionConfig &config) {
+        __stdc_impl_t;
+        impl.defaultSessionConfig = config;
+    }
+
+    FingerprintAlgorithm Env::fingerprintAlgorithm() const {
+        __stdc_impl_t;
+        return impl.fingerprintAlgorithm;
+    }
+
+    void Env::setFingerprintAlgorithm(FingerprintAlgorithm algorithm) {
+        __stdc_impl_t;
+        impl.fingerprintAlgorithm = algorithm;
+    }
+
+    fs::path Env::cacheDirectory() const {
+        __stdc_impl_t;
+        return impl.cacheDirectory;
+    }
+
+    void Env::setCacheDirectory(const fs::path &dir) {
+        __stdc_impl_t;
+        impl.cacheDirectory = dir;
+    }
+
+    int Env::mmapAdvice() const {
+        __stdc_impl_t;
+        return impl.mmapAdvice;
+    }
+
+    void Env::setMmapAdvice(int advice) {
+        __stdc_impl_t;
+        impl.mmapAdvice = advice;
+    }
+
+    bool Env::modelCacheEnabled() const {
+        __stdc_impl_t;
+        return impl.modelCacheEnabled;
+    }
+
+    void Env::setModelCacheEnabled(bool enabled) {
+        __stdc_impl_t;
+        impl.modelCacheEnabled = enabled;
+    }
+
+    void Env::setExecutorOptions(int workerCount, int queueCapacity) {
+        __stdc_impl_t;
+        std::lock_guard<std::mutex> lock(impl.executorMutex);
+        impl.executorWorkers = workerCount;
+        impl.executorQueueCapacity = queueCapacity;
+    }
+
+    TaskExecutor *Env::executor() {
+        __stdc_impl_t;
+        std::lock_guard<std::mutex> lock(impl.executorMutex);
+        if (!impl.executor) {
+            int workers = impl.executorWorkers;
+            if (workers <= 0) {
+                workers = int(std::max(std::thread::hardware_concurrency(), 1u));
+            }
+            onnxdriver_log().debug("Env - Starting task executor: %1 workers, queue size %2",
+                                   workers, impl.executorQueueCapacity);
+            impl.executor = std::make_unique<TaskExecutor>(workers, impl.executorQueueCapacity);
+        }
+        return impl.executor.get();
+    }
+
+    int Env::batchMaxSize() const {
+        __stdc_impl_t;
+        return impl.batchMaxSize;
+    }
+
+    std::chrono::microseconds Env::batchWindow() const {
+        __stdc_impl_t;
+        return impl.batchWindow;
+    }
+
+    void Env::setBatchOptions(int maxSize, std::chrono::microseconds window) {
+        __stdc_impl_t;
+        impl.batchMaxSize = maxSize;
+        impl.batchWindow = window;
+    }
+
+    int64_t Env::idleCacheBytes() const {
+        __stdc_impl_t;
+        return impl.idleCacheBytes;
+    }
+
+    std::chrono::seconds Env::idleCacheTtl() const {
+        __stdc_impl_t;
+        return impl.idleCacheTtl;
+    }
+
+    void Env::setIdleCacheOptions(int64_t bytes, std::chrono::seconds ttl) {
+        __stdc_impl_t;
+        impl.idleCacheBytes = bytes;
+        impl.idleCacheTtl = ttl;
+    }
+
     std::string Env::versionString() const {
         __stdc_impl_t;
         return impl.ortApiBase ? impl.ortApiBase->GetVersionString() : std::string();
@@ -1,13 +1,27 @@
 #ifndef DSINFER_ONNXDRIVER_ENV_H
 #define DSINFER_ONNXDRIVER_ENV_H
 
+#include <chrono>
 #include <memory>
 #include <filesystem>
 
+#include <onnxruntime_cxx_api.h>
+
 #include "onnxdriver_common.h"
+#include "fingerprint.h"
+#include "sessionconfig.h"
+#include "taskexecutor.h"
 
 namespace dsinfer::onnxdriver {
 
+    // Sizes of the thread pools shared by all sessions, 0 lets onnxruntime decide
+    struct ThreadPoolOptions {
+        int intraOpThreads = 0;
+        int interOpThreads = 0;
+        bool allowSpinning = true;
+        bool denormalAsZero = false;
+    };
+
     class Env {
     public:
         Env();
@@ -19,15 +33,58 @@ namespace dsinfer::onnxdriver {
         static Env *instance();
     public:
         bool load(const std::filesystem::path &path, ExecutionProvider ep,
-                  std::string *errorMessage);
+                  const ThreadPoolOptions &threadPoolOptions, std::string *errorMessage);
         bool isLoaded() const;
 
         std::filesystem::path runtimePath() const;
         ExecutionProvider executionProvider() const;
 
+        // The only Ort::Env of the process, sessions must disable their own thread pools
+        Ort::Env &ortEnv() const;
+        ThreadPoolOptions threadPoolOptions() const;
+
         int deviceIndex() const;
         void setDeviceIndex(int deviceIndex);
-        
+
+        // Options of sessions opened without their own, overridden per session
+        SessionConfig defaultSessionConfig() const;
+        void setDefaultSessionConfig(const SessionConfig &config);
+
+        // Used to deduplicate sessions of identical models
+        FingerprintAlgorithm fingerprintAlgorithm() const;
+        void setFingerprintAlgorithm(FingerprintAlgorithm algorithm);
+
+        // Where model fingerprints are cached across runs, empty to always hash
+        std::filesystem::path cacheDirectory() const;
+        void setCacheDirectory(const std::filesystem::path &dir);
+
+        // MappedFile::Advice flags applied to mapped models
+        int mmapAdvice() const;
+        void setMmapAdvice(int advice);
+
+        // Whether optimized models are saved to and loaded from the cache directory
+        bool modelCacheEnabled() const;
+        void setModelCacheEnabled(bool enabled);
+
+        // Workers and queue size of the executor of asynchronous tasks, 0 workers uses one per
+        // CPU core. Takes effect if set before the executor is first used
+        void setExecutorOptions(int workerCount, int queueCapacity);
+
+        // Created on first use
+        TaskExecutor *executor();
+
+        // Concurrent runs of a batching session are stacked into batches of up to `maxSize`
+        // runs, a batch waits up to `window` for more runs after its first one
+        int batchMaxSize() const;
+        std::chrono::microseconds batchWindow() const;
+        void setBatchOptions(int maxSize, std::chrono::microseconds window);
+
+        // Unreferenced session images are kept for reuse up to an estimated total of `bytes`,
+        // each for up to `ttl` if not 0. A budget of 0, the default, destroys them at once
+        int64_t idleCacheBytes() const;
+        std::chrono::seconds idleCacheTtl() const;
+        void setIdleCacheOptions(int64_t bytes, std::chrono::seconds ttl);
+
         std::string versionString() const;
 
     protected:
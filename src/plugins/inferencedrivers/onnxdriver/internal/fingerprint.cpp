@@ -0,0 +1,107 @@
+#include "fingerprint.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <hash-library/sha256.h>
+
+#include <xxhash.h>
+
+#include "mappedfile.h"
+
+namespace fs = std::filesystem;
+
+namespace dsinfer::onnxdriver {
+
+    // Part of the digest definition, changing it changes every XXH3 tree digest
+    static constexpr const size_t kTreeChunkSize = 4 << 20;
+
+    const char *fingerprintAlgorithmName(FingerprintAlgorithm algorithm) {
+        switch (algorithm) {
+            case FA_SHA256:
+                return "sha256";
+            case FA_XXH3Tree:
+                return "xxh3-128-tree";
+        }
+        return "";
+    }
+
+    bool parseFingerprintAlgorithm(std::string_view name, FingerprintAlgorithm &algorithm) {
+        if (name == "sha256") {
+            algorithm = FA_SHA256;
+        } else if (name == "xxh3" || name == "xxh3-128-tree") {
+            algorithm = FA_XXH3Tree;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static std::vector<uint8_t> sha256(const uint8_t *data, size_t size) {
+        SHA256 sha256_ctx;
+        sha256_ctx.add(data, size);
+        std::vector<uint8_t> digest(32);
+        sha256_ctx.getHash(digest.data());
+        return digest;
+    }
+
+    static std::vector<uint8_t> xxh3Tree(const uint8_t *data, size_t size, int threads) {
+        size_t chunkCount = std::max<size_t>(1, (size + kTreeChunkSize - 1) / kTreeChunkSize);
+        std::vector<XXH128_canonical_t> leaves(chunkCount);
+
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t i; (i = next.fetch_add(1)) < chunkCount;) {
+                auto offset = i * kTreeChunkSize;
+                auto length = std::min(kTreeChunkSize, size - std::min(size, offset));
+                XXH128_canonicalFromHash(&leaves[i], XXH3_128bits(data + offset, length));
+            }
+        };
+
+        if (threads <= 0) {
+            threads = int(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        size_t workerCount = std::min(size_t(threads), chunkCount);
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount - 1);
+        for (size_t i = 1; i < workerCount; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+
+        // The root covers the chunk digests and the total size
+        XXH128_canonical_t root;
+        XXH128_canonicalFromHash(
+            &root, XXH3_128bits_withSeed(leaves.data(), leaves.size() * sizeof(leaves[0]),
+                                         XXH64_hash_t(size)));
+        return {std::begin(root.digest), std::end(root.digest)};
+    }
+
+    std::vector<uint8_t> fingerprint(const uint8_t *data, size_t size,
+                                     FingerprintAlgorithm algorithm, int threads) {
+        switch (algorithm) {
+            case FA_SHA256:
+                return sha256(data, size);
+            case FA_XXH3Tree:
+                return xxh3Tree(data, size, threads);
+        }
+        return {};
+    }
+
+    bool fingerprintFile(const fs::path &path, FingerprintAlgorithm algorithm,
+                         std::vector<uint8_t> &digest, int64_t &size, std::string *errorMessage,
+                         int threads) {
+        MappedFile file;
+        if (!file.open(path, errorMessage)) {
+            return false;
+        }
+        digest = fingerprint(file.data(), file.size(), algorithm, threads);
+        size = int64_t(file.size());
+        return true;
+    }
+
+}
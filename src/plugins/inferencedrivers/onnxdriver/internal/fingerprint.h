@@ -0,0 +1,34 @@
+#ifndef DSINFER_ONNXDRIVER_FINGERPRINT_H
+#define DSINFER_ONNXDRIVER_FINGERPRINT_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dsinfer::onnxdriver {
+
+    enum FingerprintAlgorithm {
+        // SHA256 of the content, sequential, for integrity checks
+        FA_SHA256,
+        // XXH3-128 over 4 MB chunks hashed in parallel, then over the chunk digests
+        FA_XXH3Tree,
+    };
+
+    const char *fingerprintAlgorithmName(FingerprintAlgorithm algorithm);
+
+    bool parseFingerprintAlgorithm(std::string_view name, FingerprintAlgorithm &algorithm);
+
+    // `threads` is only used by parallel algorithms, 0 means the number of cores
+    std::vector<uint8_t> fingerprint(const uint8_t *data, size_t size,
+                                     FingerprintAlgorithm algorithm, int threads = 0);
+
+    // Hashes the file through a read-only mapping
+    bool fingerprintFile(const std::filesystem::path &path, FingerprintAlgorithm algorithm,
+                         std::vector<uint8_t> &digest, int64_t &size,
+                         std::string *errorMessage = nullptr, int threads = 0);
+
+}
+
+#endif // DSINFER_ONNXDRIVER_FINGERPRINT_H
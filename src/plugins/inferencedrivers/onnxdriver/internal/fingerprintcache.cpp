@@ -0,0 +1,177 @@
+#include "fingerprintcache.h"
+
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/stat.h>
+#endif
+
+#include <hash-library/sha256.h>
+
+#include "onnxdriver_logger.h"
+
+namespace fs = std::filesystem;
+
+namespace dsinfer::onnxdriver {
+
+    static constexpr const char kEntryMagic[] = "dsinfer-fingerprint";
+    static constexpr const int kEntryVersion = 1;
+
+    std::string digestToHex(const std::vector<uint8_t> &bytes) {
+        static constexpr const char digits[] = "0123456789abcdef";
+        std::string result;
+        result.reserve(bytes.size() * 2);
+        for (const auto &byte : bytes) {
+            result.push_back(digits[byte >> 4]);
+            result.push_back(digits[byte & 0xf]);
+        }
+        return result;
+    }
+
+    static bool fromHex(const std::string &hex, std::vector<uint8_t> &bytes) {
+        auto value = [](char c) -> int {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            return -1;
+        };
+        if (hex.empty() || hex.size() % 2 != 0) {
+            return false;
+        }
+        bytes.resize(hex.size() / 2);
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            int hi = value(hex[2 * i]);
+            int lo = value(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            bytes[i] = uint8_t(hi << 4 | lo);
+        }
+        return true;
+    }
+
+    bool FileStamp::get(const fs::path &path, FileStamp &stamp) {
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        auto mtime = fs::last_write_time(path, ec);
+        if (ec) {
+            return false;
+        }
+        stamp.size = int64_t(size);
+        stamp.mtime = int64_t(mtime.time_since_epoch().count());
+
+#ifdef _WIN32
+        HANDLE handle = ::CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                      nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        BY_HANDLE_FILE_INFORMATION info;
+        bool ok = ::GetFileInformationByHandle(handle, &info);
+        ::CloseHandle(handle);
+        if (!ok) {
+            return false;
+        }
+        stamp.device = info.dwVolumeSerialNumber;
+        stamp.inode = uint64_t(info.nFileIndexHigh) << 32 | info.nFileIndexLow;
+#else
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        stamp.device = uint64_t(st.st_dev);
+        stamp.inode = uint64_t(st.st_ino);
+#endif
+        return true;
+    }
+
+    FingerprintCache::FingerprintCache(fs::path dir) : m_dir(std::move(dir)) {
+    }
+
+    fs::path FingerprintCache::entryPath(const fs::path &path) const {
+        auto key = path.u8string();
+        SHA256 sha256_ctx;
+        sha256_ctx.add(key.data(), key.size());
+        return m_dir / (sha256_ctx.getHash() + ".fp");
+    }
+
+    bool FingerprintCache::find(const fs::path &path, const FileStamp &stamp,
+                                const std::string &algorithm, std::vector<uint8_t> &digest) const {
+        std::ifstream file(entryPath(path), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        std::string magic;
+        int version = 0;
+        std::string entryPathString;
+        FileStamp entryStamp;
+        std::string entryAlgorithm;
+        std::string hex;
+        std::getline(file, magic, ' ');
+        file >> version >> entryStamp.device >> entryStamp.inode >> entryStamp.size >>
+            entryStamp.mtime >> entryAlgorithm >> hex;
+        file.get(); // newline
+        std::getline(file, entryPathString);
+        if (!file || magic != kEntryMagic || version != kEntryVersion) {
+            return false;
+        }
+
+        // The name is a hash of the path, compare the path itself as well
+        if (entryPathString != path.u8string() || entryStamp != stamp ||
+            entryAlgorithm != algorithm) {
+            return false;
+        }
+        return fromHex(hex, digest);
+    }
+
+    bool FingerprintCache::insert(const fs::path &path, const FileStamp &stamp,
+                                  const std::string &algorithm,
+                                  const std::vector<uint8_t> &digest) const {
+        std::error_code ec;
+        fs::create_directories(m_dir, ec);
+
+        std::ostringstream content;
+        content << kEntryMagic << ' ' << kEntryVersion << ' ' << stamp.device << ' ' << stamp.inode
+                << ' ' << stamp.size << ' ' << stamp.mtime << ' ' << algorithm << ' '
+                << digestToHex(digest) << '\n'
+                << path.u8string() << '\n';
+
+        // Write a private file and rename it over the entry, readers in other processes see
+        // either the old or the new entry but never a partial one
+        auto target = entryPath(path);
+        auto temp = target;
+        temp += "." + std::to_string(std::random_device()()) + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                onnxdriver_log().warning("FingerprintCache - Failed to write %1", temp);
+                return false;
+            }
+            file << content.str();
+            if (!file.flush()) {
+                file.close();
+                fs::remove(temp, ec);
+                return false;
+            }
+        }
+        fs::rename(temp, target, ec);
+        if (ec) {
+            onnxdriver_log().warning("FingerprintCache - Failed to replace %1: %2", target,
+                                     ec.message());
+            fs::remove(temp, ec);
+            return false;
+        }
+        return true;
+    }
+
+}
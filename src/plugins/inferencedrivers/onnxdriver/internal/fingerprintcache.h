@@ -0,0 +1,60 @@
+#ifndef DSINFER_ONNXDRIVER_FINGERPRINTCACHE_H
+#define DSINFER_ONNXDRIVER_FINGERPRINTCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace dsinfer::onnxdriver {
+
+    // Identifies one version of a file, a digest is reused only while all of these match
+    struct FileStamp {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t size = 0;
+        int64_t mtime = 0;
+
+        bool operator==(const FileStamp &other) const {
+            return device == other.device && inode == other.inode && size == other.size &&
+                   mtime == other.mtime;
+        }
+
+        bool operator!=(const FileStamp &other) const {
+            return !(*this == other);
+        }
+
+        static bool get(const std::filesystem::path &path, FileStamp &stamp);
+    };
+
+    std::string digestToHex(const std::vector<uint8_t> &digest);
+
+    /**
+     * @brief On-disk index of file digests keyed by path and FileStamp.
+     *
+     * Each path is stored in its own small file that is replaced atomically, so processes can
+     * share the directory without locking. Removing the directory invalidates every entry.
+     */
+    class FingerprintCache {
+    public:
+        explicit FingerprintCache(std::filesystem::path dir);
+
+    public:
+        bool find(const std::filesystem::path &path, const FileStamp &stamp,
+                  const std::string &algorithm, std::vector<uint8_t> &digest) const;
+        bool insert(const std::filesystem::path &path, const FileStamp &stamp,
+                    const std::string &algorithm, const std::vector<uint8_t> &digest) const;
+
+        inline const std::filesystem::path &directory() const {
+            return m_dir;
+        }
+
+    protected:
+        std::filesystem::path entryPath(const std::filesystem::path &path) const;
+
+        std::filesystem::path m_dir;
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_FINGERPRINTCACHE_H
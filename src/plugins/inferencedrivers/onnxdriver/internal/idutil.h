@@ -1,6 +1,7 @@
 #ifndef DSINFER_ONNXDRIVER_IDUTIL
 #define DSINFER_ONNXDRIVER_IDUTIL
 
+#include <condition_variable>
 #include <map>
 #include <mutex>
 #include <shared_mutex>
@@ -23,13 +24,16 @@ namespace dsinfer {
         inline int64_t add(T *obj) {
             std::unique_lock<std::shared_mutex> lock(mtx);
             auto id_ = idGenerator.generate();
-            idMap[id_] = obj;
+            idMap[id_].obj = obj;
             return id_;
         }
 
+        // Waits until the object is no longer acquired
         inline bool remove(int64_t id_) {
             std::unique_lock<std::shared_mutex> lock(mtx);
             if (auto it = idMap.find(id_); it != idMap.end()) {
+                it->second.removed = true;
+                released.wait(lock, [it] { return it->second.refs == 0; });
                 idMap.erase(it);
                 return true;
             }
@@ -38,16 +42,40 @@ namespace dsinfer {
 
         inline T *get(int64_t id_) {
             std::shared_lock<std::shared_mutex> lock(mtx);
-            if (auto it = idMap.find(id_); it != idMap.end()) {
-                return it->second;
+            if (auto it = idMap.find(id_); it != idMap.end() && !it->second.removed) {
+                return it->second.obj;
+            }
+            return nullptr;
+        }
+
+        // Like get(), but the object can't be removed until it is released
+        inline T *acquire(int64_t id_) {
+            std::unique_lock<std::shared_mutex> lock(mtx);
+            if (auto it = idMap.find(id_); it != idMap.end() && !it->second.removed) {
+                it->second.refs++;
+                return it->second.obj;
             }
             return nullptr;
         }
 
+        inline void release(int64_t id_) {
+            std::unique_lock<std::shared_mutex> lock(mtx);
+            if (auto it = idMap.find(id_); it != idMap.end() && --it->second.refs == 0) {
+                released.notify_all();
+            }
+        }
+
     private:
+        struct Entry {
+            T *obj = nullptr;
+            int refs = 0;
+            bool removed = false;
+        };
+
         std::shared_mutex mtx;
+        std::condition_variable_any released;
         IdGenerator idGenerator;
-        std::map<int64_t, T *> idMap;
+        std::map<int64_t, Entry> idMap;
     };
 
 }
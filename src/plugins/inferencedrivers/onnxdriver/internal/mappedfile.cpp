@@ -0,0 +1,175 @@
+#include "mappedfile.h"
+
+#include <tuple>
+#include <utility>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace dsinfer::onnxdriver {
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_opened, other.m_opened);
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_opened, other.m_opened);
+        return *this;
+    }
+
+    bool MappedFile::open(const fs::path &path, std::string *errorMessage) {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            if (errorMessage) {
+                *errorMessage = "failed to open file";
+            }
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!::GetFileSizeEx(file, &fileSize)) {
+            ::CloseHandle(file);
+            if (errorMessage) {
+                *errorMessage = "failed to get file size";
+            }
+            return false;
+        }
+        if (fileSize.QuadPart == 0) {
+            ::CloseHandle(file);
+            m_opened = true;
+            return true;
+        }
+        HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ::CloseHandle(file);
+        if (!mapping) {
+            if (errorMessage) {
+                *errorMessage = "failed to create file mapping";
+            }
+            return false;
+        }
+        auto data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        ::CloseHandle(mapping); // the view keeps the mapping alive
+        if (!data) {
+            if (errorMessage) {
+                *errorMessage = "failed to map file";
+            }
+            return false;
+        }
+        m_data = static_cast<const uint8_t *>(data);
+        m_size = size_t(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errorMessage) {
+                *errorMessage = std::string("failed to open file: ") + std::strerror(errno);
+            }
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            if (errorMessage) {
+                *errorMessage = std::string("failed to get file size: ") + std::strerror(errno);
+            }
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size == 0) {
+            ::close(fd);
+            m_opened = true;
+            return true;
+        }
+        auto data = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (data == MAP_FAILED) {
+            if (errorMessage) {
+                *errorMessage = std::string("failed to map file: ") + std::strerror(errno);
+            }
+            return false;
+        }
+        m_data = static_cast<const uint8_t *>(data);
+        m_size = size_t(st.st_size);
+#endif
+        m_opened = true;
+        return true;
+    }
+
+    void MappedFile::advise(int advice) const {
+        if (!m_data || advice == NoAdvice) {
+            return;
+        }
+#ifdef _WIN32
+        if (advice & WillNeed) {
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = const_cast<uint8_t *>(m_data);
+            range.NumberOfBytes = m_size;
+            ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+        }
+#else
+        auto addr = const_cast<uint8_t *>(m_data);
+        if (advice & Sequential) {
+            ::madvise(addr, m_size, MADV_SEQUENTIAL);
+        }
+        if (advice & WillNeed) {
+            ::madvise(addr, m_size, MADV_WILLNEED);
+        }
+#  ifdef MADV_HUGEPAGE
+        if (advice & HugePage) {
+            ::madvise(addr, m_size, MADV_HUGEPAGE);
+        }
+#  endif
+#endif
+    }
+
+    bool MappedFile::readAhead(const fs::path &path) {
+#if defined(_WIN32) || defined(__APPLE__)
+        std::ignore = path;
+        return false;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+        ::close(fd); // the pages being read stay in the cache
+        return ok;
+#endif
+    }
+
+    void MappedFile::close() {
+        if (m_data) {
+#ifdef _WIN32
+            ::UnmapViewOfFile(m_data);
+#else
+            ::munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_opened = false;
+    }
+
+}
@@ -0,0 +1,60 @@
+#ifndef DSINFER_ONNXDRIVER_MAPPEDFILE_H
+#define DSINFER_ONNXDRIVER_MAPPEDFILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace dsinfer::onnxdriver {
+
+    // Read-only memory mapping of a whole file
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        enum Advice {
+            NoAdvice = 0,
+            Sequential = 0x1, // read ahead aggressively
+            WillNeed = 0x2,   // start reading the whole file in the background
+            HugePage = 0x4,   // back the mapping with huge pages where the kernel supports it
+        };
+
+    public:
+        bool open(const std::filesystem::path &path, std::string *errorMessage = nullptr);
+        void close();
+
+        // Hints on how the mapping will be used, unsupported hints are ignored
+        void advise(int advice) const;
+
+        // Starts reading a file into the page cache without mapping it, returns false where
+        // the system has no such hint
+        static bool readAhead(const std::filesystem::path &path);
+
+        inline bool isOpen() const {
+            return m_opened;
+        }
+
+        inline const uint8_t *data() const {
+            return m_data;
+        }
+
+        inline size_t size() const {
+            return m_size;
+        }
+
+    protected:
+        const uint8_t *m_data = nullptr;
+        size_t m_size = 0;
+        bool m_opened = false; // an empty file is open without a mapping
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_MAPPEDFILE_H
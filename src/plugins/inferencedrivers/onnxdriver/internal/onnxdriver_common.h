@@ -30,6 +30,8 @@ namespace dsinfer::onnxdriver {
     enum SessionHint {
         SH_NoHint,
         SH_PreferCPUHint = 0x1,
+        // Runs may be batched with concurrent runs of other sessions of the same model
+        SH_BatchRunsHint = 0x2,
     };
 
 }
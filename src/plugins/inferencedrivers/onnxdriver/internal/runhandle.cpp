@@ -0,0 +1,27 @@
+#include "runhandle.h"
+
+namespace dsinfer::onnxdriver {
+
+    RunHandle::RunHandle() = default;
+
+    RunHandle::~RunHandle() = default;
+
+    void RunHandle::terminate() {
+        m_terminated = true;
+        m_runOptions.SetTerminate();
+    }
+
+    bool RunHandle::isTerminated() const {
+        return m_terminated;
+    }
+
+    void RunHandle::reset() {
+        m_terminated = false;
+        m_runOptions.UnsetTerminate();
+    }
+
+    const Ort::RunOptions &RunHandle::runOptions() const {
+        return m_runOptions;
+    }
+
+}
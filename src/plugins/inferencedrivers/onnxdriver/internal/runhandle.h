@@ -0,0 +1,36 @@
+#ifndef DSINFER_ONNXDRIVER_RUNHANDLE_H
+#define DSINFER_ONNXDRIVER_RUNHANDLE_H
+
+#include <atomic>
+
+#include <onnxruntime_cxx_api.h>
+
+namespace dsinfer::onnxdriver {
+
+    // The options and cancellation of one run. A handle may be terminated from any thread,
+    // before the run starts or while it is in flight.
+    class RunHandle {
+    public:
+        RunHandle();
+        ~RunHandle();
+
+        RunHandle(const RunHandle &) = delete;
+        RunHandle &operator=(const RunHandle &) = delete;
+
+    public:
+        void terminate();
+        bool isTerminated() const;
+
+        // Clears the termination, to reuse the handle for another run
+        void reset();
+
+        const Ort::RunOptions &runOptions() const;
+
+    protected:
+        Ort::RunOptions m_runOptions;
+        std::atomic<bool> m_terminated{false};
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_RUNHANDLE_H
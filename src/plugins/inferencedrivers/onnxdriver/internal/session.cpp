@@ -1,6 +1,9 @@
 #include "session.h"
 
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <condition_variable>
 #include <mutex>
 #include <shared_mutex>
 #include <sstream>
@@ -8,15 +11,19 @@
 #include <unordered_set>
 #include <algorithm>
 #include <list>
+#include <thread>
 
 #include <stdcorelib/path.h>
 
 #include <dsinfer/dsinferglobal.h>
 
-#include <hash-library/sha256.h>
-
 #include "onnxdriver_logger.h"
 #include "env.h"
+#include "batchscheduler.h"
+#include "bindingcache.h"
+#include "fingerprint.h"
+#include "fingerprintcache.h"
+#include "mappedfile.h"
 #include "sessionimage.h"
 #include "scopedtimer.h"
 
@@ -25,56 +32,308 @@ namespace fs = std::filesystem;
 namespace dsinfer::onnxdriver {
 
     struct SessionSystem {
+        struct ImageGroup;
+        struct ImageKey;
+        struct IdleImage;
+
+        using IdleIterator = std::list<IdleImage>::iterator;
+
         struct ImageData {
-            SessionImage *image;
-            int count;
+            SessionImage *image = nullptr; // null while the opening thread is still loading it
+            int count = 0;
+            bool failed = false;
+            std::string errorMessage;
+
+            // Set while the image is unreferenced and kept in the idle list
+            bool idle = false;
+            IdleIterator idleIt;
+        };
+
+        // Sessions of the same model share an image only if they are created the same way
+        struct ImageKey {
+            int hints = 0;
+            SessionConfig config;
+
+            bool operator<(const ImageKey &other) const {
+                if (hints == other.hints) {
+                    return config < other.config;
+                }
+                return hints < other.hints;
+            }
         };
 
         struct ImageGroup {
             std::filesystem::path path;
-            std::streamsize size = 0;
-            std::vector<uint8_t> sha256;
-            std::map<int, ImageData> images; // hint -> [ image, count ]
+            int64_t size = 0;
+            std::vector<uint8_t> digest;
+            std::map<ImageKey, ImageData> images; // [ hints, config ] -> [ image, count ]
         };
 
-        struct Sha256SizeKey {
-            std::streamsize size;
-            std::vector<uint8_t> sha256;
+        struct DigestSizeKey {
+            int64_t size;
+            std::vector<uint8_t> digest;
 
-            bool operator<(const Sha256SizeKey &other) const {
+            bool operator<(const DigestSizeKey &other) const {
                 if (size == other.size) {
-                    return std::lexicographical_compare(sha256.begin(), sha256.end(),
-                                                        other.sha256.begin(), other.sha256.end());
+                    return std::lexicographical_compare(digest.begin(), digest.end(),
+                                                        other.digest.begin(), other.digest.end());
                 }
                 return size < other.size;
             }
         };
 
+        // Unreferenced images, least recently used first
+        struct IdleImage {
+            ImageGroup *group;
+            ImageKey key;
+            int64_t bytes;
+            std::chrono::steady_clock::time_point since;
+        };
+
         std::list<ImageGroup> image_list;
 
         using ListIterator = decltype(image_list)::iterator;
 
         std::map<std::filesystem::path::string_type, ListIterator> path_map;
-        std::map<Sha256SizeKey, ListIterator> sha256_size_map;
+        std::map<DigestSizeKey, ListIterator> digest_size_map;
+
+        // Fingerprint of a path that is being hashed, other opens of the path wait for it
+        // instead of hashing the file again
+        struct PendingHash {
+            bool done = false;
+            bool failed = false;
+            std::string errorMessage;
+            std::vector<uint8_t> digest;
+            int64_t size = 0;
+        };
+        std::map<std::filesystem::path::string_type, std::shared_ptr<PendingHash>> hashing_map;
 
+        // Only guards the maps above, hashing and session creation run without it
         std::shared_mutex mtx;
 
+        // Notified when a loading image or a pending hash becomes ready or fails
+        std::condition_variable_any loaded;
+
+        std::list<IdleImage> idle_list;
+        int64_t idle_bytes = 0;
+        IdleCacheStats stats;
+
+        // Expires idle images in the background
+        std::thread reaper;
+        bool reaperStopping = false;
+        std::condition_variable_any reaperWake;
+
+        ~SessionSystem() {
+            stopReaper();
+        }
+
+        // Drops one reference to the image. An unused image is kept idle if the cache of the
+        // environment allows it, otherwise it is destroyed with its group if empty. The lock must
+        // be held
+        void release(ImageGroup &group, const ImageKey &key) {
+            auto &images = group.images;
+            auto it = images.find(key);
+            assert(it != images.end());
+            auto &data = it->second;
+            const auto &filename = group.path.filename();
+            if (--data.count != 0) {
+                onnxdriver_log().debug("SessionImage [%1] - deref(), now ref count = %2",
+                                       filename, data.count);
+                return;
+            }
+
+            auto env = Env::instance();
+            if (data.image && env && env->idleCacheBytes() > 0) {
+                int64_t bytes = group.size + data.image->peakRunBytes;
+                data.idle = true;
+                data.idleIt = idle_list.insert(
+                    idle_list.end(), {&group, key, bytes, std::chrono::steady_clock::now()});
+                idle_bytes += bytes;
+                onnxdriver_log().debug("SessionImage [%1] - idle, %2 bytes, %3 idle in total",
+                                       filename, bytes, idle_list.size());
+                evict(false);
+                startReaper();
+                reaperWake.notify_all();
+                return;
+            }
+            destroy(group, it);
+        }
+
+        // Takes an idle image back, when a session opens it again. The lock must be held
+        void reuse(ImageData &data, const std::filesystem::path &path) {
+            idle_bytes -= data.idleIt->bytes;
+            idle_list.erase(data.idleIt);
+            data.idle = false;
+            stats.hits++;
+            onnxdriver_log().debug("SessionImage [%1] - reusing idle image", path.filename());
+        }
+
+        // Destroys idle images beyond the budget or the time to live of the environment, or
+        // all of them. The lock must be held
+        void evict(bool all) {
+            auto env = Env::instance();
+            auto budget = env ? env->idleCacheBytes() : 0;
+            auto ttl = env ? env->idleCacheTtl() : std::chrono::seconds(0);
+            auto now = std::chrono::steady_clock::now();
+            while (!idle_list.empty()) {
+                auto &front = idle_list.front();
+                const char *reason;
+                if (all) {
+                    reason = "released";
+                } else if (idle_bytes > budget) {
+                    reason = "over budget";
+                } else if (ttl.count() > 0 && now - front.since >= ttl) {
+                    reason = "expired";
+                } else {
+                    break;
+                }
+
+                auto &group = *front.group;
+                auto it = group.images.find(front.key);
+                assert(it != group.images.end());
+                onnxdriver_log().info("SessionImage [%1] - evicting idle image (%2), %3 bytes",
+                                      group.path.filename(), reason, front.bytes);
+                idle_bytes -= front.bytes;
+                stats.evictions++;
+                idle_list.pop_front();
+                destroy(group, it);
+            }
+        }
+
+        // Destroys an unused image, and its group if empty. The lock must be held
+        void destroy(ImageGroup &group, std::map<ImageKey, ImageData>::iterator it) {
+            auto &images = group.images;
+            auto &data = it->second;
+            if (data.image) {
+                onnxdriver_log().debug("SessionImage [%1] - delete", group.path.filename());
+                delete data.image;
+            }
+            images.erase(it);
+
+            if (images.empty()) {
+                onnxdriver_log().debug("Session - The session image group is empty. Destroying.");
+                auto it2 = digest_size_map.find({group.size, group.digest});
+                assert(it2 != digest_size_map.end());
+
+                auto list_it = it2->second;
+
+                digest_size_map.erase(it2);
+                if (auto it3 = path_map.find(group.path);
+                    it3 != path_map.end() && it3->second == list_it) {
+                    path_map.erase(it3);
+                }
+                image_list.erase(list_it);
+            }
+        }
+
+        // The lock must be held
+        void startReaper() {
+            auto env = Env::instance();
+            if (reaper.joinable() || !env || env->idleCacheTtl().count() <= 0) {
+                return;
+            }
+            reaperStopping = false;
+            reaper = std::thread([this] {
+                std::unique_lock<std::shared_mutex> lock(mtx);
+                while (!reaperStopping) {
+                    auto env = Env::instance();
+                    if (idle_list.empty() || !env) {
+                        reaperWake.wait(lock);
+                        continue;
+                    }
+                    reaperWake.wait_until(lock, idle_list.front().since + env->idleCacheTtl());
+                    if (!reaperStopping) {
+                        evict(false);
+                    }
+                }
+            });
+        }
+
+        // The lock must not be held
+        void stopReaper() {
+            {
+                std::unique_lock<std::shared_mutex> lock(mtx);
+                reaperStopping = true;
+                reaperWake.notify_all();
+            }
+            if (reaper.joinable()) {
+                reaper.join();
+            }
+        }
+
         static SessionSystem &global() {
             static SessionSystem instance;
             return instance;
         }
     };
 
+    // Whether a run failed because a preallocated output doesn't have the shape that onnxruntime
+    // produces, as it reports when re-using a bound buffer
+    static bool isOutputShapeMismatch(const Ort::Exception &err) {
+        std::string message = err.what();
+        std::transform(message.begin(), message.end(), message.begin(),
+                       [](unsigned char c) { return char(std::tolower(c)); });
+        return message.find("shape mismatch") != std::string::npos ||
+               message.find("size mismatch") != std::string::npos;
+    }
+
     class Session::Impl {
     public:
-        Ort::RunOptions runOptions;
+        // Runs in flight, terminated by terminate() and waited for by close()
+        std::unordered_set<RunHandle *> runs;
+        mutable std::mutex runsMutex;
+        std::condition_variable runsFinished;
+
+        // Replaced by setBucketConfig(), runs keep the one they started with
+        std::shared_ptr<const ShapeBuckets> buckets;
+
+        // Kept between runs, created on the first one
+        std::unique_ptr<BindingCache> bindings;
+        std::mutex bindingMutex;
 
         SessionSystem::ImageGroup *group = nullptr;
         SessionImage *image = nullptr;
-        int hints = 0;
+        SessionSystem::ImageKey key;
 
         std::filesystem::path realPath;
 
+        // Set while close() waits for the runs in flight, no new run may start
+        bool closing = false;
+
+        // Registers a run in flight with the session and its image, unless the session is
+        // closed or closing
+        class ActiveRun {
+        public:
+            ActiveRun(Impl &impl, RunHandle *handle) : m_impl(impl), m_handle(handle) {
+                std::lock_guard<std::mutex> lock(impl.runsMutex);
+                if (impl.closing || !impl.image) {
+                    return;
+                }
+                m_image = impl.image;
+                m_image->activeRuns++;
+                impl.runs.insert(handle);
+            }
+
+            ~ActiveRun() {
+                if (!m_image) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(m_impl.runsMutex);
+                m_image->activeRuns--;
+                m_impl.runs.erase(m_handle);
+                m_impl.runsFinished.notify_all();
+            }
+
+            bool isValid() const {
+                return m_image != nullptr;
+            }
+
+        private:
+            Impl &m_impl;
+            RunHandle *m_handle;
+            SessionImage *m_image = nullptr;
+        };
+
         template <typename ValueMapType>
         inline Error validateInputValueMap(const ValueMapType &inputValueMap) {
             static_assert(std::is_same_v<ValueMapType, ValueMap> ||
@@ -134,11 +393,50 @@ namespace dsinfer::onnxdriver {
             return {}; // no error
         }
 
+        // The tensors of the largest run, part of the memory an idle image is assumed to keep
         template <typename ValueMapType>
-        inline ValueMapType sessionRun(const ValueMapType &inputValueMap, Error *error) {
+        void recordRunBytes(const ValueMapType &inputs, const ValueMapType &outputs) {
+            int64_t bytes = 0;
+            for (const auto *map : {&inputs, &outputs}) {
+                for (const auto &[name, item] : *map) {
+                    const Ort::Value *value;
+                    if constexpr (std::is_same_v<ValueMapType, SharedValueMap>) {
+                        value = item.get();
+                    } else {
+                        value = &item;
+                    }
+                    if (value && value->IsTensor() &&
+                        value->GetTensorTypeAndShapeInfo().GetElementType() !=
+                            ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING) {
+                        bytes += int64_t(value->GetTensorSizeInBytes());
+                    }
+                }
+            }
+            auto peak = image->peakRunBytes.load();
+            while (bytes > peak && !image->peakRunBytes.compare_exchange_weak(peak, bytes)) {
+            }
+        }
+
+        template <typename ValueMapType>
+        inline ValueMapType sessionRun(const ValueMapType &inputValueMap,
+                                       const SharedValueMap *outputBuffers, Error *error,
+                                       RunHandle *handle) {
             static_assert(std::is_same_v<ValueMapType, ValueMap> ||
                           std::is_same_v<ValueMapType, SharedValueMap>);
 
+            std::unique_ptr<RunHandle> localHandle;
+            if (!handle) {
+                localHandle = std::make_unique<RunHandle>();
+                handle = localHandle.get();
+            }
+            ActiveRun activeRun(*this, handle);
+            if (!activeRun.isValid()) {
+                if (error) {
+                    *error = Error(Error::SessionError, "session is not open");
+                }
+                return {};
+            }
+
             const auto &filename = realPath.filename();
             onnxdriver_log().info("Session [%1] - Running inference", filename);
 
@@ -149,6 +447,7 @@ namespace dsinfer::onnxdriver {
                         .str();
                 onnxdriver_log().info("Session [%1] - Finished inference in %2 seconds", filename,
                                       elapsedStr);
+                image->recordRun(elapsed.count());
             });
 
             if (auto validateError = validateInputValueMap(inputValueMap); !validateError.ok()) {
@@ -159,46 +458,102 @@ namespace dsinfer::onnxdriver {
                 return {};
             }
 
-            try {
-                auto memInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+            // Concurrent runs of a batching image are stacked and run together
+            if constexpr (std::is_same_v<ValueMapType, SharedValueMap>) {
+                if (image->batcher && !outputBuffers) {
+                    SharedValueMap outputs;
+                    if (image->batcher->run(inputValueMap, *handle, outputs, error)) {
+                        if (outputs.empty()) {
+                            timer.deactivate();
+                        }
+                        return outputs;
+                    }
+                }
+            }
 
-                Ort::IoBinding binding(image->session);
+            // Runs of the same session share its binding, a concurrent run binds on its own
+            std::unique_lock<std::mutex> bindingLock(bindingMutex, std::try_to_lock);
+            std::unique_ptr<BindingCache> localBindings;
+            BindingCache *cache;
+            try {
+                if (bindingLock.owns_lock()) {
+                    if (!bindings) {
+                        bindings = std::make_unique<BindingCache>(*image);
+                    }
+                    cache = bindings.get();
+                } else {
+                    localBindings = std::make_unique<BindingCache>(*image);
+                    cache = localBindings.get();
+                }
+            } catch (const Ort::Exception &err) {
+                if (error) {
+                    *error = Error(Error::SessionError, err.what());
+                }
+                timer.deactivate();
+                return {};
+            }
 
+            try {
                 if constexpr (std::is_same_v<ValueMapType, SharedValueMap>) {
                     for (auto &[name, value] : inputValueMap) {
-                        binding.BindInput(name.c_str(), *value);
+                        cache->bindInput(name, *value);
                     }
                 } else {
                     for (auto &[name, value] : inputValueMap) {
-                        binding.BindInput(name.c_str(), value);
+                        cache->bindInput(name, value);
                     }
                 }
 
-                const auto &outputNames = image->outputNames;
-                for (const auto &name : outputNames) {
-                    binding.BindOutput(name.c_str(), memInfo);
+                // Outputs moved to the caller can't be reused, only shared ones are pooled
+                constexpr bool pooled = std::is_same_v<ValueMapType, SharedValueMap>;
+                cache->bindOutputs(outputBuffers, pooled);
+
+                const auto &runOptions = handle->runOptions();
+                try {
+                    image->session.Run(runOptions, cache->binding());
+                } catch (const Ort::Exception &err) {
+                    // The model may declare a wrong output shape, retry with outputs allocated
+                    // by onnxruntime. Other failures, like invalid inputs, are reported at once
+                    if (!cache->hasPreallocatedOutputs() || handle->isTerminated() ||
+                        !isOutputShapeMismatch(err)) {
+                        throw;
+                    }
+                    onnxdriver_log().warning(
+                        "Session [%1] - Run with preallocated outputs failed, retrying: %2",
+                        filename, err.what());
+                    cache->unbindPreallocatedOutputs();
+                    image->session.Run(runOptions, cache->binding());
+                    if (cache->preallocatedShapesDiffer()) {
+                        onnxdriver_log().warning("Session [%1] - The model declares wrong output "
+                                                 "shapes, outputs are no longer preallocated",
+                                                 filename);
+                        cache->disablePreallocation();
+                    }
                 }
 
-                runOptions.UnsetTerminate();
-                image->session.Run(runOptions, binding);
-
-                ValueMapType outValueMap;
-                auto outputValues = binding.GetOutputValues();
+                ValueMapType outputs;
                 if constexpr (std::is_same_v<ValueMapType, SharedValueMap>) {
-                    for (size_t i = 0; i < outputValues.size(); ++i) {
-                        outValueMap.emplace(outputNames[i],
-                                            makeSharedValue(std::move(outputValues[i])));
-                    }
+                    outputs = cache->takeSharedOutputs();
                 } else {
-                    for (size_t i = 0; i < outputValues.size(); ++i) {
-                        outValueMap.emplace(outputNames[i], std::move(outputValues[i]));
-                    }
+                    outputs = cache->takeOutputs();
                 }
-                return outValueMap;
+                recordRunBytes(inputValueMap, outputs);
+                return outputs;
             } catch (const Ort::Exception &err) {
                 if (error) {
                     *error = Error(Error::SessionError, err.what());
                 }
+                // Drop the cache of this run if it can't be cleared, the shared one is still
+                // locked
+                try {
+                    cache->clear();
+                } catch (const Ort::Exception &) {
+                    if (bindingLock.owns_lock()) {
+                        bindings.reset();
+                    } else {
+                        localBindings.reset();
+                    }
+                }
             }
             timer.deactivate();
             return {};
@@ -224,36 +579,52 @@ namespace dsinfer::onnxdriver {
         return *this;
     }
 
-    static bool getFileInfo(const fs::path &path, std::vector<uint8_t> &binaryResult,
-                            std::string &stringResult, std::streamsize &sizeResult) {
-        std::ifstream file(path, std::ios::binary);
-        if (!file) {
-            return false;
+    // Hashes the file through `model`, which is mapped here and reused to create the session
+    static bool hashMappedFile(const fs::path &path, MappedFile &model, std::vector<uint8_t> &digest,
+                               int64_t &size, std::string *errorMessage) {
+        if (!model.isOpen()) {
+            if (!model.open(path, errorMessage)) {
+                return false;
+            }
+            model.advise(MappedFile::Sequential | Env::instance()->mmapAdvice());
         }
+        digest = fingerprint(model.data(), model.size(), Env::instance()->fingerprintAlgorithm());
+        size = int64_t(model.size());
+        return true;
+    }
 
-        // get size
-        file.seekg(0, std::ios::end);
-        sizeResult = file.tellg();
-        file.seekg(0, std::ios::beg);
-
-        static constexpr const size_t buffer_size = 4096; // Process 4KB each time
-        char buffer[buffer_size];
+    // Hashes the file with the fingerprint algorithm of the environment, through the fingerprint
+    // cache if there is one, in which case the file is only hashed when its stamp has changed
+    static bool getFileInfo(const fs::path &path, MappedFile &model, std::vector<uint8_t> &digest,
+                            int64_t &size, std::string *errorMessage) {
+        auto env = Env::instance();
+        auto cacheDir = env->cacheDirectory();
+        FileStamp stamp;
+        if (cacheDir.empty() || !FileStamp::get(path, stamp)) {
+            return hashMappedFile(path, model, digest, size, errorMessage);
+        }
 
-        SHA256 sha256_ctx;
-        while (file.read(buffer, buffer_size) || file.gcount() > 0) {
-            sha256_ctx.add(buffer, file.gcount());
+        FingerprintCache cache(cacheDir / "fingerprints");
+        auto algorithmName = fingerprintAlgorithmName(env->fingerprintAlgorithm());
+        if (cache.find(path, stamp, algorithmName, digest)) {
+            onnxdriver_log().debug("Session - Using cached fingerprint of %1", path.filename());
+            size = stamp.size;
+            return true;
         }
 
-        // get str
-        stringResult = sha256_ctx.getHash();
+        if (!hashMappedFile(path, model, digest, size, errorMessage)) {
+            return false;
+        }
 
-        // get binary
-        binaryResult.resize(32);
-        sha256_ctx.getHash(binaryResult.data());
+        // Don't cache a digest of a file that was modified while being read
+        if (FileStamp stamp2; FileStamp::get(path, stamp2) && stamp2 == stamp) {
+            cache.insert(path, stamp, algorithmName, digest);
+        }
         return true;
     }
 
-    bool Session::open(const fs::path &path, int hints, Error *error) {
+    bool Session::open(const fs::path &path, int hints, const SessionConfig &config,
+                       Error *error) {
         __stdc_impl_t;
 
         if (isOpen()) {
@@ -278,101 +649,145 @@ namespace dsinfer::onnxdriver {
         fs::path canonical_path = fs::canonical(path);
         onnxdriver_log().debug("Session - The canonical path is " + canonical_path.string());
 
-        // Ready to load
         auto &session_system = SessionSystem::global();
         std::unique_lock<std::shared_mutex> lock(session_system.mtx);
-        SessionImage *image = nullptr;
-        std::vector<uint8_t> sha256;
-        std::streamsize size;
-
-        // Search path
         SessionSystem::ImageGroup *image_group = nullptr;
+        std::vector<uint8_t> digest;
+        int64_t size = 0;
+
+        // Mapped at most once, for hashing and then for creating the session
+        MappedFile model;
+
+        // Search path, a known path saves hashing the file again
         if (auto it = session_system.path_map.find(canonical_path);
             it != session_system.path_map.end()) {
-            image_group = &(*it->second);
-            auto &image_map = image_group->images;
-            if (auto it2 = image_map.find(hints); it2 != image_map.end()) {
-                auto &data = it2->second;
-                image = data.image;
-                data.count++;
-                goto out_exists;
-            }
-            sha256 = it->second->sha256;
+            digest = it->second->digest;
             size = it->second->size;
-
-            onnxdriver_log().debug("Session - No same hint in opened sessions");
-            goto out_search_sha256;
-        }
-
-        // Calculate SHA256
-        {
-            std::string sha256_str;
-            if (!getFileInfo(canonical_path, sha256, sha256_str, size)) {
+        } else if (auto it2 = session_system.hashing_map.find(canonical_path);
+                   it2 != session_system.hashing_map.end()) {
+            // Being hashed by another session, wait for its fingerprint
+            onnxdriver_log().debug("Session - The file is being hashed. Waiting for it...");
+            auto pending = it2->second;
+            session_system.loaded.wait(lock, [&pending] { return pending->done; });
+            if (pending->failed) {
                 if (error) {
-                    *error = Error(Error::FileNotFound, "failed to read file");
+                    *error = Error(Error::FileNotFound,
+                                   "failed to read file: " + pending->errorMessage);
                 }
                 return false;
             }
-            onnxdriver_log().debug("Session - SHA256 is %1", sha256_str);
-        }
-
-        // Search SHA256
-        if (auto it = session_system.sha256_size_map.find({size, sha256});
-            it != session_system.sha256_size_map.end()) {
-            image_group = &(*it->second);
-            auto &image_map = image_group->images;
-            if (auto it2 = image_map.find(hints); it2 != image_map.end()) {
-                auto &data = it2->second;
-                image = data.image;
-                data.count++;
-                goto out_exists;
-            }
-        }
-
-    out_search_sha256:
-
-        onnxdriver_log().debug("Session - The session image does not exist. Creating a new one...");
-
-        // Create new one
-        image = new SessionImage();
-        if (std::string error1; !image->open(canonical_path, hints, &error1)) {
-            delete image;
-            if (error) {
-                *error = {
-                    Error::FileNotFound,
-                    "failed to read file: " + error1,
-                };
+            digest = pending->digest;
+            size = pending->size;
+        } else {
+            // Fingerprint without blocking the other sessions
+            auto pending = std::make_shared<SessionSystem::PendingHash>();
+            session_system.hashing_map[canonical_path] = pending;
+            lock.unlock();
+            std::string errorMessage;
+            bool hashed = getFileInfo(canonical_path, model, digest, size, &errorMessage);
+            lock.lock();
+
+            pending->done = true;
+            pending->failed = !hashed;
+            pending->errorMessage = errorMessage;
+            pending->digest = digest;
+            pending->size = size;
+            session_system.hashing_map.erase(canonical_path);
+            session_system.loaded.notify_all();
+            if (!hashed) {
+                if (error) {
+                    *error = Error(Error::FileNotFound, "failed to read file: " + errorMessage);
+                }
+                return false;
             }
-            return false;
+            onnxdriver_log().debug("Session - Fingerprint is %1", digestToHex(digest));
         }
 
-        // Insert
-        if (!image_group) {
+        // Search fingerprint, the group may have been created or destroyed while hashing
+        if (auto it = session_system.digest_size_map.find({size, digest});
+            it != session_system.digest_size_map.end()) {
+            image_group = &(*it->second);
+        } else {
             onnxdriver_log().debug(
                 "Session - The session image group doesn't exist. Creating a new group.");
 
             SessionSystem::ImageGroup group;
             group.path = canonical_path;
             group.size = size;
-            group.sha256 = std::move(sha256);
+            group.digest = std::move(digest);
 
-            auto it = session_system.image_list.emplace(session_system.image_list.end(),
-                                                        std::move(group));
-            session_system.path_map[it->path] = it;
-            session_system.sha256_size_map[{size, it->sha256}] = it;
-            image_group = &(*it);
+            auto it2 = session_system.image_list.emplace(session_system.image_list.end(),
+                                                         std::move(group));
+            session_system.path_map[it2->path] = it2;
+            session_system.digest_size_map[{size, it2->digest}] = it2;
+            image_group = &(*it2);
         }
-        image_group->images[hints] = {image, 1};
-        goto out_success;
 
-    out_exists:
-        onnxdriver_log().debug(
-            "Session - The session image already exists. Increasing the reference count...");
+        SessionSystem::ImageKey key{hints, config};
+        auto &image_map = image_group->images;
+        if (auto it = image_map.find(key); it != image_map.end()) {
+            // Exists or is being loaded by another session, share it
+            auto &data = it->second;
+            data.count++;
+            if (data.idle) {
+                session_system.reuse(data, canonical_path);
+            }
+            if (!data.image && !data.failed) {
+                onnxdriver_log().debug(
+                    "Session - The session image is loading. Waiting for it...");
+                session_system.loaded.wait(lock, [&data] {
+                    return data.image || data.failed;
+                });
+            }
+            if (data.failed) {
+                if (error) {
+                    *error = {
+                        Error::FileNotFound,
+                        "failed to read file: " + data.errorMessage,
+                    };
+                }
+                session_system.release(*image_group, key);
+                return false;
+            }
+            onnxdriver_log().debug(
+                "Session - The session image already exists. Increasing the reference count...");
+        } else {
+            // Insert a placeholder so that concurrent opens wait for this one
+            onnxdriver_log().debug(
+                "Session - The session image does not exist. Creating a new one...");
+            image_map[key].count = 1;
+            lock.unlock();
+
+            auto image = new SessionImage();
+            std::string error1;
+            if (!image->open(canonical_path, hints, config, image_group->digest, model,
+                             &error1)) {
+                delete image;
+                image = nullptr;
+            }
+
+            lock.lock();
+            auto &data = image_map[key];
+            if (!image) {
+                data.failed = true;
+                data.errorMessage = error1;
+                session_system.release(*image_group, key);
+                session_system.loaded.notify_all();
+                if (error) {
+                    *error = {
+                        Error::FileNotFound,
+                        "failed to read file: " + error1,
+                    };
+                }
+                return false;
+            }
+            data.image = image;
+            session_system.loaded.notify_all();
+        }
 
-    out_success:
         impl.group = image_group;
-        impl.image = image;
-        impl.hints = hints;
+        impl.image = image_map[key].image;
+        impl.key = key;
         impl.realPath = canonical_path;
         return true;
     }
@@ -383,44 +798,42 @@ namespace dsinfer::onnxdriver {
         if (!impl.group)
             return false;
 
-        const auto &path = impl.realPath;
-        const auto &filename = path.filename();
+        const auto &filename = impl.realPath.filename();
         onnxdriver_log().debug("Session [%1] - close", filename);
 
-        auto &session_system = SessionSystem::global();
-        std::unique_lock<std::shared_mutex> lock(session_system.mtx);
-
-        auto &group = *impl.group;
-        auto &images = group.images;
+        // The image must outlive the runs that use it
         {
-            auto it = images.find(impl.hints);
-            assert(it != images.end());
-            auto &data = it->second;
-            if (--data.count != 0) {
-                onnxdriver_log().debug("SessionImage [%1] - ref(), now ref count = %2", filename,
-                                       data.count);
-                goto out_success;
+            std::unique_lock<std::mutex> lock(impl.runsMutex);
+            impl.closing = true;
+            if (!impl.runs.empty()) {
+                onnxdriver_log().debug("Session [%1] - terminating %2 runs", filename,
+                                       impl.runs.size());
+                for (auto handle : impl.runs) {
+                    handle->terminate();
+                }
+                impl.runsFinished.wait(lock, [&impl] { return impl.runs.empty(); });
             }
-            onnxdriver_log().debug("SessionImage [%1] - delete", filename);
-            delete it->second.image;
-            images.erase(it);
         }
-        if (images.empty()) {
-            onnxdriver_log().debug("Session - The session image group is empty. Destroying.");
-            auto it = session_system.sha256_size_map.find({group.size, group.sha256});
-            assert(it != session_system.sha256_size_map.end());
-
-            auto list_it = it->second;
 
-            session_system.sha256_size_map.erase(it);
-            session_system.path_map.erase(group.path);
-            session_system.image_list.erase(list_it);
+        // The binding refers to the session of the image, which release() may destroy
+        {
+            std::lock_guard<std::mutex> bindingLock(impl.bindingMutex);
+            impl.bindings.reset();
         }
 
-    out_success:
-        impl.group = nullptr;
-        impl.image = nullptr;
-        impl.hints = 0;
+        auto &session_system = SessionSystem::global();
+        {
+            std::unique_lock<std::shared_mutex> lock(session_system.mtx);
+            session_system.release(*impl.group, impl.key);
+        }
+        {
+            std::lock_guard<std::mutex> lock(impl.runsMutex);
+            impl.group = nullptr;
+            impl.image = nullptr;
+            impl.buckets.reset();
+            impl.closing = false;
+        }
+        impl.key = {};
         impl.realPath.clear();
         return true;
     }
@@ -458,10 +871,91 @@ namespace dsinfer::onnxdriver {
 
     void Session::terminate() {
         __stdc_impl_t;
-        impl.runOptions.SetTerminate();
+        std::lock_guard<std::mutex> lock(impl.runsMutex);
+        for (auto handle : impl.runs) {
+            handle->terminate();
+        }
+    }
+
+    bool Session::setBucketConfig(const BucketConfig &config, Error *error) {
+        __stdc_impl_t;
+        std::lock_guard<std::mutex> lock(impl.runsMutex);
+        if (!impl.image) {
+            if (error) {
+                *error = Error(Error::SessionError, "session is not open");
+            }
+            return false;
+        }
+        if (!config.isEnabled()) {
+            impl.buckets.reset();
+            return true;
+        }
+
+        auto buckets = std::make_shared<ShapeBuckets>(*impl.image, config);
+        if (std::string reason; !buckets->isUsable(&reason)) {
+            if (error) {
+                *error = Error(Error::SessionError,
+                               "[" + impl.realPath.filename().string() +
+                                   "] Inputs can't be padded to buckets: " + reason);
+            }
+            return false;
+        }
+        impl.buckets = std::move(buckets);
+        return true;
+    }
+
+    IdleCacheStats Session::idleCacheStats() {
+        auto &session_system = SessionSystem::global();
+        std::shared_lock<std::shared_mutex> lock(session_system.mtx);
+        auto stats = session_system.stats;
+        stats.images = int(session_system.idle_list.size());
+        stats.bytes = session_system.idle_bytes;
+        return stats;
+    }
+
+    void Session::releaseIdleImages() {
+        auto &session_system = SessionSystem::global();
+        session_system.stopReaper();
+        std::unique_lock<std::shared_mutex> lock(session_system.mtx);
+        session_system.evict(true);
     }
 
-    ValueMap Session::run(const ValueMap &inputValueMap, Error *error) {
+    bool Session::warmUp(const WarmupConfig &config, Error *error) {
+        __stdc_impl_t;
+        SessionImage *image;
+        {
+            std::lock_guard<std::mutex> lock(impl.runsMutex);
+            image = impl.image;
+        }
+        if (!image) {
+            if (error) {
+                *error = Error(Error::SessionError, "session is not open");
+            }
+            return false;
+        }
+        image->warmUp(config);
+        return true;
+    }
+
+    bool Session::isRunning() const {
+        __stdc_impl_t;
+        std::lock_guard<std::mutex> lock(impl.runsMutex);
+        return !impl.runs.empty();
+    }
+
+    ValueMap Session::run(const ValueMap &inputValueMap, Error *error, RunHandle *handle) {
+        __stdc_impl_t;
+        if (!impl.group) {
+            if (error) {
+                *error = Error(Error::SessionError, "session is not open");
+            }
+            return {};
+        }
+        return impl.sessionRun<ValueMap>(inputValueMap, nullptr, error, handle);
+    }
+
+    SharedValueMap Session::run(const SharedValueMap &inputValueMap, Error *error,
+                                RunHandle *handle) {
         __stdc_impl_t;
         if (!impl.group) {
             if (error) {
@@ -469,10 +963,39 @@ namespace dsinfer::onnxdriver {
             }
             return {};
         }
-        return impl.sessionRun<ValueMap>(inputValueMap, error);
+
+        std::shared_ptr<const ShapeBuckets> buckets;
+        {
+            std::lock_guard<std::mutex> lock(impl.runsMutex);
+            buckets = impl.buckets;
+        }
+        if (!buckets) {
+            return impl.sessionRun<SharedValueMap>(inputValueMap, nullptr, error, handle);
+        }
+
+        // Runs on the padded inputs, and cuts the outputs back
+        try {
+            SharedValueMap paddedValueMap;
+            std::vector<std::vector<int64_t>> shapes;
+            if (!buckets->pad(inputValueMap, paddedValueMap, shapes)) {
+                return impl.sessionRun<SharedValueMap>(inputValueMap, nullptr, error, handle);
+            }
+            auto outputs = impl.sessionRun<SharedValueMap>(paddedValueMap, nullptr, error, handle);
+            if (outputs.empty()) {
+                return {};
+            }
+            return buckets->crop(outputs, shapes);
+        } catch (const Ort::Exception &err) {
+            if (error) {
+                *error = Error(Error::SessionError, err.what());
+            }
+        }
+        return {};
     }
 
-    SharedValueMap Session::run(const SharedValueMap &inputValueMap, Error *error) {
+    SharedValueMap Session::run(const SharedValueMap &inputValueMap,
+                                const SharedValueMap &outputBuffers, Error *error,
+                                RunHandle *handle) {
         __stdc_impl_t;
         if (!impl.group) {
             if (error) {
@@ -480,7 +1003,7 @@ namespace dsinfer::onnxdriver {
             }
             return {};
         }
-        return impl.sessionRun<SharedValueMap>(inputValueMap, error);
+        return impl.sessionRun<SharedValueMap>(inputValueMap, &outputBuffers, error, handle);
     }
 
 }
\ No newline at end of file
@@ -9,9 +9,20 @@
 #include <dsinfer/error.h>
 
 #include "valuemap.h"
+#include "runhandle.h"
+#include "sessionconfig.h"
+#include "shapebuckets.h"
+#include "warmupconfig.h"
 
 namespace dsinfer::onnxdriver {
 
+    struct IdleCacheStats {
+        int images = 0;        // kept idle now
+        int64_t bytes = 0;     // estimated size of the idle images
+        int64_t hits = 0;      // opens that reused an idle image
+        int64_t evictions = 0; // idle images destroyed
+    };
+
     class Session {
     public:
         Session();
@@ -24,20 +35,47 @@ namespace dsinfer::onnxdriver {
         Session &operator=(Session &&other) noexcept;
 
     public:
-        bool open(const std::filesystem::path &path, int hints, Error *error);
+        bool open(const std::filesystem::path &path, int hints, const SessionConfig &config,
+                  Error *error);
         bool close();
 
         const std::vector<std::string> &inputNames() const;
         const std::vector<std::string> &outputNames() const;
 
-        ValueMap run(const ValueMap &inputTensorMap, Error *error = nullptr);
-        SharedValueMap run(const SharedValueMap &inputTensorMap, Error *error = nullptr);
+        // Runs may overlap. A run is cancelled through `handle` if given, and by terminate()
+        ValueMap run(const ValueMap &inputTensorMap, Error *error = nullptr,
+                     RunHandle *handle = nullptr);
+        SharedValueMap run(const SharedValueMap &inputTensorMap, Error *error = nullptr,
+                           RunHandle *handle = nullptr);
+
+        // Writes the outputs found in `outputBuffers` into them instead of new tensors, the
+        // returned map holds the same values
+        SharedValueMap run(const SharedValueMap &inputTensorMap,
+                           const SharedValueMap &outputBuffers, Error *error = nullptr,
+                           RunHandle *handle = nullptr);
+
+        // Pads the inputs of the runs of shared values to the buckets of `config`, for the runs
+        // started after it. Fails if the model can't be bucketed
+        bool setBucketConfig(const BucketConfig &config, Error *error = nullptr);
 
+        // Warms the model up on synthesized inputs, unless another session of the same image
+        // did. Returns at once if the warm-up runs in the background
+        bool warmUp(const WarmupConfig &config, Error *error = nullptr);
+
+        // Terminates all runs in flight
         void terminate();
+        bool isRunning() const;
 
         std::filesystem::path path() const;
         bool isOpen() const;
 
+        // Images of closed sessions are kept idle for the sessions opening them again, within the
+        // budget and time to live set in the environment
+        static IdleCacheStats idleCacheStats();
+
+        // Destroys the idle images, before the environment is released
+        static void releaseIdleImages();
+
     protected:
         class Impl;
         std::unique_ptr<Impl> _impl;
@@ -0,0 +1,140 @@
+#include "sessionconfig.h"
+
+#include <sstream>
+
+namespace dsinfer::onnxdriver {
+
+    static const char *executionModeName(ExecutionMode mode) {
+        return mode == ORT_PARALLEL ? "parallel" : "sequential";
+    }
+
+    static const char *graphOptimizationLevelName(GraphOptimizationLevel level) {
+        switch (level) {
+            case ORT_DISABLE_ALL:
+                return "disable";
+            case ORT_ENABLE_BASIC:
+                return "basic";
+            case ORT_ENABLE_EXTENDED:
+                return "extended";
+            default:
+                break;
+        }
+        return "all";
+    }
+
+    bool SessionConfig::parse(const JsonValue &obj, Error *error) {
+        auto invalid = [error](std::string_view key, const char *expected) {
+            if (error) {
+                *error = {
+                    Error::InvalidFormat,
+                    R"(invalid session option ")" + std::string(key) + R"(", expected )" +
+                        expected,
+                };
+            }
+            return false;
+        };
+
+        if (!obj.isObject()) {
+            if (error) {
+                *error = {Error::InvalidFormat, "session options must be an object"};
+            }
+            return false;
+        }
+
+        auto result = *this;
+        for (const auto &[key, value] : JsonValueRef(obj).toObject()) {
+            if (key == "intraOpThreads" || key == "interOpThreads") {
+                if (!value.isInt() || value.toInt() < 0) {
+                    return invalid(key, "a non-negative integer");
+                }
+                (key == "intraOpThreads" ? result.intraOpThreads : result.interOpThreads) =
+                    value.toInt();
+            } else if (key == "executionMode") {
+                auto str = value.toStringView();
+                if (str == "sequential") {
+                    result.executionMode = ORT_SEQUENTIAL;
+                } else if (str == "parallel") {
+                    result.executionMode = ORT_PARALLEL;
+                } else {
+                    return invalid(key, R"("sequential" or "parallel")");
+                }
+            } else if (key == "graphOptimizationLevel") {
+                auto str = value.toStringView();
+                if (str == "disable") {
+                    result.graphOptimizationLevel = ORT_DISABLE_ALL;
+                } else if (str == "basic") {
+                    result.graphOptimizationLevel = ORT_ENABLE_BASIC;
+                } else if (str == "extended") {
+                    result.graphOptimizationLevel = ORT_ENABLE_EXTENDED;
+                } else if (str == "all") {
+                    result.graphOptimizationLevel = ORT_ENABLE_ALL;
+                } else {
+                    return invalid(key, R"("disable", "basic", "extended" or "all")");
+                }
+            } else if (key == "memPattern" || key == "cpuArena" || key == "allowSpinning" ||
+                       key == "denormalAsZero") {
+                if (!value.isBool()) {
+                    return invalid(key, "a boolean");
+                }
+                auto &field = key == "memPattern"      ? result.memPattern
+                              : key == "cpuArena"      ? result.cpuArena
+                              : key == "allowSpinning" ? result.allowSpinning
+                                                       : result.denormalAsZero;
+                field = value.toBool();
+            } else {
+                if (error) {
+                    *error = {
+                        Error::InvalidFormat,
+                        R"(unknown session option ")" + std::string(key) + '"',
+                    };
+                }
+                return false;
+            }
+        }
+        *this = result;
+        return true;
+    }
+
+    void SessionConfig::apply(Ort::SessionOptions &options) const {
+        if (usesGlobalThreadPools()) {
+            options.DisablePerSessionThreads();
+        } else {
+            options.SetIntraOpNumThreads(intraOpThreads);
+            options.SetInterOpNumThreads(interOpThreads);
+            options.AddConfigEntry("session.intra_op.allow_spinning", allowSpinning ? "1" : "0");
+            options.AddConfigEntry("session.inter_op.allow_spinning", allowSpinning ? "1" : "0");
+        }
+        options.SetExecutionMode(executionMode);
+        options.SetGraphOptimizationLevel(graphOptimizationLevel);
+        if (memPattern) {
+            options.EnableMemPattern();
+        } else {
+            options.DisableMemPattern();
+        }
+        if (cpuArena) {
+            options.EnableCpuMemArena();
+        } else {
+            options.DisableCpuMemArena();
+        }
+        if (denormalAsZero) {
+            options.AddConfigEntry("session.set_denormal_as_zero", "1");
+        }
+    }
+
+    std::string SessionConfig::toString() const {
+        std::ostringstream ss;
+        ss << "threads=";
+        if (usesGlobalThreadPools()) {
+            ss << "global";
+        } else {
+            ss << intraOpThreads << '/' << interOpThreads
+               << (allowSpinning ? " spinning" : " no-spinning");
+        }
+        ss << " mode=" << executionModeName(executionMode)
+           << " optimization=" << graphOptimizationLevelName(graphOptimizationLevel)
+           << " memPattern=" << memPattern << " cpuArena=" << cpuArena
+           << " denormalAsZero=" << denormalAsZero;
+        return ss.str();
+    }
+
+}
@@ -0,0 +1,55 @@
+#ifndef DSINFER_ONNXDRIVER_SESSIONCONFIG_H
+#define DSINFER_ONNXDRIVER_SESSIONCONFIG_H
+
+#include <string>
+#include <tuple>
+
+#include <onnxruntime_cxx_api.h>
+
+#include <dsinfer/error.h>
+#include <dsinfer/jsonvalue.h>
+
+namespace dsinfer::onnxdriver {
+
+    // Tuning of one Ort::Session, part of the key that session images are shared by
+    struct SessionConfig {
+        // A session with both counts 0 runs on the global thread pools of the environment,
+        // otherwise it gets its own pools and allowSpinning applies to them
+        int intraOpThreads = 0;
+        int interOpThreads = 0;
+        bool allowSpinning = true;
+
+        ExecutionMode executionMode = ORT_SEQUENTIAL;
+        GraphOptimizationLevel graphOptimizationLevel = ORT_ENABLE_ALL;
+        bool memPattern = true;
+        bool cpuArena = true;
+        bool denormalAsZero = false;
+
+        inline auto tie() const {
+            return std::tie(intraOpThreads, interOpThreads, allowSpinning, executionMode,
+                            graphOptimizationLevel, memPattern, cpuArena, denormalAsZero);
+        }
+
+        inline bool operator<(const SessionConfig &other) const {
+            return tie() < other.tie();
+        }
+
+        inline bool operator==(const SessionConfig &other) const {
+            return tie() == other.tie();
+        }
+
+        inline bool usesGlobalThreadPools() const {
+            return intraOpThreads == 0 && interOpThreads == 0;
+        }
+
+        // Overrides the options present in `obj`, unknown keys and invalid values are errors
+        bool parse(const JsonValue &obj, Error *error = nullptr);
+
+        void apply(Ort::SessionOptions &options) const;
+
+        std::string toString() const;
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_SESSIONCONFIG_H
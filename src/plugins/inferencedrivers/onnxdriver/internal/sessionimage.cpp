@@ -1,19 +1,45 @@
 #include "sessionimage.h"
 
+#include <map>
+#include <random>
+#include <sstream>
+
 #include <onnxruntime_cxx_api.h>
 
 #include "onnxdriver_common.h"
+#include "batchscheduler.h"
 #include "onnxdriver_logger.h"
 #include "executionprovider.h"
 #include "env.h"
+#include "fingerprintcache.h"
+#include "mappedfile.h"
+#include "scopedtimer.h"
+#include "tensorcopy.h"
+
+namespace fs = std::filesystem;
 
 namespace dsinfer::onnxdriver {
 
-    static Ort::Session createOrtSession(const Ort::Env &ortEnv,
-                                         const std::filesystem::path &modelPath, bool preferCpu,
-                                         std::string *errorMessage) {
+    // Creates the session from the mapped model. An ORT format model keeps referring to the
+    // mapping, which must outlive the session, so that its weights are shared through the page
+    // cache. Otherwise the optimized model is saved in ORT format to `savePath` if not empty
+    static Ort::Session createOrtSession(const Ort::Env &ortEnv, const fs::path &modelPath,
+                                         const MappedFile &model, bool preferCpu,
+                                         const SessionConfig &config, bool ortFormat,
+                                         const fs::path &savePath, std::string *errorMessage) {
         try {
             Ort::SessionOptions sessOpt;
+            config.apply(sessOpt);
+
+            fs::path::string_type savePathString = savePath;
+            if (ortFormat) {
+                sessOpt.AddConfigEntry("session.load_model_format", "ORT");
+                sessOpt.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+                sessOpt.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+            } else if (!savePath.empty()) {
+                sessOpt.SetOptimizedModelFilePath(savePathString.c_str());
+                sessOpt.AddConfigEntry("session.save_model_format", "ORT");
+            }
 
             auto env = Env::instance();
             auto ep = env->executionProvider();
@@ -55,8 +81,7 @@ namespace dsinfer::onnxdriver {
             } else {
                 onnxdriver_log().info("The model prefers to use CPU. [%1]", modelPath.filename());
             }
-            return Ort::Session{ortEnv, std::filesystem::path::string_type(modelPath).c_str(),
-                                sessOpt};
+            return Ort::Session{ortEnv, model.data(), model.size(), sessOpt};
         } catch (const Ort::Exception &e) {
             if (errorMessage) {
                 *errorMessage = e.what();
@@ -65,41 +90,164 @@ namespace dsinfer::onnxdriver {
         return Ort::Session{nullptr};
     }
 
-    static void loggingFuncOrt(void *param, OrtLoggingLevel severity, const char *category,
-                               const char *logid, const char *code_location, const char *message) {
-        int log_level = Log::Information;
-        switch (severity) {
-            case ORT_LOGGING_LEVEL_VERBOSE:
-                log_level = Log::Verbose;
-                break;
-            case ORT_LOGGING_LEVEL_WARNING:
-                log_level = Log::Warning;
-                break;
-            case ORT_LOGGING_LEVEL_ERROR:
-                log_level = Log::Critical;
-                break;
-            case ORT_LOGGING_LEVEL_FATAL:
-                log_level = Log::Fatal;
-                break;
-            default:
-                break;
-        }
-        Log::Category("onnxruntime").log(log_level, "[%1] %2", code_location, message);
+    // Optimized models are only valid for the model, onnxruntime and options they were created
+    // with, all of which are hashed into the file name
+    static fs::path optimizedModelPath(const std::vector<uint8_t> &digest,
+                                       const SessionConfig &config) {
+        auto env = Env::instance();
+        std::ostringstream key;
+        key << fingerprintAlgorithmName(env->fingerprintAlgorithm()) << ':' << digestToHex(digest)
+            << '|' << env->versionString() << '|' << config.toString();
+        auto keyString = key.str();
+        auto keyDigest = fingerprint(reinterpret_cast<const uint8_t *>(keyString.data()),
+                                     keyString.size(), FA_XXH3Tree, 1);
+        return env->cacheDirectory() / "models" / (digestToHex(keyDigest) + ".ort");
+    }
+
+    // Matches the symbolic dimensions of the outputs with those of the inputs, so that an
+    // output can be allocated before the run when all its dimensions are known
+    static std::vector<SessionImage::OutputInfo> getOutputInfos(const Ort::Session &session) {
+        std::map<std::string, std::pair<int, int>> symbols; // symbol -> [ input, axis ]
+        auto inputCount = session.GetInputCount();
+        for (size_t i = 0; i < inputCount; ++i) {
+            auto typeInfo = session.GetInputTypeInfo(i);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR) {
+                continue;
+            }
+            auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+            auto shape = tensorInfo.GetShape();
+            auto shapeSymbols = tensorInfo.GetSymbolicDimensions();
+            for (size_t j = 0; j < shape.size() && j < shapeSymbols.size(); ++j) {
+                if (shape[j] < 0 && shapeSymbols[j] && *shapeSymbols[j]) {
+                    symbols.emplace(shapeSymbols[j], std::make_pair(int(i), int(j)));
+                }
+            }
+        }
+
+        std::vector<SessionImage::OutputInfo> outputInfos(session.GetOutputCount());
+        for (size_t i = 0; i < outputInfos.size(); ++i) {
+            auto typeInfo = session.GetOutputTypeInfo(i);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR) {
+                continue;
+            }
+            auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+            auto &info = outputInfos[i];
+            info.type = tensorInfo.GetElementType();
+            if (info.type == ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING) {
+                continue;
+            }
+            auto shape = tensorInfo.GetShape();
+            auto shapeSymbols = tensorInfo.GetSymbolicDimensions();
+            info.derivable = true;
+            info.dims.resize(shape.size());
+            for (size_t j = 0; j < shape.size(); ++j) {
+                if (shape[j] >= 0) {
+                    info.dims[j].size = shape[j];
+                    continue;
+                }
+                auto it = j < shapeSymbols.size() && shapeSymbols[j]
+                              ? symbols.find(shapeSymbols[j])
+                              : symbols.end();
+                if (it == symbols.end()) {
+                    info.derivable = false;
+                    info.dims.clear();
+                    break;
+                }
+                info.dims[j].input = it->second.first;
+                info.dims[j].axis = it->second.second;
+            }
+        }
+        return outputInfos;
     }
 
     SessionImage::SessionImage()
-        : env(ORT_LOGGING_LEVEL_WARNING, "flowonnx", loggingFuncOrt, nullptr), session(nullptr) {
+        : session(nullptr) {
     }
 
-    SessionImage::~SessionImage() = default;
+    SessionImage::~SessionImage() {
+        m_warmupHandle.terminate();
+        if (m_warmupThread.joinable()) {
+            m_warmupThread.join();
+        }
+    }
 
     bool SessionImage::open(const std::filesystem::path &onnxPath, int hints,
-                            std::string *errorMessage) {
+                            const SessionConfig &config, const std::vector<uint8_t> &digest,
+                            MappedFile &model, std::string *errorMessage) {
         auto filename = onnxPath.filename();
-        onnxdriver_log().debug("SessionImage [%1] - creating", filename);
+        onnxdriver_log().debug("SessionImage [%1] - creating (%2)", filename, config.toString());
+
+        auto env = Env::instance();
+        bool preferCpu = hints & SH_PreferCPUHint;
+
+        // Optimized graphs are CPU specific, models run by other providers are not cached
+        fs::path cachePath;
+        if (env->modelCacheEnabled() && !env->cacheDirectory().empty() && !digest.empty() &&
+            (preferCpu || env->executionProvider() == EP_CPU)) {
+            cachePath = optimizedModelPath(digest, config);
+        }
+
+        bool cached = false;
+        ScopedTimer timer([&](const ScopedTimer::duration_t &elapsed) {
+            onnxdriver_log().info("SessionImage [%1] - Created in %2 seconds%3", filename,
+                                  elapsed.count(), cached ? " from the optimized model cache" : "");
+        });
+
+        std::error_code ec;
+        if (!cachePath.empty() && fs::is_regular_file(cachePath, ec)) {
+            std::string cacheErrorMessage;
+            if (modelBytes.open(cachePath, &cacheErrorMessage)) {
+                modelBytes.advise(env->mmapAdvice());
+                session = createOrtSession(env->ortEnv(), cachePath, modelBytes, preferCpu,
+                                           config, true, {}, &cacheErrorMessage);
+            }
+            if (session) {
+                cached = true;
+            } else {
+                modelBytes.close();
+                onnxdriver_log().warning(
+                    "SessionImage [%1] - Discarding unusable optimized model %2: %3", filename,
+                    cachePath, cacheErrorMessage);
+                fs::remove(cachePath, ec);
+            }
+        }
+
+        if (!session) {
+            // Saved under a private name and renamed into place once complete, so that other
+            // processes never load a partial file
+            fs::path savePath;
+            if (!cachePath.empty()) {
+                fs::create_directories(cachePath.parent_path(), ec);
+                savePath = cachePath;
+                savePath += "." + std::to_string(std::random_device()()) + ".tmp";
+            }
+            // The protobuf is parsed into tensors owned by the session, the mapping that was
+            // hashed is reused rather than reading the file once more
+            if (!model.isOpen()) {
+                if (!model.open(onnxPath, errorMessage)) {
+                    timer.deactivate();
+                    onnxdriver_log().critical("SessionImage [%1] - map failed", filename);
+                    return false;
+                }
+                model.advise(MappedFile::Sequential | env->mmapAdvice());
+            }
+            session = createOrtSession(env->ortEnv(), onnxPath, model, preferCpu, config, false,
+                                       savePath, errorMessage);
+            if (!savePath.empty()) {
+                if (session && fs::is_regular_file(savePath, ec)) {
+                    fs::rename(savePath, cachePath, ec);
+                    if (ec) {
+                        onnxdriver_log().warning(
+                            "SessionImage [%1] - Failed to cache optimized model: %2", filename,
+                            ec.message());
+                    }
+                }
+                fs::remove(savePath, ec);
+            }
+        }
 
-        session = createOrtSession(env, onnxPath, hints & SH_PreferCPUHint, errorMessage);
         if (!session) {
+            timer.deactivate();
             onnxdriver_log().critical("SessionImage [%1] - create failed", filename);
             return false;
         }
@@ -116,8 +264,111 @@ namespace dsinfer::onnxdriver {
         for (size_t i = 0; i < outputCount; ++i) {
             outputNames.emplace_back(session.GetOutputNameAllocated(i, allocator).get());
         }
+        outputInfos = getOutputInfos(session);
+
+        if ((hints & SH_BatchRunsHint) && env->batchMaxSize() > 1) {
+            if (std::string reason; BatchScheduler::isBatchable(*this, &reason)) {
+                batcher = std::make_unique<BatchScheduler>(*this, env->batchMaxSize(),
+                                                           env->batchWindow());
+            } else {
+                onnxdriver_log().warning("SessionImage [%1] - Runs will not be batched: %2",
+                                         filename, reason);
+            }
+        }
+        path = onnxPath;
+        m_openTime = std::chrono::steady_clock::now();
         onnxdriver_log().debug("SessionImage [%1] - created successfully", filename);
         return true;
     }
 
+    void SessionImage::warmUp(const WarmupConfig &config) {
+        if (!config.isEnabled() || m_warmupStarted.exchange(true)) {
+            return;
+        }
+        if (config.background) {
+            m_warmupThread = std::thread([this, config] { m_warmedUp = runWarmup(config); });
+        } else {
+            m_warmedUp = runWarmup(config);
+        }
+    }
+
+    // Runs the model on zeros of the declared types, shaped by the sizes given for the
+    // symbolic dimensions
+    bool SessionImage::runWarmup(const WarmupConfig &config) {
+        auto filename = path.filename();
+        ScopedTimer timer([&](const ScopedTimer::duration_t &elapsed) {
+            onnxdriver_log().info("SessionImage [%1] - Warmed up in %2 seconds (%3 runs)",
+                                  filename, elapsed.count(), config.runs);
+        });
+
+        try {
+            Ort::AllocatorWithDefaultOptions allocator;
+            std::vector<Ort::Value> inputValues;
+            for (size_t i = 0; i < inputNames.size(); ++i) {
+                auto typeInfo = session.GetInputTypeInfo(i);
+                if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR ||
+                    elementSize(typeInfo.GetTensorTypeAndShapeInfo().GetElementType()) == 0) {
+                    timer.deactivate();
+                    onnxdriver_log().warning(
+                        "SessionImage [%1] - Skipping warm-up, input \"%2\" is not numeric",
+                        filename, inputNames[i]);
+                    return false;
+                }
+                auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+                auto shape = tensorInfo.GetShape();
+                auto symbols = tensorInfo.GetSymbolicDimensions();
+                for (size_t j = 0; j < shape.size(); ++j) {
+                    if (shape[j] < 0) {
+                        shape[j] = config.dimSize(j < symbols.size() ? symbols[j] : nullptr);
+                    }
+                }
+                auto value = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(),
+                                                      tensorInfo.GetElementType());
+                std::memset(value.GetTensorMutableRawData(), 0, value.GetTensorSizeInBytes());
+                inputValues.push_back(std::move(value));
+            }
+
+            std::vector<const char *> inputNamePtrs;
+            for (const auto &name : inputNames) {
+                inputNamePtrs.push_back(name.c_str());
+            }
+            std::vector<const char *> outputNamePtrs;
+            for (const auto &name : outputNames) {
+                outputNamePtrs.push_back(name.c_str());
+            }
+            for (int i = 0; i < config.runs && !m_warmupHandle.isTerminated(); ++i) {
+                session.Run(m_warmupHandle.runOptions(), inputNamePtrs.data(),
+                            inputValues.data(), inputValues.size(), outputNamePtrs.data(),
+                            outputNamePtrs.size());
+            }
+        } catch (const Ort::Exception &err) {
+            timer.deactivate();
+            if (!m_warmupHandle.isTerminated()) {
+                onnxdriver_log().warning("SessionImage [%1] - Warm-up failed: %2", filename,
+                                         err.what());
+            }
+            return false;
+        }
+        if (m_warmupHandle.isTerminated()) {
+            timer.deactivate();
+            return false;
+        }
+        return true;
+    }
+
+    void SessionImage::recordRun(double elapsedSeconds) {
+        if (m_firstRunRecorded.exchange(true)) {
+            return;
+        }
+        auto sinceOpen = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                       m_openTime);
+        onnxdriver_log().info(
+            "SessionImage [%1] - First inference took %2 seconds, finished %3 seconds after "
+            "opening (%4)",
+            path.filename(), elapsedSeconds, sinceOpen.count(),
+            m_warmedUp         ? "warmed up"
+            : m_warmupStarted ? "warm-up unfinished"
+                              : "not warmed up");
+    }
+
 }
\ No newline at end of file
@@ -1,28 +1,88 @@
 #ifndef DSINFER_ONNXDRIVER_SESSIONIMAGE_P_H
 #define DSINFER_ONNXDRIVER_SESSIONIMAGE_P_H
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <memory>
+#include <thread>
 
 #include <dsinfer/error.h>
 
 #include <onnxruntime_cxx_api.h>
 
+#include "mappedfile.h"
+#include "runhandle.h"
+#include "sessionconfig.h"
+#include "warmupconfig.h"
+
 namespace dsinfer::onnxdriver {
 
+    class BatchScheduler;
+
     class SessionImage {
     public:
+        // Where a dimension of an output comes from: a fixed size, or an axis of an input
+        struct DimensionSource {
+            int64_t size = -1;
+            int input = -1;
+            int axis = -1;
+        };
+
+        struct OutputInfo {
+            ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+            // Empty if the shape can't be derived from the input shapes
+            std::vector<DimensionSource> dims;
+            bool derivable = false;
+        };
+
         SessionImage();
         ~SessionImage();
 
-        bool open(const std::filesystem::path &onnxPath, int hints,
+        // `digest` is the fingerprint of the model, used to find its optimized model in the cache.
+        // `model` is the mapping of `onnxPath` if it was already mapped, otherwise it is mapped
+        // here when needed
+        bool open(const std::filesystem::path &onnxPath, int hints, const SessionConfig &config,
+                  const std::vector<uint8_t> &digest, MappedFile &model,
                   std::string *errorMessage = nullptr);
 
+        // Warms the image up unless a session already did, on a thread of its own if requested
+        void warmUp(const WarmupConfig &config);
+
+        // Logs how long after opening the first run that is not a warm-up finished
+        void recordRun(double elapsedSeconds);
+
     public:
         std::vector<std::string> inputNames;
         std::vector<std::string> outputNames;
+        std::vector<OutputInfo> outputInfos;
+
+        // Runs in flight, of all the sessions sharing the image
+        std::atomic<int> activeRuns{0};
 
-        Ort::Env env;
+        // Bytes of the tensors of the largest run, to estimate the memory kept by the image
+        std::atomic<int64_t> peakRunBytes{0};
+
+        // Set if opened with SH_BatchRunsHint and the model can be batched
+        std::unique_ptr<BatchScheduler> batcher;
+
+        std::filesystem::path path;
+
+        // Declared before the session, which may refer to it, so that it is unmapped last
+        MappedFile modelBytes;
         Ort::Session session;
+
+    protected:
+        bool runWarmup(const WarmupConfig &config);
+
+        std::chrono::steady_clock::time_point m_openTime;
+        std::atomic<bool> m_warmupStarted{false};
+        std::atomic<bool> m_warmedUp{false};
+        std::atomic<bool> m_firstRunRecorded{false};
+
+        // Terminated and joined on destruction
+        RunHandle m_warmupHandle;
+        std::thread m_warmupThread;
     };
 
 }
@@ -0,0 +1,255 @@
+#include "shapebuckets.h"
+
+#include <algorithm>
+
+#include "sessionimage.h"
+#include "tensorcopy.h"
+
+namespace dsinfer::onnxdriver {
+
+    int64_t BucketConfig::bucketSize(int64_t size) const {
+        if (boundaries.empty() || size <= 0) {
+            return size;
+        }
+        if (auto it = std::lower_bound(boundaries.begin(), boundaries.end(), size);
+            it != boundaries.end()) {
+            return *it;
+        }
+        auto last = boundaries.back();
+        return (size + last - 1) / last * last;
+    }
+
+    bool BucketConfig::parse(const JsonValue &obj, Error *error) {
+        auto invalid = [error](std::string_view key, const char *expected) {
+            if (error) {
+                *error = {
+                    Error::InvalidFormat,
+                    R"(invalid bucket option ")" + std::string(key) + R"(", expected )" +
+                        expected,
+                };
+            }
+            return false;
+        };
+
+        if (!obj.isObject()) {
+            if (error) {
+                *error = {Error::InvalidFormat, "bucket options must be an object"};
+            }
+            return false;
+        }
+
+        auto result = *this;
+        for (const auto &[key, value] : JsonValueRef(obj).toObject()) {
+            if (key == "axes") {
+                if (!value.isArray()) {
+                    return invalid(key, "an array of dimension names");
+                }
+                result.axes.clear();
+                for (const auto &item : value.toArray()) {
+                    if (!item.isString() || item.toStringView().empty()) {
+                        return invalid(key, "an array of dimension names");
+                    }
+                    result.axes.emplace_back(item.toStringView());
+                }
+            } else if (key == "durations" || key == "frameAxis") {
+                if (!value.isString()) {
+                    return invalid(key, "a string");
+                }
+                (key == "durations" ? result.durations : result.frameAxis) = value.toString();
+            } else if (key == "boundaries") {
+                if (!value.isArray()) {
+                    return invalid(key, "an ascending array of positive integers");
+                }
+                result.boundaries.clear();
+                for (const auto &item : value.toArray()) {
+                    auto size = item.toInt64();
+                    if (!item.isInt() || size <= 0 ||
+                        (!result.boundaries.empty() && size <= result.boundaries.back())) {
+                        return invalid(key, "an ascending array of positive integers");
+                    }
+                    result.boundaries.push_back(size);
+                }
+            } else {
+                if (error) {
+                    *error = {
+                        Error::InvalidFormat,
+                        R"(unknown bucket option ")" + std::string(key) + '"',
+                    };
+                }
+                return false;
+            }
+        }
+        *this = result;
+        return true;
+    }
+
+    ShapeBuckets::ShapeBuckets(const SessionImage &image, const BucketConfig &config)
+        : m_image(image), m_config(config), m_axes(image.inputNames.size()) {
+        bool found = false;
+        for (size_t i = 0; i < m_axes.size(); ++i) {
+            auto typeInfo = image.session.GetInputTypeInfo(i);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR) {
+                continue;
+            }
+            auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+            auto shape = tensorInfo.GetShape();
+            auto symbols = tensorInfo.GetSymbolicDimensions();
+            for (size_t j = 0; j < shape.size() && j < symbols.size(); ++j) {
+                if (shape[j] >= 0 || !symbols[j] ||
+                    std::find(config.axes.begin(), config.axes.end(), symbols[j]) ==
+                        config.axes.end()) {
+                    continue;
+                }
+                if (elementSize(tensorInfo.GetElementType()) == 0) {
+                    m_reason = "input \"" + image.inputNames[i] + "\" is not a numeric tensor";
+                    return;
+                }
+                m_axes[i].push_back(int(j));
+                if (m_frameInput < 0 && symbols[j] == config.frameAxis) {
+                    m_frameInput = int(i);
+                    m_frameAxis = int(j);
+                }
+                found = true;
+            }
+        }
+        if (!found) {
+            m_reason = "no input has a dimension to pad";
+            return;
+        }
+
+        // The durations must keep adding up to the padded frames
+        const auto &inputNames = image.inputNames;
+        if (auto it = std::find(inputNames.begin(), inputNames.end(), config.durations);
+            m_frameInput >= 0 && it != inputNames.end()) {
+            auto index = size_t(it - inputNames.begin());
+            auto typeInfo = image.session.GetInputTypeInfo(index);
+            if (typeInfo.GetONNXType() != ONNX_TYPE_TENSOR ||
+                typeInfo.GetTensorTypeAndShapeInfo().GetElementType() !=
+                    ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64 ||
+                typeInfo.GetTensorTypeAndShapeInfo().GetShape().empty()) {
+                m_reason = "input \"" + config.durations +
+                           "\" is not an int64 tensor, it can't follow the padded frames";
+                return;
+            }
+            m_durationsInput = int(index);
+        }
+
+        // Outputs whose shapes are not known from the inputs may have padded axes that can't
+        // be found
+        for (size_t i = 0; i < image.outputInfos.size(); ++i) {
+            const auto &info = image.outputInfos[i];
+            if (!info.derivable || elementSize(info.type) == 0) {
+                m_reason = "the shape of output \"" + image.outputNames[i] +
+                           "\" doesn't follow from the input shapes";
+                return;
+            }
+        }
+    }
+
+    ShapeBuckets::~ShapeBuckets() = default;
+
+    bool ShapeBuckets::isUsable(std::string *reason) const {
+        if (reason) {
+            *reason = m_reason;
+        }
+        return m_config.isEnabled() && m_reason.empty();
+    }
+
+    bool ShapeBuckets::pad(const SharedValueMap &inputs, SharedValueMap &padded,
+                           std::vector<std::vector<int64_t>> &shapes) const {
+        const auto &inputNames = m_image.inputNames;
+        shapes.assign(inputNames.size(), {});
+
+        bool needed = false;
+        padded.clear();
+        for (const auto &[name, valuePtr] : inputs) {
+            auto index = size_t(std::find(inputNames.begin(), inputNames.end(), name) -
+                                inputNames.begin());
+            if (index >= inputNames.size() || !valuePtr || !valuePtr->IsTensor()) {
+                padded.emplace(name, valuePtr);
+                continue;
+            }
+            const auto &value = *valuePtr;
+            auto &shape = shapes[index];
+            shape = value.GetTensorTypeAndShapeInfo().GetShape();
+
+            auto paddedShape = shape;
+            for (auto axis : m_axes[index]) {
+                if (size_t(axis) < paddedShape.size()) {
+                    paddedShape[axis] = m_config.bucketSize(paddedShape[axis]);
+                }
+            }
+            if (paddedShape == shape) {
+                padded.emplace(name, valuePtr);
+                continue;
+            }
+            padded.emplace(name, makeSharedValue(resizeTensor(value, paddedShape)));
+            needed = true;
+        }
+        if (!needed || m_durationsInput < 0) {
+            return needed;
+        }
+
+        // The frames added by padding last as long as the last token, which is a padding token
+        // itself if the tokens are padded too
+        const auto &frameShape = shapes[m_frameInput];
+        auto it = padded.find(inputNames[m_durationsInput]);
+        if (frameShape.size() <= size_t(m_frameAxis) || it == padded.end()) {
+            return needed;
+        }
+        auto frames = frameShape[m_frameAxis];
+        auto added = m_config.bucketSize(frames) - frames;
+        if (added <= 0) {
+            return needed;
+        }
+        const auto &durations = *it->second;
+        auto durationsShape = durations.GetTensorTypeAndShapeInfo().GetShape();
+        auto last = durationsShape.empty() ? 0 : durationsShape.back();
+        if (last <= 0) {
+            return false; // nothing to lengthen, run unpadded
+        }
+        auto lengthened = resizeTensor(durations, durationsShape);
+        auto data = lengthened.GetTensorMutableData<int64_t>();
+        auto count = int64_t(lengthened.GetTensorTypeAndShapeInfo().GetElementCount());
+        for (int64_t i = last - 1; i < count; i += last) {
+            data[i] += added;
+        }
+        it->second = makeSharedValue(std::move(lengthened));
+        return needed;
+    }
+
+    SharedValueMap ShapeBuckets::crop(const SharedValueMap &outputs,
+                                      const std::vector<std::vector<int64_t>> &shapes) const {
+        const auto &outputNames = m_image.outputNames;
+        SharedValueMap result;
+        for (size_t i = 0; i < outputNames.size(); ++i) {
+            auto it = outputs.find(outputNames[i]);
+            if (it == outputs.end()) {
+                continue;
+            }
+            const auto &value = *it->second;
+            auto shape = value.GetTensorTypeAndShapeInfo().GetShape();
+
+            // Every axis taken from an input has the length of that input before padding
+            const auto &info = m_image.outputInfos[i];
+            auto croppedShape = shape;
+            for (size_t j = 0; j < croppedShape.size() && j < info.dims.size(); ++j) {
+                const auto &dim = info.dims[j];
+                if (dim.input < 0) {
+                    continue;
+                }
+                const auto &inputShape = shapes[dim.input];
+                if (size_t(dim.axis) < inputShape.size()) {
+                    croppedShape[j] = std::min(croppedShape[j], inputShape[dim.axis]);
+                }
+            }
+            if (croppedShape == shape) {
+                result.emplace(outputNames[i], it->second);
+                continue;
+            }
+            result.emplace(outputNames[i], makeSharedValue(resizeTensor(value, croppedShape)));
+        }
+        return result;
+    }
+
+}
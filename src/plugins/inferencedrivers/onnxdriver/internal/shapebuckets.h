@@ -0,0 +1,75 @@
+#ifndef DSINFER_ONNXDRIVER_SHAPEBUCKETS_H
+#define DSINFER_ONNXDRIVER_SHAPEBUCKETS_H
+
+#include <string>
+#include <vector>
+
+#include <dsinfer/error.h>
+#include <dsinfer/jsonvalue.h>
+
+#include "valuemap.h"
+
+namespace dsinfer::onnxdriver {
+
+    class SessionImage;
+
+    // Symbolic dimensions of the inputs that are padded, and the sizes they are padded to
+    struct BucketConfig {
+        std::vector<std::string> axes{"n_frames", "n_tokens"};
+
+        // An input of lengths along `frameAxis` that add up to it, such as the phoneme durations
+        // of acoustic models. The frames added by padding are added to its last entry
+        std::string durations = "durations";
+        std::string frameAxis = "n_frames";
+
+        // Ascending, a size beyond the last one is padded to a multiple of it. Empty disables
+        // bucketing
+        std::vector<int64_t> boundaries;
+
+        inline bool isEnabled() const {
+            return !boundaries.empty();
+        }
+
+        // The size that an axis of `size` is padded to
+        int64_t bucketSize(int64_t size) const;
+
+        // Overrides the options present in `obj`, unknown keys and invalid values are errors
+        bool parse(const JsonValue &obj, Error *error = nullptr);
+    };
+
+    // Pads the inputs of a session to a few shapes, so that onnxruntime reuses the memory
+    // planned for earlier runs, and cuts the outputs back to the lengths of the real inputs.
+    // The padded axes of each model are found once, by the names of their symbolic dimensions.
+    class ShapeBuckets {
+    public:
+        ShapeBuckets(const SessionImage &image, const BucketConfig &config);
+        ~ShapeBuckets();
+
+    public:
+        // Whether the model has a padded axis and every output can be cut back, otherwise
+        // `reason` is set
+        bool isUsable(std::string *reason = nullptr) const;
+
+        // Pads `inputs` into `padded` and keeps their shapes by input index in `shapes`,
+        // returns false if none of them needs padding
+        bool pad(const SharedValueMap &inputs, SharedValueMap &padded,
+                 std::vector<std::vector<int64_t>> &shapes) const;
+
+        // Cuts the outputs of a padded run to the input shapes kept by pad()
+        SharedValueMap crop(const SharedValueMap &outputs,
+                            const std::vector<std::vector<int64_t>> &shapes) const;
+
+    protected:
+        const SessionImage &m_image;
+        BucketConfig m_config;
+
+        std::vector<std::vector<int>> m_axes; // by input index, the padded axes
+        int m_frameInput = -1;                // an input with a padded frame axis, and the axis
+        int m_frameAxis = -1;
+        int m_durationsInput = -1;
+        std::string m_reason;                 // why the buckets can't be used, if so
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_SHAPEBUCKETS_H
@@ -0,0 +1,68 @@
+#include "taskexecutor.h"
+
+#include <algorithm>
+
+namespace dsinfer::onnxdriver {
+
+    TaskExecutor::TaskExecutor(int workerCount, size_t queueCapacity)
+        : m_queueCapacity(std::max<size_t>(queueCapacity, 1)) {
+        workerCount = std::max(workerCount, 1);
+        m_workers.reserve(workerCount);
+        for (int i = 0; i < workerCount; ++i) {
+            m_workers.emplace_back(&TaskExecutor::work, this);
+        }
+    }
+
+    TaskExecutor::~TaskExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+        for (auto &worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    bool TaskExecutor::post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping || m_queue.size() >= m_queueCapacity) {
+                return false;
+            }
+            m_queue.push_back(std::move(job));
+        }
+        m_cv.notify_one();
+        return true;
+    }
+
+    int TaskExecutor::workerCount() const {
+        return int(m_workers.size());
+    }
+
+    size_t TaskExecutor::queueCapacity() const {
+        return m_queueCapacity;
+    }
+
+    size_t TaskExecutor::pendingCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    void TaskExecutor::work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return;
+                }
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            job();
+        }
+    }
+
+}
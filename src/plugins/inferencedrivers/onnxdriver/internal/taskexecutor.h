@@ -0,0 +1,44 @@
+#ifndef DSINFER_ONNXDRIVER_TASKEXECUTOR_H
+#define DSINFER_ONNXDRIVER_TASKEXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsinfer::onnxdriver {
+
+    // Fixed pool of worker threads running the asynchronous tasks of the driver. Jobs beyond
+    // the capacity of the queue are rejected instead of piling up.
+    class TaskExecutor {
+    public:
+        TaskExecutor(int workerCount, size_t queueCapacity);
+        ~TaskExecutor(); // runs the queued jobs before returning
+
+        TaskExecutor(const TaskExecutor &) = delete;
+        TaskExecutor &operator=(const TaskExecutor &) = delete;
+
+    public:
+        // Returns false if the queue is full
+        bool post(std::function<void()> job);
+
+        int workerCount() const;
+        size_t queueCapacity() const;
+        size_t pendingCount() const;
+
+    protected:
+        void work();
+
+        size_t m_queueCapacity;
+        std::deque<std::function<void()>> m_queue;
+        bool m_stopping = false;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<std::thread> m_workers;
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_TASKEXECUTOR_H
@@ -0,0 +1,97 @@
+#ifndef DSINFER_ONNXDRIVER_TENSORCOPY_H
+#define DSINFER_ONNXDRIVER_TENSORCOPY_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+namespace dsinfer::onnxdriver {
+
+    // Size of an element of a tensor that can be padded and cut, 0 for the others
+    inline size_t elementSize(ONNXTensorElementDataType type) {
+        switch (type) {
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+                return 1;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+                return 2;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+                return 4;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+                return 8;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    // Byte strides of a tensor of `shape`
+    inline std::vector<int64_t> byteStrides(const std::vector<int64_t> &shape,
+                                            size_t elementSize) {
+        std::vector<int64_t> strides(shape.size());
+        int64_t stride = int64_t(elementSize);
+        for (size_t i = shape.size(); i > 0; --i) {
+            strides[i - 1] = stride;
+            stride *= shape[i - 1];
+        }
+        return strides;
+    }
+
+    // Copies the leading block of `block` elements between tensors of different shapes
+    inline void copyBlock(const char *src, const int64_t *srcStrides, char *dst,
+                          const int64_t *dstStrides, const int64_t *block, size_t rank) {
+        if (rank == 1) {
+            std::memcpy(dst, src, size_t(block[0] * srcStrides[0]));
+            return;
+        }
+        for (int64_t i = 0; i < block[0]; ++i) {
+            copyBlock(src + i * srcStrides[0], srcStrides + 1, dst + i * dstStrides[0],
+                      dstStrides + 1, block + 1, rank - 1);
+        }
+    }
+
+    // A copy of the tensor `value` of a type known to elementSize(), padded with zeros or cut
+    // to `shape` on every axis
+    inline Ort::Value resizeTensor(const Ort::Value &value, const std::vector<int64_t> &shape) {
+        auto info = value.GetTensorTypeAndShapeInfo();
+        auto srcShape = info.GetShape();
+        auto type = info.GetElementType();
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto result = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), type);
+        auto dst = static_cast<char *>(result.GetTensorMutableRawData());
+        std::memset(dst, 0, result.GetTensorSizeInBytes());
+
+        auto src = static_cast<const char *>(value.GetTensorRawData());
+        auto size = elementSize(type);
+        if (shape.empty() || srcShape.size() != shape.size()) {
+            if (shape.empty() && srcShape.empty()) {
+                std::memcpy(dst, src, size);
+            }
+            return result;
+        }
+
+        std::vector<int64_t> block(shape.size());
+        for (size_t i = 0; i < shape.size(); ++i) {
+            block[i] = std::min(shape[i], srcShape[i]);
+        }
+        if (std::find(block.begin(), block.end(), 0) == block.end()) {
+            copyBlock(src, byteStrides(srcShape, size).data(), dst,
+                      byteStrides(shape, size).data(), block.data(), block.size());
+        }
+        return result;
+    }
+
+}
+
+#endif // DSINFER_ONNXDRIVER_TENSORCOPY_H
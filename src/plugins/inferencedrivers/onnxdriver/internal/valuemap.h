@@ -15,6 +15,13 @@ namespace dsinfer::onnxdriver {
         return std::make_shared<Ort::Value>(std::move(value));
     }
 
+    // For a value that refers to memory kept alive by `owner`, which is released after it
+    inline std::shared_ptr<Ort::Value> makeSharedValue(Ort::Value &&value,
+                                                       std::shared_ptr<const void> owner) {
+        return {new Ort::Value(std::move(value)),
+                [owner = std::move(owner)](Ort::Value *ptr) { delete ptr; }};
+    }
+
     inline std::shared_ptr<Ort::Value> makeSharedValue(OrtValue *value) {
         return std::make_shared<Ort::Value>(value);
     }
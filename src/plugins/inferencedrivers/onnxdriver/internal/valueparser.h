@@ -1,31 +1,36 @@
 #ifndef DSINFER_ONNXDRIVER_TENSORPARSER_H
 #define DSINFER_ONNXDRIVER_TENSORPARSER_H
 
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <numeric>
+#include <string_view>
 
 #include <onnxruntime_cxx_api.h>
 
 #include <dsinfer/error.h>
 #include <dsinfer/jsonvalue.h>
 
+#include "valuemap.h"
+
 namespace dsinfer {
-    inline bool checkStringValue(const JsonObject &obj, const std::string &key, const std::string &value) {
+    inline bool checkStringValue(const JsonObjectRef &obj, std::string_view key, std::string_view value) {
         if (auto it = obj.find(key); it != obj.end()) {
             if (!it->second.isString()) {
                 return false;
             }
-            return it->second.toString() == value;
+            return it->second.toStringView() == value;
         }
         return false;
     }
 
-    inline bool checkStringValues(const JsonObject &obj, const std::string &key, const std::initializer_list<std::string> &values) {
+    inline bool checkStringValues(const JsonObjectRef &obj, std::string_view key, const std::initializer_list<std::string_view> &values) {
         if (auto it = obj.find(key); it != obj.end()) {
             if (!it->second.isString()) {
                 return false;
             }
-            const auto valString = it->second.toString();
+            const auto valString = it->second.toStringView();
             for (const auto &value : values) {
                 if (valString == value) {
                     return true;
@@ -39,12 +44,8 @@ namespace dsinfer {
 namespace dsinfer::onnxdriver {
 
     template <typename T>
-    inline Ort::Value createTensorFromBytes(OrtAllocator *allocator,
-                                            const uint8_t *data,
-                                            size_t dataSize,
-                                            const int64_t *shape,
-                                            size_t shapeSize,
-                                            Error *error = nullptr) {
+    inline bool checkTensorDataSize(size_t dataSize, const int64_t *shape, size_t shapeSize,
+                                    Error *error = nullptr) {
         auto expectedDataLength = std::reduce(shape, shape + shapeSize,
                                               int64_t{1}, std::multiplies<>());
         auto expectedBytes = expectedDataLength * sizeof(T);
@@ -53,8 +54,22 @@ namespace dsinfer::onnxdriver {
                 *error = Error(Error::InvalidFormat,
                                "Invalid input format: data size must match shape");
             }
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    inline Ort::Value createTensorFromBytes(OrtAllocator *allocator,
+                                            const uint8_t *data,
+                                            size_t dataSize,
+                                            const int64_t *shape,
+                                            size_t shapeSize,
+                                            Error *error = nullptr) {
+        if (!checkTensorDataSize<T>(dataSize, shape, shapeSize, error)) {
             return Ort::Value(nullptr);
         }
+        auto expectedBytes = dataSize;
         auto value = Ort::Value::CreateTensor<T>(allocator, shape, shapeSize);
         auto buffer = value.template GetTensorMutableData<uint8_t>();
         if (!buffer) {
@@ -68,44 +83,55 @@ namespace dsinfer::onnxdriver {
         return value;
     }
 
+    // Wraps the buffer without copying it if it has an owner and is aligned for T, the tensor
+    // then holds a reference to the owner. Otherwise the bytes are copied into a new tensor
+    template <typename T>
+    inline std::shared_ptr<Ort::Value> createSharedTensorFromBinary(const JsonBinary &binary,
+                                                                    const int64_t *shape,
+                                                                    size_t shapeSize,
+                                                                    Error *error = nullptr) {
+        bool aligned = reinterpret_cast<uintptr_t>(binary.data()) % alignof(T) == 0;
+        if (!binary.owner() || binary.empty() || !aligned) {
+            Ort::AllocatorWithDefaultOptions allocator;
+            auto value = createTensorFromBytes<T>(allocator, binary.data(), binary.size(), shape,
+                                                  shapeSize, error);
+            if (!value) {
+                return nullptr;
+            }
+            return makeSharedValue(std::move(value));
+        }
+        if (!checkTensorDataSize<T>(binary.size(), shape, shapeSize, error)) {
+            return nullptr;
+        }
+        // Input tensors are only read by onnxruntime
+        auto memInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+        auto data = reinterpret_cast<T *>(const_cast<uint8_t *>(binary.data()));
+        auto value = Ort::Value::CreateTensor<T>(memInfo, data, binary.size() / sizeof(T), shape,
+                                                 shapeSize);
+        return makeSharedValue(std::move(value), binary.owner());
+    }
+
     template <typename T>
-    inline Ort::Value createTensorFromJsonArray(const JsonArray &jsonArray,
+    inline Ort::Value createTensorFromJsonArray(const JsonValueRef &jsonArray,
                                                 const int64_t *shape,
                                                 size_t shapeSize,
                                                 Error *error = nullptr) {
         static_assert(std::is_same_v<T, float> || std::is_same_v<T, int64_t> || std::is_same_v<T, bool>);
 
-        auto expectedDataLength = std::reduce(shape, shape + shapeSize,
-                                              int64_t{1}, std::multiplies<>());
-        if (jsonArray.size() != expectedDataLength) {
-            if (error) {
-                *error = Error(Error::InvalidFormat,
-                               "Invalid input format: data size must match shape");
-            }
-            return Ort::Value(nullptr);
-        }
-        Ort::AllocatorWithDefaultOptions allocator;
-        auto value = Ort::Value::CreateTensor<T>(allocator, shape, shapeSize);
-        auto buffer = value.template GetTensorMutableData<T>();
-        if (!buffer) {
-            if (error) {
-                *error = Error(Error::InvalidFormat,
-                               "Failed to convert: ort tensor buffer is null");
-            }
-            return Ort::Value(nullptr);
+        JsonTypedArray::ElementType elementType;
+        if constexpr (std::is_same_v<T, float>) {
+            elementType = JsonTypedArray::Float32;
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            elementType = JsonTypedArray::Int64;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            elementType = JsonTypedArray::Bool;
         }
 
-        for (size_t i = 0; i < jsonArray.size(); ++i) {
-            // TODO: validate data type for jsonArray elements
-            if constexpr (std::is_same_v<T, float>) {
-                buffer[i] = static_cast<float>(jsonArray[i].toDouble());
-            } else if constexpr (std::is_same_v<T, int64_t>) {
-                buffer[i] = jsonArray[i].toInt64();
-            } else if constexpr (std::is_same_v<T, bool>) {
-                buffer[i] = jsonArray[i].toBool();
-            }
-        }
-        return value;
+        // Typed arrays of the same element type are used as is, other arrays are packed first
+        auto array = jsonArray.toTypedArray(elementType);
+        Ort::AllocatorWithDefaultOptions allocator;
+        return createTensorFromBytes<T>(allocator, array.binary().data(), array.binary().size(),
+                                        shape, shapeSize, error);
     }
 
     inline Ort::Value deserializeTensorFromBytes(const uint8_t *dataBuffer, size_t dataSize,
@@ -131,17 +157,19 @@ namespace dsinfer::onnxdriver {
         return Ort::Value(nullptr);
     }
 
-    inline Ort::Value deserializeTensor(const JsonValue &input, Error *error = nullptr) {
-        const auto &jVal_data = input["value"];  // bytes
-        const auto &jVal_type = input["type"];  // string
-        const auto &jVal_shape = input["shape"];  // array
+    // Validates the value, type and shape of a serialized tensor
+    inline bool parseTensorFormat(const JsonValueRef &input, std::string &type,
+                                  std::vector<int64_t> &shape, Error *error = nullptr) {
+        const auto jVal_data = input["value"];  // bytes
+        const auto jVal_type = input["type"];  // string
+        const auto jVal_shape = input["shape"];  // array
 
         if (!jVal_data.isBinary() && !jVal_data.isString() && !jVal_data.isArray()) {
             if (error) {
                 *error = dsinfer::Error(dsinfer::Error::InvalidFormat,
                                         "Invalid input format: value must be binary, string or array");
             }
-            return Ort::Value(nullptr);
+            return false;
         }
 
         if (!jVal_type.isString()) {
@@ -149,22 +177,22 @@ namespace dsinfer::onnxdriver {
                 *error = dsinfer::Error(dsinfer::Error::InvalidFormat,
                                         "Invalid input format: type must be string");
             }
-            return Ort::Value(nullptr);
+            return false;
         }
         if (!jVal_shape.isArray()) {
             if (error) {
                 *error = dsinfer::Error(dsinfer::Error::InvalidFormat,
                                         "Invalid input format: shape must be array");
             }
-            return Ort::Value(nullptr);
+            return false;
         }
 
         // process type
-        auto type = jVal_type.toString();
+        type = jVal_type.toString();
 
         // process shape
         auto jArr_shape = jVal_shape.toArray();
-        std::vector<int64_t> shape;
+        shape.clear();
         shape.reserve(jArr_shape.size());
         for (const auto &item: jArr_shape) {
             if (!item.isInt() && !item.isDouble()) {
@@ -172,27 +200,37 @@ namespace dsinfer::onnxdriver {
                     *error = Error(Error::InvalidFormat,
                                    "Invalid input format: shape array elements must be numbers");
                 }
-                return Ort::Value(nullptr);
+                return false;
             }
             auto shapeDimValue = item.toInt64();
             shape.push_back(shapeDimValue);
         }
+        return true;
+    }
+
+    inline Ort::Value deserializeTensor(const JsonValueRef &input, Error *error = nullptr) {
+        std::string type;
+        std::vector<int64_t> shape;
+        if (!parseTensorFormat(input, type, shape, error)) {
+            return Ort::Value(nullptr);
+        }
+        const auto jVal_data = input["value"];
 
         // process value
         if (jVal_data.isBinary()) {
-            auto data = jVal_data.toBinary();
+            // The payload is shared, it is copied only once into the tensor
+            auto data = jVal_data.toBinaryView();
             return deserializeTensorFromBytes(data.data(), data.size(), shape.data(), shape.size(), type, error);
         } else if (jVal_data.isString()) {
-            auto data = jVal_data.toString();
-            return deserializeTensorFromBytes(reinterpret_cast<uint8_t *>(data.data()), data.size(), shape.data(), shape.size(), type, error);
+            auto data = jVal_data.toStringView();
+            return deserializeTensorFromBytes(reinterpret_cast<const uint8_t *>(data.data()), data.size(), shape.data(), shape.size(), type, error);
         } else if (jVal_data.isArray()) {
-            auto dataArray = jVal_data.toArray();
             if (type == "float" || type == "float32") {
-                return createTensorFromJsonArray<float>(dataArray, shape.data(), shape.size(), error);
+                return createTensorFromJsonArray<float>(jVal_data, shape.data(), shape.size(), error);
             } else if (type == "int64") {
-                return createTensorFromJsonArray<int64_t>(dataArray, shape.data(), shape.size(), error);
+                return createTensorFromJsonArray<int64_t>(jVal_data, shape.data(), shape.size(), error);
             } else if (type == "bool") {
-                return createTensorFromJsonArray<bool>(dataArray, shape.data(), shape.size(), error);
+                return createTensorFromJsonArray<bool>(jVal_data, shape.data(), shape.size(), error);
             } else {
                 // TODO: support more data types
                 if (error) {
@@ -204,6 +242,47 @@ namespace dsinfer::onnxdriver {
         return Ort::Value(nullptr);
     }
 
+    // Like deserializeTensor(), but binary values are wrapped in place and arrays are packed
+    // once, the tensor keeps their buffer alive instead of copying it. Strings are copied.
+    inline std::shared_ptr<Ort::Value> deserializeSharedTensor(const JsonValueRef &input,
+                                                               Error *error = nullptr) {
+        std::string type;
+        std::vector<int64_t> shape;
+        if (!parseTensorFormat(input, type, shape, error)) {
+            return nullptr;
+        }
+        const auto jVal_data = input["value"];
+        if (jVal_data.isString()) {
+            auto value = deserializeTensor(input, error);
+            if (!value) {
+                return nullptr;
+            }
+            return makeSharedValue(std::move(value));
+        }
+
+        auto binaryOf = [&jVal_data](JsonTypedArray::ElementType elementType) {
+            return jVal_data.isBinary() ? jVal_data.toBinaryView()
+                                        : jVal_data.toTypedArray(elementType).binary();
+        };
+        if (type == "float" || type == "float32") {
+            return createSharedTensorFromBinary<float>(binaryOf(JsonTypedArray::Float32),
+                                                       shape.data(), shape.size(), error);
+        } else if (type == "int64") {
+            return createSharedTensorFromBinary<int64_t>(binaryOf(JsonTypedArray::Int64),
+                                                         shape.data(), shape.size(), error);
+        } else if (type == "bool") {
+            return createSharedTensorFromBinary<bool>(binaryOf(JsonTypedArray::Bool),
+                                                      shape.data(), shape.size(), error);
+        }
+
+        // unknown type
+        if (error) {
+            *error = Error(Error::InvalidFormat,
+                           "Invalid input format: unknown data type");
+        }
+        return nullptr;
+    }
+
     inline JsonValue serializeTensorAsBytes(const Ort::Value &tensor, Error *error = nullptr) {
         std::string dataType;
         size_t elemSize = 1;
@@ -255,11 +334,11 @@ namespace dsinfer::onnxdriver {
             return {};
         }
 
-        return JsonObject {
-            {"value", JsonValue(std::vector<uint8_t>(buffer, buffer + bufferSize))},
-            {"shape", shapeArray},
-            {"type", dataType},
-        };
+        JsonBuilder result;
+        result.insert("value", std::vector<uint8_t>(buffer, buffer + bufferSize))
+            .insert("shape", std::move(shapeArray))
+            .insert("type", dataType);
+        return result.build();
     }
 
     inline JsonValue serializeTensorAsArray(const Ort::Value &tensor, Error *error = nullptr) {
@@ -276,9 +355,8 @@ namespace dsinfer::onnxdriver {
         }
 
         // Serialize type and data
-        JsonArray dataArray;
+        JsonValue dataArray;
         auto elemCount = typeAndShapeInfo.GetElementCount();
-        dataArray.reserve(elemCount);
 
         switch (type) {
         case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT: {
@@ -291,9 +369,7 @@ namespace dsinfer::onnxdriver {
                 }
                 return {};
             }
-            for (size_t i = 0; i < elemCount; ++i) {
-                dataArray.emplace_back(buffer[i]);
-            }
+            dataArray = JsonTypedArray(buffer, elemCount);
             break;
         }
         case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64: {
@@ -306,9 +382,7 @@ namespace dsinfer::onnxdriver {
                 }
                 return {};
             }
-            for (size_t i = 0; i < elemCount; ++i) {
-                dataArray.emplace_back(buffer[i]);
-            }
+            dataArray = JsonTypedArray(buffer, elemCount);
             break;
         }
         case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL: {
@@ -321,9 +395,7 @@ namespace dsinfer::onnxdriver {
                 }
                 return {};
             }
-            for (size_t i = 0; i < elemCount; ++i) {
-                dataArray.emplace_back(buffer[i]);
-            }
+            dataArray = JsonTypedArray(buffer, elemCount);
             break;
         }
         default:
@@ -334,17 +406,18 @@ namespace dsinfer::onnxdriver {
             return false; // Unknown tensor type
         }
 
-        return JsonObject {
-            {"value", dataArray},
-            {"shape", shapeArray},
-            {"type", dataType},
-        };
+        JsonBuilder result;
+        result.insert("value", std::move(dataArray))
+            .insert("shape", std::move(shapeArray))
+            .insert("type", dataType);
+        return result.build();
     }
 
-    inline Ort::Value parseInputContent(const JsonObject &content, Error *error = nullptr) {
+    inline std::shared_ptr<Ort::Value> parseInputContent(const JsonObjectRef &content,
+                                                         Error *error = nullptr) {
         if (auto it_content = content.find("data"); it_content != content.end()) {
             if (checkStringValues(content, "format", {"bytes", "array"})) {
-                return onnxdriver::deserializeTensor(it_content->second.toObject(), error);
+                return onnxdriver::deserializeSharedTensor(it_content->second, error);
             }
         } else {
             if (error) {
@@ -352,7 +425,7 @@ namespace dsinfer::onnxdriver {
                                "Failed to parse content");
             }
         }
-        return Ort::Value(nullptr);
+        return nullptr;
     }
 }
 
@@ -0,0 +1,70 @@
+#include "warmupconfig.h"
+
+namespace dsinfer::onnxdriver {
+
+    int64_t WarmupConfig::dimSize(const char *symbol) const {
+        if (symbol) {
+            if (auto it = dims.find(symbol); it != dims.end()) {
+                return it->second;
+            }
+        }
+        return 1;
+    }
+
+    bool WarmupConfig::parse(const JsonValue &obj, Error *error) {
+        auto invalid = [error](std::string_view key, const char *expected) {
+            if (error) {
+                *error = {
+                    Error::InvalidFormat,
+                    R"(invalid warm-up option ")" + std::string(key) + R"(", expected )" +
+                        expected,
+                };
+            }
+            return false;
+        };
+
+        if (!obj.isObject()) {
+            if (error) {
+                *error = {Error::InvalidFormat, "warm-up options must be an object"};
+            }
+            return false;
+        }
+
+        auto result = *this;
+        for (const auto &[key, value] : JsonValueRef(obj).toObject()) {
+            if (key == "runs") {
+                if (!value.isInt() || value.toInt() < 0) {
+                    return invalid(key, "a non-negative integer");
+                }
+                result.runs = value.toInt();
+            } else if (key == "background") {
+                if (!value.isBool()) {
+                    return invalid(key, "a boolean");
+                }
+                result.background = value.toBool();
+            } else if (key == "dims") {
+                if (!value.isObject()) {
+                    return invalid(key, "an object of positive integers");
+                }
+                result.dims.clear();
+                for (const auto &[name, size] : value.toObject()) {
+                    if (!size.isInt() || size.toInt64() <= 0) {
+                        return invalid(key, "an object of positive integers");
+                    }
+                    result.dims[std::string(name)] = size.toInt64();
+                }
+            } else {
+                if (error) {
+                    *error = {
+                        Error::InvalidFormat,
+                        R"(unknown warm-up option ")" + std::string(key) + '"',
+                    };
+                }
+                return false;
+            }
+        }
+        *this = result;
+        return true;
+    }
+
+}
@@ -0,0 +1,34 @@
+#ifndef DSINFER_ONNXDRIVER_WARMUPCONFIG_H
+#define DSINFER_ONNXDRIVER_WARMUPCONFIG_H
+
+#include <map>
+#include <string>
+
+#include <dsinfer/error.h>
+#include <dsinfer/jsonvalue.h>
+
+namespace dsinfer::onnxdriver {
+
+    // Runs of a session image on synthesized inputs right after it is opened, so that kernels,
+    // the arena and prepacked weights are ready before the first real run
+    struct WarmupConfig {
+        int runs = 0; // 0 disables the warm-up
+        bool background = false;
+
+        // Sizes of the symbolic dimensions of the inputs, the others are 1
+        std::map<std::string, int64_t> dims;
+
+        inline bool isEnabled() const {
+            return runs > 0;
+        }
+
+        // The size of a dynamic dimension named `symbol`
+        int64_t dimSize(const char *symbol) const;
+
+        // Overrides the options present in `obj`, unknown keys and invalid values are errors
+        bool parse(const JsonValue &obj, Error *error = nullptr);
+    };
+
+}
+
+#endif // DSINFER_ONNXDRIVER_WARMUPCONFIG_H
@@ -32,6 +32,14 @@ namespace dsinfer {
         return idManager().get(contextId);
     }
 
+    OnnxContext *OnnxContext::acquireContext(int64_t contextId) {
+        return idManager().acquire(contextId);
+    }
+
+    void OnnxContext::releaseContext(int64_t contextId) {
+        idManager().release(contextId);
+    }
+
     int64_t OnnxContext::id() const {
         __stdc_impl_t;
         return impl.contextId;
@@ -39,7 +47,7 @@ namespace dsinfer {
 
     bool OnnxContext::insertObject(const std::string &key, const JsonValue &value) {
         __stdc_impl_t;
-        auto obj = value.toObject();
+        auto obj = JsonValueRef(value).toObject();
         if (!checkStringValue(obj, "type", "object")) {
             return false;
         }
@@ -54,7 +62,7 @@ namespace dsinfer {
                 // Save Ort::Value to value map
                 {
                     std::unique_lock<std::shared_mutex> lock(impl.mtx);
-                    impl.valueMap[key] = onnxdriver::makeSharedValue(std::move(ortVal));
+                    impl.valueMap[key] = std::move(ortVal);
                 }
                 onnxdriver_log().info("OnnxContext [%1] - Inserted value \"%2\" to context", impl.contextId, key);
                 return true;
@@ -14,6 +14,10 @@ namespace dsinfer {
 
         static OnnxContext *getContext(int64_t contextId);
 
+        // Like getContext(), but the context is not destroyed until it is released
+        static OnnxContext *acquireContext(int64_t contextId);
+        static void releaseContext(int64_t contextId);
+
     public:
         int64_t id() const override;
 
@@ -1,10 +1,21 @@
 #include "onnxdriver.h"
 
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include <stdcorelib/path.h>
+#include <stdcorelib/strings.h>
+
 #include "onnxsession.h"
 #include "onnxtask.h"
 #include "onnxcontext.h"
 
 #include "env.h"
+#include "mappedfile.h"
+#include "onnxdriver_logger.h"
+#include "session.h"
+#include "taskexecutor.h"
 
 namespace dsinfer {
 
@@ -14,7 +25,11 @@ namespace dsinfer {
         }
 
         ~Impl() {
+            // Preloads open sessions of the environment, the queued ones still run
+            preloader.reset();
             if (initialized) {
+                // Idle session images still refer to the environment
+                onnxdriver::Session::releaseIdleImages();
                 delete shared_env;
             }
         }
@@ -22,6 +37,13 @@ namespace dsinfer {
         std::filesystem::path runtimePath;
         bool initialized = false;
 
+        // Opens the preloaded sessions, a few at a time
+        std::unique_ptr<onnxdriver::TaskExecutor> preloader;
+        std::mutex preloadMutex;
+
+        static constexpr int maxPreloadWorkers = 4;
+        static constexpr size_t preloadQueueCapacity = 256;
+
         static inline onnxdriver::Env *shared_env = nullptr;
     };
 
@@ -47,6 +69,18 @@ namespace dsinfer {
         // Parse args
         onnxdriver::ExecutionProvider ep = onnxdriver::EP_CPU;
         int deviceIndex = 0;
+        std::filesystem::path cacheDir;
+        bool modelCache = true;
+        int mmapAdvice = onnxdriver::MappedFile::NoAdvice;
+        int asyncWorkers = 0;
+        int asyncQueueSize = 64;
+        int batchMaxSize = 8;
+        int batchWindowUs = 2000;
+        int idleCacheMB = 0; // the idle cache is opt-in, closing a session frees its image
+        int idleTtlSeconds = 300;
+        auto fingerprintAlgorithm = onnxdriver::FA_XXH3Tree;
+        onnxdriver::ThreadPoolOptions threadPoolOptions;
+        onnxdriver::SessionConfig sessionConfig;
         {
             auto obj = args.toObject();
 
@@ -76,6 +110,132 @@ namespace dsinfer {
                     deviceIndex = 0;
                 }
             }
+
+            // global thread pools, workers of asynchronous tasks, batching window and cache of
+            // idle session images
+            for (auto [key, value] : {
+                     std::make_pair("intraOpThreads", &threadPoolOptions.intraOpThreads),
+                     std::make_pair("interOpThreads", &threadPoolOptions.interOpThreads),
+                     std::make_pair("asyncWorkers", &asyncWorkers),
+                     std::make_pair("batchWindowUs", &batchWindowUs),
+                     std::make_pair("idleCacheMB", &idleCacheMB),
+                     std::make_pair("idleTtlSeconds", &idleTtlSeconds),
+                 }) {
+                if (auto it = obj.find(key); it != obj.end()) {
+                    if (!it->second.isInt() || it->second.toInt() < 0) {
+                        if (error) {
+                            *error = {
+                                Error::InvalidFormat,
+                                stdc::formatN(R"(invalid "%1", expected a non-negative integer)",
+                                              key),
+                            };
+                        }
+                        return false;
+                    }
+                    *value = it->second.toInt();
+                }
+            }
+            for (auto [key, value] : {
+                     std::make_pair("allowSpinning", &threadPoolOptions.allowSpinning),
+                     std::make_pair("denormalAsZero", &threadPoolOptions.denormalAsZero),
+                     std::make_pair("modelCache", &modelCache),
+                 }) {
+                if (auto it = obj.find(key); it != obj.end()) {
+                    if (!it->second.isBool()) {
+                        if (error) {
+                            *error = {
+                                Error::InvalidFormat,
+                                stdc::formatN(R"(invalid "%1", expected a boolean)", key),
+                            };
+                        }
+                        return false;
+                    }
+                    *value = it->second.toBool();
+                }
+            }
+
+            // queue of asynchronous tasks
+            if (auto it = obj.find("asyncQueueSize"); it != obj.end()) {
+                if (!it->second.isInt() || it->second.toInt() <= 0) {
+                    if (error) {
+                        *error = {
+                            Error::InvalidFormat,
+                            R"(invalid "asyncQueueSize", expected a positive integer)",
+                        };
+                    }
+                    return false;
+                }
+                asyncQueueSize = it->second.toInt();
+            }
+
+            // runs of batching sessions stacked together
+            if (auto it = obj.find("batchMaxSize"); it != obj.end()) {
+                if (!it->second.isInt() || it->second.toInt() <= 0) {
+                    if (error) {
+                        *error = {
+                            Error::InvalidFormat,
+                            R"(invalid "batchMaxSize", expected a positive integer)",
+                        };
+                    }
+                    return false;
+                }
+                batchMaxSize = it->second.toInt();
+            }
+
+            // madvise hints of mapped models
+            if (auto it = obj.find("mmapAdvice"); it != obj.end()) {
+                auto items = it->second.isArray() ? it->second.toArray() : JsonArray();
+                bool ok = it->second.isArray();
+                for (const auto &item : std::as_const(items)) {
+                    auto name = item.toString();
+                    if (name == "sequential") {
+                        mmapAdvice |= onnxdriver::MappedFile::Sequential;
+                    } else if (name == "willneed") {
+                        mmapAdvice |= onnxdriver::MappedFile::WillNeed;
+                    } else if (name == "hugepage") {
+                        mmapAdvice |= onnxdriver::MappedFile::HugePage;
+                    } else {
+                        ok = false;
+                    }
+                }
+                if (!ok) {
+                    if (error) {
+                        *error = {
+                            Error::InvalidFormat,
+                            R"(invalid "mmapAdvice", expected an array of "sequential", )"
+                            R"("willneed" or "hugepage")",
+                        };
+                    }
+                    return false;
+                }
+            }
+
+            // defaults of every session
+            if (auto it = obj.find("sessionOptions"); it != obj.end()) {
+                if (!sessionConfig.parse(it->second, error)) {
+                    return false;
+                }
+            }
+
+            // fingerprint algorithm
+            if (auto it = obj.find("fingerprint"); it != obj.end()) {
+                if (!it->second.isString() ||
+                    !onnxdriver::parseFingerprintAlgorithm(it->second.toString(),
+                                                           fingerprintAlgorithm)) {
+                    if (error) {
+                        *error = {
+                            Error::InvalidFormat,
+                            R"(invalid "fingerprint", expected "sha256" or "xxh3")",
+                        };
+                    }
+                    return false;
+                }
+            }
+
+            // cache directory
+            if (auto it = obj.find("cacheDir"); it != obj.end() && it->second.isString()) {
+                cacheDir = stdc::path::from_utf8(it->second.toString());
+            }
         }
 
         auto dllPath = impl.runtimePath /
@@ -90,7 +250,7 @@ namespace dsinfer {
 
         // Load
         auto env = new onnxdriver::Env();
-        if (std::string errorMessage; !env->load(dllPath, ep, &errorMessage)) {
+        if (std::string errorMessage; !env->load(dllPath, ep, threadPoolOptions, &errorMessage)) {
             if (error) {
                 *error = Error(Error::LibraryNotFound, errorMessage);
             }
@@ -98,6 +258,14 @@ namespace dsinfer {
             return false;
         }
         env->setDeviceIndex(deviceIndex);
+        env->setDefaultSessionConfig(sessionConfig);
+        env->setFingerprintAlgorithm(fingerprintAlgorithm);
+        env->setCacheDirectory(cacheDir);
+        env->setModelCacheEnabled(modelCache);
+        env->setMmapAdvice(mmapAdvice);
+        env->setExecutorOptions(asyncWorkers, asyncQueueSize);
+        env->setBatchOptions(batchMaxSize, std::chrono::microseconds(batchWindowUs));
+        env->setIdleCacheOptions(int64_t(idleCacheMB) << 20, std::chrono::seconds(idleTtlSeconds));
 
         impl.initialized = true;
         impl.shared_env = env;
@@ -116,4 +284,84 @@ namespace dsinfer {
         return new OnnxContext();
     }
 
-}
\ No newline at end of file
+    bool OnnxDriver::preload(const std::vector<std::filesystem::path> &paths,
+                             const JsonValue &args, Error *error) {
+        __stdc_impl_t;
+        if (!impl.initialized) {
+            if (error) {
+                *error = {
+                    Error::SessionError,
+                    "onnx driver is not initialized",
+                };
+            }
+            return false;
+        }
+        if (!(args.isUndefined() || args.isNull() || args.isObject())) {
+            if (error) {
+                *error = {
+                    Error::InvalidFormat,
+                    "invalid preload args, expected an object",
+                };
+            }
+            return false;
+        }
+
+        // Let the system read all files at once, the sessions then load them from memory
+        for (const auto &path : paths) {
+            std::ignore = onnxdriver::MappedFile::readAhead(path);
+        }
+
+        // A closed session keeps its image only in the idle cache
+        if (impl.shared_env->idleCacheBytes() <= 0) {
+            onnxdriver_log().info("OnnxDriver - Idle cache disabled, %1 models only read ahead",
+                                  paths.size());
+            return true;
+        }
+
+        // Open the sessions in parallel, their images stay idle until the sessions opened later
+        // with the same args take them
+        std::lock_guard<std::mutex> lock(impl.preloadMutex);
+        if (!impl.preloader) {
+            int workers = std::min(int(std::max(std::thread::hardware_concurrency(), 1u)),
+                                   Impl::maxPreloadWorkers);
+            impl.preloader =
+                std::make_unique<onnxdriver::TaskExecutor>(workers, Impl::preloadQueueCapacity);
+        }
+        for (const auto &path : paths) {
+            bool posted = impl.preloader->post([path, args] {
+                onnxdriver_log().debug("OnnxDriver - Preloading %1", path.filename());
+                OnnxSession session;
+                if (Error error; !session.open(path, args, &error)) {
+                    onnxdriver_log().warning("OnnxDriver - Failed to preload %1: %2",
+                                             path.filename(), error.message());
+                    return;
+                }
+                std::ignore = session.close(nullptr);
+            });
+            if (!posted) {
+                onnxdriver_log().warning("OnnxDriver - Too many pending preloads, %1 only read ahead",
+                                         path.filename());
+            }
+        }
+        return true;
+    }
+
+    bool OnnxDriver::executeCommand(const JsonValue &input, JsonValue *output) {
+        auto cmd = input["command"].toString();
+        if (cmd == "idleCacheStats") {
+            if (!output) {
+                return false;
+            }
+            auto stats = onnxdriver::Session::idleCacheStats();
+            *output = JsonObject{
+                {"images",    stats.images   },
+                {"bytes",     stats.bytes    },
+                {"hits",      stats.hits     },
+                {"evictions", stats.evictions},
+            };
+            return true;
+        }
+        return false;
+    }
+
+}
@@ -17,6 +17,16 @@ namespace dsinfer {
         InferenceTask *createTask() override;
         InferenceContext *createContext() override;
 
+        // The loaded images are kept in the idle cache until the sessions take them, so the
+        // driver must be initialized with a non-zero "idleCacheMB". Otherwise the models are
+        // only read ahead into the page cache
+        bool preload(const std::vector<std::filesystem::path> &paths, const JsonValue &args,
+                     Error *error) override;
+
+        // "idleCacheStats": the number and estimated bytes of the idle session images, and the
+        // opens that reused one and the images evicted so far
+        bool executeCommand(const JsonValue &input, JsonValue *output) override;
+
     protected:
         class Impl;
         std::unique_ptr<Impl> _impl;
@@ -4,6 +4,7 @@
 #include "internal/onnxdriver_common.h"
 #include "internal/onnxdriver_logger.h"
 #include "internal/session.h"
+#include "internal/env.h"
 #include "internal/idutil.h"
 
 namespace dsinfer {
@@ -32,6 +33,14 @@ namespace dsinfer {
         return idManager().get(sessionId);
     }
 
+    OnnxSession *OnnxSession::acquireSession(int64_t sessionId) {
+        return idManager().acquire(sessionId);
+    }
+
+    void OnnxSession::releaseSession(int64_t sessionId) {
+        idManager().release(sessionId);
+    }
+
     bool OnnxSession::open(const std::filesystem::path &path, const JsonValue &args, Error *error) {
         __stdc_impl_t;
         int hints = 0;
@@ -41,7 +50,43 @@ namespace dsinfer {
                 hints |= onnxdriver::SH_PreferCPUHint;
             }
         }
-        return impl.session.open(path, hints, error);
+        if (auto it = obj.find("batching"); it != obj.end()) {
+            if (it->second.isBool() && it->second.toBool()) {
+                hints |= onnxdriver::SH_BatchRunsHint;
+            }
+        }
+
+        // Driver defaults, overridden by the options of this session
+        auto env = onnxdriver::Env::instance();
+        auto config = env ? env->defaultSessionConfig() : onnxdriver::SessionConfig();
+        if (auto it = obj.find("sessionOptions"); it != obj.end()) {
+            if (!config.parse(it->second, error)) {
+                return false;
+            }
+        }
+        onnxdriver::BucketConfig bucketConfig;
+        if (auto it = obj.find("buckets"); it != obj.end()) {
+            if (!bucketConfig.parse(it->second, error)) {
+                return false;
+            }
+        }
+        onnxdriver::WarmupConfig warmupConfig;
+        if (auto it = obj.find("warmup"); it != obj.end()) {
+            if (!warmupConfig.parse(it->second, error)) {
+                return false;
+            }
+        }
+        if (!impl.session.open(path, hints, config, error)) {
+            return false;
+        }
+        if (bucketConfig.isEnabled() && !impl.session.setBucketConfig(bucketConfig, error)) {
+            impl.session.close();
+            return false;
+        }
+        if (warmupConfig.isEnabled()) {
+            impl.session.warmUp(warmupConfig);
+        }
+        return true;
     }
 
     bool OnnxSession::isOpen() const {
@@ -61,8 +106,7 @@ namespace dsinfer {
 
     bool OnnxSession::isRunning() const {
         __stdc_impl_t;
-        // TODO: implement
-        return false;
+        return impl.session.isRunning();
     }
 
 }
\ No newline at end of file
@@ -12,6 +12,10 @@ namespace dsinfer {
 
         static OnnxSession *getSession(int64_t sessionId);
 
+        // Like getSession(), but the session is not destroyed until it is released
+        static OnnxSession *acquireSession(int64_t sessionId);
+        static void releaseSession(int64_t sessionId);
+
     public:
         bool open(const std::filesystem::path &path, const JsonValue &args, Error *error) override;
         bool close(Error *error) override;
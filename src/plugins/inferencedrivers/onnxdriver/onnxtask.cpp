@@ -1,6 +1,7 @@
 #include "onnxtask.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <unordered_set>
 #include <random>
@@ -15,6 +16,7 @@
 #include "internal/onnxdriver_logger.h"
 #include "internal/valueparser.h"
 #include "internal/idutil.h"
+#include "internal/env.h"
 
 namespace dsinfer {
 
@@ -37,14 +39,25 @@ namespace dsinfer {
     public:
         class ScopedStateUpdater;
 
-        bool prepareRunData(const JsonObject &obj, onnxdriver::SharedValueMap &valueMap, JsonArray &outputArr, Error *error);
-        bool processRunResult(const JsonArray &outputArr, const onnxdriver::SharedValueMap &sessionResult, Error *error);
+        bool prepareRunData(const JsonObjectRef &obj, onnxdriver::SharedValueMap &valueMap, JsonArrayRef &outputArr, Error *error);
+        bool processRunResult(const JsonArrayRef &outputArr, const onnxdriver::SharedValueMap &sessionResult, Error *error);
+        bool execute(const onnxdriver::SharedValueMap &valueMap, const JsonArrayRef &outputArr, Error *error);
 
         int64_t taskId = 0;
         std::atomic<State> state = State::Terminated;
+        int64_t sessionId = 0;
+        int64_t contextId = 0;
         OnnxSession *sessionObj = nullptr;
         OnnxContext *contextObj = nullptr;
-        std::vector<JsonValue> result;
+        // Cancels the run of this task only, other tasks of the session keep running
+        onnxdriver::RunHandle runHandle;
+        // Shared with the callers of result(), which may encode it with toCbor() without copying
+        JsonValue result = JsonValue::Array;
+
+        // Set while an asynchronous run is queued or running, the task waits for it on destruction
+        bool asyncPending = false;
+        std::mutex asyncMutex;
+        std::condition_variable asyncFinished;
     };
 
     class OnnxTask::Impl::ScopedStateUpdater {
@@ -66,9 +79,9 @@ namespace dsinfer {
         State m_targetState;
     };
 
-    bool OnnxTask::Impl::prepareRunData(const JsonObject &obj,
+    bool OnnxTask::Impl::prepareRunData(const JsonObjectRef &obj,
                                         onnxdriver::SharedValueMap &valueMap,
-                                        JsonArray &outputArr,
+                                        JsonArrayRef &outputArr,
                                         Error *error) {
         int64_t sessionId = 0;
         int64_t contextId = 0;
@@ -90,6 +103,8 @@ namespace dsinfer {
             }
             return false;
         }
+        this->sessionId = sessionId;
+        this->contextId = contextId;
         sessionObj = OnnxSession::getSession(sessionId);
         contextObj = OnnxContext::getContext(contextId);
         if (!sessionObj) {
@@ -144,7 +159,7 @@ namespace dsinfer {
 
         auto inputArr = it_input->second.toArray();
 
-        for (const auto &inputData : std::as_const(inputArr)) {
+        for (const auto &inputData : inputArr) {
             auto inputDataObj = inputData.toObject();
             auto it_name = inputDataObj.find("name");
             if (it_name == inputDataObj.end() || !it_name->second.isString()) {
@@ -186,8 +201,7 @@ namespace dsinfer {
                 if (!inputValue) {
                     return false;
                 }
-                valueMap[it_name->second.toString()] =
-                    onnxdriver::makeSharedValue(std::move(inputValue));
+                valueMap[it_name->second.toString()] = std::move(inputValue);
             }
         }
 
@@ -196,10 +210,12 @@ namespace dsinfer {
         return true;
     }
 
-    bool OnnxTask::Impl::processRunResult(const JsonArray &outputArr,
+    bool OnnxTask::Impl::processRunResult(const JsonArrayRef &outputArr,
                                           const onnxdriver::SharedValueMap &sessionResult,
                                           Error *error) {
-        for (const auto &outputData : std::as_const(outputArr)) {
+        JsonBuilder resultArray(JsonValue::Array);
+        resultArray.reserve(outputArr.size());
+        for (const auto &outputData : outputArr) {
             auto outputDataObj = outputData.toObject();
             auto name = outputDataObj["name"].toString();
             if (auto it = sessionResult.find(name); it != sessionResult.end()) {
@@ -213,11 +229,11 @@ namespace dsinfer {
                         }
                         return false;
                     }
-                    result.emplace_back(JsonObject{
-                        {"name",   name   },
-                        {"format", "bytes"},
-                        {"data",   jVal   }
-                    });
+                    JsonBuilder resultData;
+                    resultData.insert("name", name)
+                        .insert("format", "bytes")
+                        .insert("data", std::move(jVal));
+                    resultArray.append(resultData.build());
                 } else if (format == "array") {
                     Error err_;
                     auto jVal = onnxdriver::serializeTensorAsArray(*it->second, &err_);
@@ -227,15 +243,15 @@ namespace dsinfer {
                         }
                         return false;
                     }
-                    result.emplace_back(JsonObject{
-                        {"name",   name   },
-                        {"format", "array"},
-                        {"data",   jVal   }
-                    });
+                    JsonBuilder resultData;
+                    resultData.insert("name", name)
+                        .insert("format", "array")
+                        .insert("data", std::move(jVal));
+                    resultArray.append(resultData.build());
                 } else if (format == "reference") {
                     auto uuidKey = generate_uuid();
                     contextObj->_impl->insertOrtValue(uuidKey, it->second);
-                    result.emplace_back(JsonObject{
+                    resultArray.append(JsonObject{
                         {"name",   name                          },
                         {"format", "reference"                   },
                         {"data",   JsonObject{{"value", uuidKey}}}
@@ -249,9 +265,20 @@ namespace dsinfer {
                 return false;
             }
         }
+        result = resultArray.build();
         return true;
     }
 
+    // Runs the prepared inputs and stores the result, the state is left to the caller
+    bool OnnxTask::Impl::execute(const onnxdriver::SharedValueMap &valueMap,
+                                 const JsonArrayRef &outputArr, Error *error) {
+        auto sessionResult = sessionObj->_impl->session.run(valueMap, error, &runHandle);
+        if (sessionResult.empty()) {
+            return false;
+        }
+        return processRunResult(outputArr, sessionResult, error);
+    }
+
     OnnxTask::OnnxTask() : _impl(std::make_unique<Impl>()) {
         __stdc_impl_t;
         auto taskId = idManager().add(this);
@@ -262,22 +289,38 @@ namespace dsinfer {
     OnnxTask::~OnnxTask() {
         __stdc_impl_t;
 
+        // Cancel a pending asynchronous run, which still refers to the task
+        impl.runHandle.terminate();
+        {
+            std::unique_lock<std::mutex> lock(impl.asyncMutex);
+            impl.asyncFinished.wait(lock, [&impl] { return !impl.asyncPending; });
+        }
         idManager().remove(impl.taskId);
     }
 
     bool OnnxTask::initialize(const JsonValue &args, Error *error) {
         __stdc_impl_t;
-        impl.result.clear();
+        impl.result = JsonValue::Array;
         impl.state = State::Idle;
         return true;
     }
 
     bool OnnxTask::start(const JsonValue &input, Error *error) {
         __stdc_impl_t;
+        std::unique_lock<std::mutex> lock(impl.asyncMutex);
+        if (impl.asyncPending || impl.state == State::Running) {
+            if (error) {
+                *error = Error(Error::SessionError, "Task is already running");
+            }
+            return false;
+        }
+
         // When leaving the function, the state will be automatically set to Failed,
         // unless calling setTargetState.
         Impl::ScopedStateUpdater stateUpdater(&impl, State::Failed);
         impl.state = State::Running;
+        impl.runHandle.reset();
+        lock.unlock();
 
         if (!input.isObject()) {
             if (error) {
@@ -287,19 +330,18 @@ namespace dsinfer {
             return false;
         }
 
+        // The task input may carry large tensors, read it in place instead of copying
         onnxdriver::SharedValueMap valueMap;
-        JsonArray outputArr;
+        JsonArrayRef outputArr;
 
-        if (!impl.prepareRunData(input.toObject(), valueMap, outputArr, error)) {
+        if (!impl.prepareRunData(JsonValueRef(input).toObject(), valueMap, outputArr, error)) {
             return false;
         }
 
-        auto sessionResult = impl.sessionObj->_impl->session.run(valueMap, error);
-        if (sessionResult.empty()) {
-            return false;
-        }
-
-        if (!impl.processRunResult(outputArr, sessionResult, error)) {
+        if (!impl.execute(valueMap, outputArr, error)) {
+            if (impl.runHandle.isTerminated()) {
+                stateUpdater.setTargetState(State::Terminated);
+            }
             return false;
         }
 
@@ -310,8 +352,98 @@ namespace dsinfer {
     bool OnnxTask::startAsync(const JsonValue &input,
                               const std::function<void(const JsonValue &, const Error &)> &callback,
                               Error *error) {
-        // To be implemented
-        return false;
+        __stdc_impl_t;
+        std::unique_lock<std::mutex> lock(impl.asyncMutex);
+        if (impl.asyncPending || impl.state == State::Running) {
+            if (error) {
+                *error = Error(Error::SessionError, "Task is already running");
+            }
+            return false;
+        }
+
+        // The inputs are prepared on the calling thread, so that invalid input is reported here
+        Impl::ScopedStateUpdater stateUpdater(&impl, State::Failed);
+        impl.state = State::Running;
+        impl.runHandle.reset();
+
+        if (!input.isObject()) {
+            if (error) {
+                *error = Error(Error::InvalidFormat,
+                               "Invalid task input format: input value is not object");
+            }
+            return false;
+        }
+
+        onnxdriver::SharedValueMap valueMap;
+        JsonArrayRef outputArr;
+        if (!impl.prepareRunData(JsonValueRef(input).toObject(), valueMap, outputArr, error)) {
+            return false;
+        }
+
+        auto env = onnxdriver::Env::instance();
+        auto executor = env ? env->executor() : nullptr;
+        if (!executor) {
+            if (error) {
+                *error = Error(Error::SessionError, "The environment is not initialized");
+            }
+            return false;
+        }
+
+        // `input` is captured to keep the nodes viewed by `outputArr` alive
+        auto job = [&impl, input, valueMap = std::move(valueMap), outputArr, callback]() mutable {
+            // The session and the context may have been destroyed while the job was queued, look
+            // them up again and keep them until the run is done
+            auto sessionObj = OnnxSession::acquireSession(impl.sessionId);
+            auto contextObj = OnnxContext::acquireContext(impl.contextId);
+
+            Error runError;
+            bool ok = false;
+            if (impl.runHandle.isTerminated()) {
+                runError = Error(Error::SessionError, "Task was stopped");
+            } else if (!sessionObj || !contextObj) {
+                runError = Error(Error::SessionError,
+                                 "Session " + std::to_string(impl.sessionId) + " or context " +
+                                     std::to_string(impl.contextId) + " no longer exists");
+            } else {
+                impl.sessionObj = sessionObj;
+                impl.contextObj = contextObj;
+                ok = impl.execute(valueMap, outputArr, &runError);
+            }
+            valueMap.clear();
+
+            if (sessionObj) {
+                OnnxSession::releaseSession(impl.sessionId);
+            }
+            if (contextObj) {
+                OnnxContext::releaseContext(impl.contextId);
+            }
+
+            JsonValue result;
+            if (ok) {
+                result = impl.result;
+            }
+            {
+                // The task may be destroyed as soon as this is released, even by the callback
+                std::lock_guard<std::mutex> lock(impl.asyncMutex);
+                impl.state = ok ? State::Idle
+                                : (impl.runHandle.isTerminated() ? State::Terminated
+                                                                 : State::Failed);
+                impl.asyncPending = false;
+                impl.asyncFinished.notify_all();
+            }
+            if (callback) {
+                callback(result, runError);
+            }
+        };
+        if (!executor->post(std::move(job))) {
+            if (error) {
+                *error = Error(Error::SessionError, "The queue of asynchronous tasks is full");
+            }
+            return false;
+        }
+        impl.asyncPending = true;
+        stateUpdater.setTargetState(State::Running);
+        return true;
     }
 
     bool OnnxTask::stop(Error *error) {
@@ -319,7 +451,7 @@ namespace dsinfer {
         if (!impl.sessionObj) {
             return false;
         }
-        impl.sessionObj->_impl->session.terminate();
+        impl.runHandle.terminate();
         impl.state = State::Terminated;
         return true;
     }
@@ -336,7 +468,7 @@ namespace dsinfer {
 
     JsonValue OnnxTask::result() const {
         __stdc_impl_t;
-        return JsonArray(impl.result);
+        return impl.result;
     }
 
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "acousticinference.h"
 
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
 #include <random>
 
 #include <dsinfer/private/inference_p.h>
@@ -20,6 +24,7 @@
 #include "internal/project.h"
 #include "internal/json_utils.h"
 #include "internal/json_serializer.h"
+#include "internal/project_reader.h"
 
 namespace dsinfer {
 
@@ -35,6 +40,34 @@ namespace dsinfer {
         return uuids::to_string(id1);
     }
 
+    // Decodes segment `index` of a project file, the segments after it are not read
+    static bool readProjectSegment(const std::filesystem::path &path, int64_t index,
+                                   dsinterp::Segment &segment, Error *error) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            if (error) {
+                *error = Error(Error::FileNotFound,
+                               "Failed to open project file " + stdc::path::to_utf8(path));
+            }
+            return false;
+        }
+        dsinterp::ProjectReader reader(file);
+        int64_t i = 0;
+        for (auto &item : reader) {
+            if (i++ == index) {
+                segment = std::move(item);
+                return true;
+            }
+        }
+        if (error) {
+            *error = !reader.error().ok()
+                         ? reader.error()
+                         : Error(Error::InvalidFormat,
+                                 "Project has no segment " + std::to_string(index));
+        }
+        return false;
+    }
+
     class AcousticInference::Impl : public Inference::Impl {
     public:
         class ScopedStateUpdater;
@@ -43,6 +76,12 @@ namespace dsinfer {
         }
 
         bool useCpuHint = false;
+        // Runs of concurrent inferences of the same model are batched by the driver
+        bool batching = false;
+        // Padding of the frame and token axes and warm-up, passed to the session as they are
+        JsonValue buckets;
+        JsonValue warmup;
+        bool useJsonArena = false;
         float depth = 1.0f;
         std::atomic<State> state = State::Terminated;
         int64_t steps = 20;
@@ -50,6 +89,16 @@ namespace dsinfer {
         std::unique_ptr<InferenceSession> session;
         std::unique_ptr<InferenceTask> task;
         JsonValue result;
+
+        // Set while an asynchronous run is pending, the inference waits for it on destruction
+        bool asyncPending = false;
+        std::mutex asyncMutex;
+        std::condition_variable asyncFinished;
+
+        bool checkReady(Error *error) const;
+        bool prepareTask(const JsonValue &input, JsonValue &taskInput, std::vector<float> &f0,
+                         Error *error);
+        bool finishTask(const JsonValue &taskResult, const std::vector<float> &f0, Error *error);
     };
 
     class AcousticInference::Impl::ScopedStateUpdater {
@@ -74,7 +123,16 @@ namespace dsinfer {
     AcousticInference::AcousticInference(const InferenceSpec *spec) : Inference(*new Impl(spec)) {
     }
 
-    AcousticInference::~AcousticInference() = default;
+    AcousticInference::~AcousticInference() {
+        __stdc_impl_t;
+        // A pending asynchronous run still refers to the inference
+        std::unique_lock<std::mutex> lock(impl.asyncMutex);
+        if (impl.asyncPending && impl.task) {
+            Error error;
+            impl.task->stop(&error);
+        }
+        impl.asyncFinished.wait(lock, [&impl] { return !impl.asyncPending; });
+    }
 
     bool AcousticInference::initialize(const JsonValue &args, Error *error) {
         __stdc_impl_t;
@@ -121,6 +179,10 @@ namespace dsinfer {
         }
 
         impl.useCpuHint = args["useCpuHint"].toBool(false);
+        impl.batching = args["batching"].toBool(false);
+        impl.buckets = args["buckets"];
+        impl.warmup = args["warmup"];
+        impl.useJsonArena = args["useJsonArena"].toBool(false);
         impl.steps = args["steps"].toInt64(impl.steps);
         impl.depth = static_cast<float>(args["depth"].toDouble(impl.depth));
 
@@ -137,7 +199,17 @@ namespace dsinfer {
             return false;
         }
         const auto modelPath = spec->path() / stdc::path::from_utf8(model);
-        if (!impl.session->open(modelPath, JsonObject{{"useCpuHint", impl.useCpuHint}}, error)) {
+        JsonObject sessionArgs{
+            {"useCpuHint", impl.useCpuHint},
+            {"batching",   impl.batching  },
+        };
+        if (impl.buckets.isObject()) {
+            sessionArgs["buckets"] = impl.buckets;
+        }
+        if (impl.warmup.isObject()) {
+            sessionArgs["warmup"] = impl.warmup;
+        }
+        if (!impl.session->open(modelPath, sessionArgs, error)) {
             return false;
         }
 
@@ -151,13 +223,7 @@ namespace dsinfer {
         return true;
     }
 
-    bool AcousticInference::start(const JsonValue &input, Error *error) {
-        __stdc_impl_t;
-
-        Impl::ScopedStateUpdater stateUpdater(&impl, State::Failed);
-        impl.state = State::Running;
-
-        const auto spec = impl.spec;
+    bool AcousticInference::Impl::checkReady(Error *error) const {
         if (!spec) {
             if (error) {
                 *error = Error(Error::SessionError, "Inference spec is null");
@@ -165,7 +231,7 @@ namespace dsinfer {
             return false;
         }
 
-        if (!impl.driver) {
+        if (!driver) {
             if (error) {
                 // TODO: error type
                 *error = Error(Error::LibraryNotFound,
@@ -174,33 +240,51 @@ namespace dsinfer {
             return false;
         }
 
-        if (!impl.session) {
+        if (!session) {
             if (error) {
                 *error = Error(Error::SessionError, "Inference session is not created");
             }
             return false;
         }
 
-        if (!impl.session->isOpen()) {
+        if (!session->isOpen()) {
             if (error) {
                 *error = Error(Error::SessionError, "Inference session is not open");
             }
             return false;
         }
 
-        if (!impl.task) {
+        if (!task) {
             if (error) {
                 *error = Error(Error::SessionError, "Inference task is not created");
             }
             return false;
         }
+        return true;
+    }
+
+    bool AcousticInference::Impl::prepareTask(const JsonValue &input, JsonValue &taskInput,
+                                              std::vector<float> &f0, Error *error) {
+        // The nodes built while handling the request die together, take them from one arena
+        std::optional<JsonArena> arena;
+        if (useJsonArena) {
+            arena.emplace();
+        }
 
         const auto config = spec->configuration();
         const auto schema = spec->schema();
 
         // TODO: process input and run inference
+        // Read the input in place, the segment may carry long parameter curves. A segment of a
+        // project file is given as {"project": path, "segment": index} and streamed from it.
+        const JsonValueRef inputRef(input);
         dsinterp::Segment segment;
-        if (!dsinterp::from_json(input, segment, error)) {
+        if (const auto project = inputRef["project"]; project.isString()) {
+            if (!readProjectSegment(stdc::path::from_utf8(project.toString()),
+                                    inputRef["segment"].toInt64(0), segment, error)) {
+                return false;
+            }
+        } else if (!dsinterp::from_json(inputRef, segment, error)) {
             return false;
         }
 
@@ -307,7 +391,7 @@ namespace dsinfer {
         // (`targetLength` depends on `durations` calculation)
         if (const auto it1 = schema.find("varianceControls"); it1 != schema.end()) {
             std::vector<std::string> missingParameters;
-            auto items = it1->second.toArray();
+            auto items = JsonValueRef(it1->second).toArray();
             for (const auto &item: items) {
                 auto paramName = item.toString();
                 if (paramName.empty()) {
@@ -338,7 +422,7 @@ namespace dsinfer {
         if (const auto it1 = schema.find("transitionControls"); it1 != schema.end()) {
             // for transition parameters, missing values are allowed
             // because they can be filled with default values
-            auto items = it1->second.toArray();
+            auto items = JsonValueRef(it1->second).toArray();
             for (const auto &item: items) {
                 auto paramName = item.toString();
                 if (paramName.empty()) {
@@ -395,7 +479,7 @@ namespace dsinfer {
         } // if (useSpeakerEmbedding)
 
         // onnx input value: steps/speedup
-        int64_t stepsOrSpeedup = input["steps"].toInt64(impl.steps);
+        int64_t stepsOrSpeedup = inputRef["steps"].toInt64(steps);
         bool useContAccel = false;
         if (const auto it1 = config.find("useContinuousAcceleration"); it1 != config.end()) {
             useContAccel = it1->second.toBool(false);
@@ -415,61 +499,47 @@ namespace dsinfer {
         }
 
         // If found "depth" in input, use it if valid. Otherwise, use the depth specified in initialization
-        float depth = static_cast<float>(input["depth"].toDouble(impl.depth));
         if (useVariableDepth) {
-            if (useContAccel) {
-                if (const auto it1 = config.find("maxDepth");
-                    it1 != config.end() && (it1->second.isDouble() || it1->second.isInt())) {
-                    depth = (std::min)(static_cast<float>(it1->second.toDouble(depth)), depth);
-                } else {
-                    if (error) {
-                        *error = Error(Error::InvalidFormat, "maxDepth is not set or not a floating point number");
-                    }
-                    return false;
-                }
-                inputParams.push_back(dsinterp::create_tensor_from_scalar<float>("depth", depth));
-            } else {
-                int64_t maxDepth;
-                if (const auto it1 = config.find("maxDepth"); it1 != config.end() && it1->second.isInt()) {
-                    maxDepth = it1->second.toInt64();
-                } else {
-                    if (error) {
-                        *error = Error(Error::InvalidFormat, "maxDepth is not set or not an integer");
-                    }
-                    return false;
-                }
-                inputParams.push_back(
-                    dsinterp::create_tensor_from_scalar<int64_t>(
-                        "depth", dsinterp::getIntDepth(depth, maxDepth, stepsOrSpeedup)));
+            JsonValue depthInput;
+            if (!dsinterp::parseDepth(inputRef, config, depth, useContAccel, stepsOrSpeedup,
+                                      depthInput, error)) {
+                return false;
             }
+            inputParams.push_back(std::move(depthInput));
         }
 
         // onnx input value: f0
         // (`targetLength` depends on `durations` calculation)
-        auto f0 = dsinterp::parseF0AsVector(segment, frameLength, targetLength);
+        f0 = dsinterp::parseF0AsVector(segment, frameLength, targetLength);
         inputParams.push_back(dsinterp::parseF0(f0));
 
         // TODO: store the mel-freq tensor with UUID
         auto uuid = generate_uuid();
         acoustic_log().info("UUID: %1", uuid);
 
-        bool ok = impl.task->start(JsonObject{
-                             {"session", impl.session->id()},
-                             {"context", segment.context},
-                             {"input", std::move(inputParams)},
-                             {
-                                 "output", JsonArray{
-                                     JsonObject{
-                                         {"name", "mel"}, {"format", "reference"}
-                                     }
-                                 }
-                             },
-                         }, error);
-        if (!ok) {
-            return false;
+        // Tensors are moved into the task input instead of being copied
+        JsonBuilder outputParams(JsonValue::Array);
+        outputParams.append(JsonObject{
+            {"name", "mel"}, {"format", "reference"}
+        });
+        JsonBuilder taskInputBuilder;
+        taskInputBuilder.insert("session", session->id())
+            .insert("context", segment.context)
+            .insert("input", std::move(inputParams))
+            .insert("output", outputParams.build());
+        taskInput = taskInputBuilder.build();
+
+        if (arena) {
+            auto stats = arena->statistics();
+            acoustic_log().debug("JSON arena: %1 allocations, %2 bytes in %3 blocks",
+                                 stats.allocations, stats.bytes, stats.blocks);
         }
-        auto result = impl.task->result();
-        auto mel = result[0]["data"]["value"].toString();
+        return true;
+    }
+
+    bool AcousticInference::Impl::finishTask(const JsonValue &taskResult,
+                                             const std::vector<float> &f0, Error *error) {
+        auto mel = taskResult[0]["data"]["value"].toString();
         if (mel.empty()) {
             if (error) {
                 *error = Error(Error::SessionError, "Inference failed: could not get mel");
@@ -477,11 +547,36 @@ namespace dsinfer {
             return false;
         }
 
-        uint8_t *f0_bytes = reinterpret_cast<uint8_t *>(f0.data());
-        impl.result = JsonObject{
-            {"mel", std::move(mel)},
-            {"f0", std::vector<uint8_t>(f0_bytes, f0_bytes + f0.size() * sizeof(float))},
-        };
+        auto f0_bytes = reinterpret_cast<const uint8_t *>(f0.data());
+        JsonBuilder inferenceResult;
+        inferenceResult.insert("mel", mel)
+            .insert("f0", std::vector<uint8_t>(f0_bytes, f0_bytes + f0.size() * sizeof(float)));
+        result = inferenceResult.build();
+        return true;
+    }
+
+    bool AcousticInference::start(const JsonValue &input, Error *error) {
+        __stdc_impl_t;
+
+        Impl::ScopedStateUpdater stateUpdater(&impl, State::Failed);
+        impl.state = State::Running;
+
+        if (!impl.checkReady(error)) {
+            return false;
+        }
+
+        JsonValue taskInput;
+        std::vector<float> f0;
+        if (!impl.prepareTask(input, taskInput, f0, error)) {
+            return false;
+        }
+
+        if (!impl.task->start(taskInput, error)) {
+            return false;
+        }
+        if (!impl.finishTask(impl.task->result(), f0, error)) {
+            return false;
+        }
 
         stateUpdater.setTargetState(State::Idle);
         return true;
@@ -490,7 +585,57 @@ namespace dsinfer {
     bool AcousticInference::startAsync(const JsonValue &input,
                                        const std::function<void(const JsonValue &, const Error &)> &callback,
                                        Error *error) {
-        return false;
+        __stdc_impl_t;
+        std::unique_lock<std::mutex> lock(impl.asyncMutex);
+        if (impl.asyncPending || impl.state == State::Running) {
+            if (error) {
+                *error = Error(Error::SessionError, "Inference is already running");
+            }
+            return false;
+        }
+
+        // Preprocessing runs on the calling thread, only the model runs on the driver workers
+        Impl::ScopedStateUpdater stateUpdater(&impl, State::Failed);
+        impl.state = State::Running;
+
+        if (!impl.checkReady(error)) {
+            return false;
+        }
+
+        JsonValue taskInput;
+        std::vector<float> f0;
+        if (!impl.prepareTask(input, taskInput, f0, error)) {
+            return false;
+        }
+
+        auto taskCallback = [&impl, f0 = std::move(f0), callback](const JsonValue &taskResult,
+                                                                  const Error &taskError) {
+            Error error = taskError;
+            bool ok = error.ok() && impl.finishTask(taskResult, f0, &error);
+            JsonValue result;
+            if (ok) {
+                result = impl.result;
+            }
+            {
+                // The inference may be destroyed as soon as this is released
+                std::lock_guard<std::mutex> lock(impl.asyncMutex);
+                impl.state = ok ? State::Idle
+                                : (impl.task->state() == InferenceTask::Terminated
+                                       ? State::Terminated
+                                       : State::Failed);
+                impl.asyncPending = false;
+                impl.asyncFinished.notify_all();
+            }
+            if (callback) {
+                callback(result, error);
+            }
+        };
+        if (!impl.task->startAsync(taskInput, taskCallback, error)) {
+            return false;
+        }
+        impl.asyncPending = true;
+        stateUpdater.setTargetState(State::Running);
+        return true;
     }
 
     bool AcousticInference::stop() {
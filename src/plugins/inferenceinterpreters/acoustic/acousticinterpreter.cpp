@@ -2,6 +2,7 @@
 
 #include "acousticinference.h"
 
+#include <stdcorelib/path.h>
 #include <stdcorelib/strings.h>
 
 namespace dsinfer {
@@ -23,6 +24,16 @@ namespace dsinfer {
         return true;
     }
 
+    std::vector<std::filesystem::path>
+        AcousticInterpreter::models(const InferenceSpec *spec) const {
+        auto config = spec->configuration();
+        auto it = config.find("model");
+        if (it == config.end() || !it->second.isString()) {
+            return {};
+        }
+        return {spec->path() / stdc::path::from_utf8(it->second.toString())};
+    }
+
     Inference *AcousticInterpreter::create(const InferenceSpec *spec, const JsonValue &options,
                                            Error *error) {
         switch (spec->apiLevel()) {
@@ -16,6 +16,8 @@ namespace dsinfer {
         bool validate(const InferenceSpec *spec, const JsonValue &importOptions,
                       std::string *message) const override;
 
+        std::vector<std::filesystem::path> models(const InferenceSpec *spec) const override;
+
         virtual Inference *create(const InferenceSpec *spec, const JsonValue &options,
                                   Error *error) override;
     };
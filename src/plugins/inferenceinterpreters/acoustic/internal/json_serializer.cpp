@@ -1,10 +1,13 @@
 #include "json_serializer.h"
+
+#include <cstring>
+
 #include "json_utils.h"
 #include "project.h"
 
 namespace dsinfer::dsinterp {
 
-    bool from_json(const JsonValue &json, Phoneme &phoneme, Error *error) {
+    bool from_json(const JsonValueRef &json, Phoneme &phoneme, Error *error) {
         if (!json.isObject()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of Phoneme: json value is not object");
@@ -30,7 +33,7 @@ namespace dsinfer::dsinterp {
         };
     }
 
-    bool from_json(const JsonValue &json, Note &note, Error *error) {
+    bool from_json(const JsonValueRef &json, Note &note, Error *error) {
         if (!json.isObject()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of Note: json value is not object");
@@ -69,7 +72,7 @@ namespace dsinfer::dsinterp {
         };
     }
 
-    bool from_json(const JsonValue &json, Word &word, Error *error) {
+    bool from_json(const JsonValueRef &json, Word &word, Error *error) {
         if (!json.isObject()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of Word: json value is not object");
@@ -131,7 +134,7 @@ namespace dsinfer::dsinterp {
         };
     }
 
-    bool from_json(const JsonValue &json, Parameter &parameter, Error *error) {
+    bool from_json(const JsonValueRef &json, Parameter &parameter, Error *error) {
         if (!json.isObject()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of Parameter: json value is not object");
@@ -153,12 +156,10 @@ namespace dsinfer::dsinterp {
                 }
                 return false;
             }
-            auto values = j_values.toArray();
-            parameter.sample_curve.samples.reserve(values.size());
-            for (const auto &value: values) {
-                // May need to validate type of each value
-                parameter.sample_curve.samples.emplace_back(value.toDouble());
-            }
+            // May need to validate type of each value
+            auto values = j_values.toTypedArray(JsonTypedArray::Float64);
+            parameter.sample_curve.samples.resize(values.size());
+            std::memcpy(parameter.sample_curve.samples.data(), values.data(), values.binary().size());
         } else {
             parameter.sample_curve.samples.resize(1);
             if (!get_input<double>("Parameter", json, "value", error, parameter.sample_curve.samples[0])) {
@@ -192,7 +193,7 @@ namespace dsinfer::dsinterp {
             {"tag", parameter.tag},
             {"interval", parameter.sample_curve.timestep},
             {"dynamic", true},
-            {"values", to_json_array(parameter.sample_curve.samples)},
+            {"values", JsonTypedArray(parameter.sample_curve.samples.data(), parameter.sample_curve.samples.size())},
             {"retake", JsonObject{
                     {"start", static_cast<int64_t>(parameter.retake_start)},
                     {"end", static_cast<int64_t>(parameter.retake_end)}
@@ -200,7 +201,7 @@ namespace dsinfer::dsinterp {
         };
     }
 
-    bool from_json(const JsonValue &json, SpeakerMixCurve &spk, Error *error) {
+    bool from_json(const JsonValueRef &json, SpeakerMixCurve &spk, Error *error) {
         if (!json.isArray()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of SpeakerMixCurve: json value is not array");
@@ -225,12 +226,10 @@ namespace dsinfer::dsinterp {
                     }
                     return false;
                 }
-                auto values = j_values.toArray();
-                sc.samples.reserve(values.size());
-                for (const auto &value: values) {
-                    // May need to validate type of each value
-                    sc.samples.emplace_back(value.toDouble());
-                }
+                // May need to validate type of each value
+                auto values = j_values.toTypedArray(JsonTypedArray::Float64);
+                sc.samples.resize(values.size());
+                std::memcpy(sc.samples.data(), values.data(), values.binary().size());
                 if (!get_input<double>("SpeakerMixCurve", item, "interval", error, sc.timestep)) {
                     return false;
                 }
@@ -265,14 +264,14 @@ namespace dsinfer::dsinterp {
                     {"name", name},
                     {"dynamic", true},
                     {"interval", sc.timestep},
-                    {"values", to_json_array(sc.samples)},
+                    {"values", JsonTypedArray(sc.samples.data(), sc.samples.size())},
                 });
             }
         }
         return j;
     }
 
-    bool from_json(const JsonValue &json, Segment &segment, Error *error) {
+    bool from_json(const JsonValueRef &json, Segment &segment, Error *error) {
         if (!json.isObject()) {
             if (error) {
                 *error = Error(Error::InvalidFormat, "Invalid format of Segment: json value is not object");
@@ -46,7 +46,7 @@ namespace dsinfer {
         }
 
         template <typename T>
-        inline bool is_json_type(const JsonValue &value) {
+        inline bool is_json_type(const JsonValueRef &value) {
             if constexpr (std::is_same_v<T, std::string>) {
                 return value.isString();
             }  else if constexpr (std::is_same_v<T, bool>) {
@@ -65,7 +65,7 @@ namespace dsinfer {
         }
 
         template <typename T>
-        inline T to_json_type(const JsonValue &value) {
+        inline T to_json_type(const JsonValueRef &value) {
             if constexpr (std::is_same_v<T, std::string>) {
                 return value.toString();
             } else if constexpr (std::is_same_v<T, bool>) {
@@ -84,9 +84,9 @@ namespace dsinfer {
     } // namespace detail
 
     template<typename T>
-    inline bool get_input(const std::string &className, const JsonValue &json, const std::string &key, Error *error,
+    inline bool get_input(const std::string &className, const JsonValueRef &json, const std::string &key, Error *error,
                      T &outValue) {
-        const JsonValue val = json[key];
+        const JsonValueRef val = json[key];
         if (val.isUndefined()) {
             if (error) {
                 *error = Error(Error::InvalidFormat,
@@ -74,7 +74,7 @@ namespace dsinfer::dsinterp {
             }
         }
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(tokens.size())};
-        return create_tensor<int64_t>("tokens", tokens.data(), tokens.size(), shape.data(), shape.size());
+        return create_tensor<int64_t>("tokens", std::move(tokens), shape.data(), shape.size());
     }
 
 
@@ -93,7 +93,7 @@ namespace dsinfer::dsinterp {
             }
         }
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(lang.size())};
-        return create_tensor<int64_t>("languages", lang.data(), lang.size(), shape.data(), shape.size());
+        return create_tensor<int64_t>("languages", std::move(lang), shape.data(), shape.size());
     }
 
     JsonValue parsePhonemeDurations(const Segment &dsSegment, double frameLength, int64_t &outTargetLength) {
@@ -133,7 +133,7 @@ namespace dsinfer::dsinterp {
 
         outTargetLength = std::accumulate(durations.begin(), durations.end(), int64_t{0});
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(durations.size())};
-        return create_tensor<int64_t>("durations", durations.data(), durations.size(), shape.data(), shape.size());
+        return create_tensor<int64_t>("durations", std::move(durations), shape.data(), shape.size());
     }
 
     std::vector<float> parseF0AsVector(const Segment &dsSegment, double frameLength, int64_t targetLength, double a4freq) {
@@ -162,7 +162,7 @@ namespace dsinfer::dsinterp {
         std::vector<float> f0 = parseF0AsVector(dsSegment, frameLength, targetLength, a4freq);
 
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(f0.size())};
-        return create_tensor<float>("f0", f0.data(), f0.size(), shape.data(), shape.size());
+        return create_tensor<float>("f0", std::move(f0), shape.data(), shape.size());
     }
 
     JsonValue parseF0(const std::vector<float> &f0) {
@@ -183,10 +183,9 @@ namespace dsinfer::dsinterp {
         }
 
         auto samples = param.sample_curve.resample(frameLength, targetLength);
-        const std::vector<float> samplesFloat(samples.begin(), samples.end());
+        std::vector<float> samplesFloat(samples.begin(), samples.end());
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(samples.size())};
-        return create_tensor<float>(modelParameter, samplesFloat.data(), samplesFloat.size(),
-                                    shape.data(), shape.size());
+        return create_tensor<float>(modelParameter, std::move(samplesFloat), shape.data(), shape.size());
     }
 
     JsonValue parseTransitionParameter(const Segment &dsSegment, const char *parameter, const char *modelParameter,
@@ -196,9 +195,9 @@ namespace dsinfer::dsinterp {
         const auto it = dsSegment.parameters.find(parameter);
         if (it == dsSegment.parameters.end()) {
             // missing parameter, using constant default value
-            const std::vector<float> data(targetLength, defaultValue);
+            std::vector<float> data(targetLength, defaultValue);
             const std::array<int64_t, 2> shape{1, static_cast<int64_t>(data.size())};
-            return create_tensor<float>(modelParameter, data.data(), data.size(), shape.data(), shape.size());
+            return create_tensor<float>(modelParameter, std::move(data), shape.data(), shape.size());
         }
 
         const auto &param = it->second;
@@ -207,17 +206,43 @@ namespace dsinfer::dsinterp {
         }
 
         auto samples = param.sample_curve.resample(frameLength, targetLength);
-        const std::vector<float> samplesFloat(samples.begin(), samples.end());
+        std::vector<float> samplesFloat(samples.begin(), samples.end());
         const std::array<int64_t, 2> shape{1, static_cast<int64_t>(samples.size())};
-        return create_tensor<float>(modelParameter, samplesFloat.data(), samplesFloat.size(),
-                                    shape.data(), shape.size());
+        return create_tensor<float>(modelParameter, std::move(samplesFloat), shape.data(), shape.size());
     }
 
     JsonValue parseSpeakerMix(const SpeakerEmbed &spkEmb, const std::vector<std::string> &speakers,
                               const SpeakerMixCurve &spkMix, double frameLength, int64_t targetLength) {
-        const auto data = getSpkMix(spkEmb, speakers, spkMix, frameLength, targetLength);
+        auto data = getSpkMix(spkEmb, speakers, spkMix, frameLength, targetLength);
         std::array<int64_t, 3> shape = {int64_t{1}, targetLength, static_cast<int64_t>(SPK_EMBED_SIZE)};
-        return create_tensor("spk_embed", data.data(), data.size(), shape.data(), shape.size());
+        return create_tensor("spk_embed", std::move(data), shape.data(), shape.size());
+    }
+
+    bool parseDepth(const JsonValueRef &input, const JsonObject &config, float defaultDepth,
+                    bool useContinuousAcceleration, int64_t stepsOrSpeedup, JsonValue &out,
+                    Error *error) {
+        auto depth = static_cast<float>(input["depth"].toDouble(defaultDepth));
+        const auto it = config.find("maxDepth");
+        if (useContinuousAcceleration) {
+            if (it == config.end() || !(it->second.isDouble() || it->second.isInt())) {
+                if (error) {
+                    *error = Error(Error::InvalidFormat, "maxDepth is not set or not a floating point number");
+                }
+                return false;
+            }
+            depth = (std::min)(static_cast<float>(it->second.toDouble(depth)), depth);
+            out = create_tensor_from_scalar<float>("depth", depth);
+            return true;
+        }
+        if (it == config.end() || !it->second.isInt()) {
+            if (error) {
+                *error = Error(Error::InvalidFormat, "maxDepth is not set or not an integer");
+            }
+            return false;
+        }
+        out = create_tensor_from_scalar<int64_t>(
+            "depth", getIntDepth(depth, it->second.toInt64(), stepsOrSpeedup));
+        return true;
     }
 
     bool readObjectHelper(const JsonObject &object, const std::string &type, std::unordered_map<std::string, int64_t> &out, Error *error) {
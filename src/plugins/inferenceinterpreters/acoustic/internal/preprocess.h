@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
@@ -42,43 +43,65 @@ namespace dsinfer::dsinterp {
     JsonValue parseSpeakerMix(const SpeakerEmbed &spkEmb, const std::vector<std::string> &speakers,
                               const SpeakerMixCurve &spkMix, double frameLength, int64_t targetLength);
 
+    // Builds the "depth" input of a model with variable depth. The "depth" of the task input
+    // overrides `defaultDepth`, and "maxDepth" of the config limits it
+    bool parseDepth(const JsonValueRef &input, const JsonObject &config, float defaultDepth,
+                    bool useContinuousAcceleration, int64_t stepsOrSpeedup, JsonValue &out,
+                    Error *error);
+
     bool readObjectHelper(const JsonObject &object, const std::string &type, std::unordered_map<std::string, int64_t> &out, Error *error);
 
     bool readJsonFileHelper(const std::filesystem::path &path, const std::string &type, std::unordered_map<std::string, int64_t> &out, Error *error);
 
     template <typename T>
-    inline JsonValue create_tensor(const char *name,
-                                   const T *data_buffer, size_t data_size,
-                                   const int64_t *shape_buffer, size_t shape_size) {
-        const uint8_t *bytes_buffer = reinterpret_cast<const uint8_t *>(data_buffer);
-        size_t bytes_size = data_size * sizeof(T);
-        const char *type;
+    inline const char *tensor_type_name() {
         if constexpr (std::is_same_v<T, float>) {
-            type = "float";
+            return "float";
         } else if constexpr (std::is_same_v<T, int64_t>) {
-            type = "int64";
+            return "int64";
         } else if constexpr (std::is_same_v<T, bool>) {
-            type = "bool";
+            return "bool";
         } else {
             static_assert(!std::is_same_v<T, T>, "Unexpected type in create_tensor.");
         }
+    }
 
-        JsonArray shape;
+    inline JsonValue create_tensor_from_binary(const char *name, const char *type, const JsonBinary &data,
+                                               const int64_t *shape_buffer, size_t shape_size) {
+        JsonBuilder shape(JsonValue::Array);
         shape.reserve(shape_size);
         for (size_t i = 0; i < shape_size; ++i) {
-            shape.emplace_back(shape_buffer[i]);
+            shape.append(shape_buffer[i]);
         }
-        return JsonObject{
-                {"name", name},
-                {"format", "bytes"},
-                {
-                    "data", JsonObject{
-                        {"type", type},
-                        {"shape", shape},
-                        {"value", std::vector<uint8_t>(bytes_buffer, bytes_buffer + bytes_size)},
-                    }
-                }
-        };
+        JsonBuilder tensorData;
+        tensorData.insert("type", type)
+            .insert("shape", shape.build())
+            .insert("value", data);
+        JsonBuilder tensor;
+        tensor.insert("name", name)
+            .insert("format", "bytes")
+            .insert("data", tensorData.build());
+        return tensor.build();
+    }
+
+    template <typename T>
+    inline JsonValue create_tensor(const char *name,
+                                   const T *data_buffer, size_t data_size,
+                                   const int64_t *shape_buffer, size_t shape_size) {
+        const uint8_t *bytes_buffer = reinterpret_cast<const uint8_t *>(data_buffer);
+        size_t bytes_size = data_size * sizeof(T);
+        return create_tensor_from_binary(name, tensor_type_name<T>(), JsonBinary(bytes_buffer, bytes_size),
+                                         shape_buffer, shape_size);
+    }
+
+    // Takes over the storage of `data` instead of copying it
+    template <typename T>
+    inline JsonValue create_tensor(const char *name, std::vector<T> &&data,
+                                   const int64_t *shape_buffer, size_t shape_size) {
+        static_assert(!std::is_same_v<T, bool>, "std::vector<bool> has no contiguous storage.");
+        auto buffer = std::make_shared<std::vector<T>>(std::move(data));
+        JsonBinary binary(buffer, reinterpret_cast<const uint8_t *>(buffer->data()), buffer->size() * sizeof(T));
+        return create_tensor_from_binary(name, tensor_type_name<T>(), binary, shape_buffer, shape_size);
     }
 
     template <typename T>
@@ -0,0 +1,27 @@
+#include "project_reader.h"
+
+#include <string>
+
+#include "json_serializer.h"
+
+namespace dsinfer::dsinterp {
+    ProjectReader::ProjectReader(std::istream &stream) : m_reader(stream, "segments") {
+    }
+
+    bool ProjectReader::readNext(Segment &segment, Error *error) {
+        JsonValue json;
+        if (!m_reader.readNext(json, error)) {
+            return false;
+        }
+        segment = Segment();
+        Error tmpError;
+        if (!from_json(JsonValueRef(json), segment, &tmpError)) {
+            if (error) {
+                *error = Error(tmpError.type(), tmpError.message() + " [segment " +
+                                                    std::to_string(m_reader.index() - 1) + "]");
+            }
+            return false;
+        }
+        return true;
+    }
+}
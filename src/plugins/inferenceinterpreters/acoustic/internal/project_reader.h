@@ -0,0 +1,88 @@
+#ifndef PROJECT_READER_H
+#define PROJECT_READER_H
+
+#include <cstddef>
+#include <istream>
+#include <iterator>
+
+#include <dsinfer/error.h>
+#include <dsinfer/jsonstreamreader.h>
+
+#include "project.h"
+
+namespace dsinfer::dsinterp {
+    /**
+     * @brief Decodes the segments of a project from a stream one at a time.
+     *
+     * A project is either an array of segments or an object holding that array under
+     * "segments". Each segment is decoded when it is reached, so the first segment can be
+     * rendered while the rest of the stream is still unread, and only one segment is held in
+     * memory at a time.
+     */
+    class ProjectReader {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Segment;
+            using difference_type = std::ptrdiff_t;
+            using pointer = Segment *;
+            using reference = Segment &;
+
+            iterator() = default;
+
+            // The segment may be moved out, the next increment replaces it
+            inline reference operator*() {
+                return m_segment;
+            }
+            inline pointer operator->() {
+                return &m_segment;
+            }
+            inline iterator &operator++() {
+                if (!m_reader->readNext(m_segment, &m_reader->m_error)) {
+                    m_reader = nullptr;
+                }
+                return *this;
+            }
+            inline bool operator==(const iterator &other) const {
+                return m_reader == other.m_reader;
+            }
+            inline bool operator!=(const iterator &other) const {
+                return m_reader != other.m_reader;
+            }
+
+        private:
+            inline explicit iterator(ProjectReader *reader) : m_reader(reader) {
+                ++*this;
+            }
+
+            ProjectReader *m_reader = nullptr;
+            Segment m_segment;
+
+            friend class ProjectReader;
+        };
+
+        explicit ProjectReader(std::istream &stream);
+
+        // Returns false at the end of the project or on error
+        bool readNext(Segment &segment, Error *error = nullptr);
+
+        // Iteration stops at the first invalid segment, check error() afterwards
+        inline iterator begin() {
+            return iterator(this);
+        }
+        inline iterator end() {
+            return {};
+        }
+
+        inline const Error &error() const {
+            return m_error;
+        }
+
+    private:
+        JsonStreamReader m_reader;
+        Error m_error;
+    };
+}
+
+#endif // PROJECT_READER_H
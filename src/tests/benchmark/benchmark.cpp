@@ -0,0 +1,109 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <dsinfer/jsonvalue.h>
+
+namespace DS = dsinfer;
+
+size_t allocationCount = 0;
+
+void *operator new(size_t size) {
+    allocationCount++;
+    if (auto p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static double throughput(const BenchmarkResult &result) {
+    return result.bytes > 0 && result.meanUs > 0 ? double(result.bytes) / result.meanUs : 0;
+}
+
+static std::string formatText(const std::vector<BenchmarkResult> &results) {
+    std::string out;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-24s %-24s %12s %12s %12s %9s %12s %12s %14s\n", "name",
+                  "shape", "bytes", "mean us", "min us", "MB/s", "allocations", "nodes copied",
+                  "bytes copied");
+    out += line;
+    for (const auto &result : results) {
+        std::snprintf(line, sizeof(line),
+                      "%-24s %-24s %12zu %12.1f %12.1f %9.1f %12zu %12zu %14zu\n",
+                      result.name.c_str(), result.shape.c_str(), result.bytes, result.meanUs,
+                      result.minUs, throughput(result), result.allocations, result.copies.nodes,
+                      result.copies.bytes);
+        out += line;
+    }
+    return out;
+}
+
+static std::string formatCsv(const std::vector<BenchmarkResult> &results) {
+    std::string out = "name,shape,bytes,iterations,mean_us,min_us,mb_per_s,allocations,"
+                      "nodes_copied,bytes_copied\n";
+    char line[256];
+    for (const auto &result : results) {
+        std::snprintf(line, sizeof(line), "%s,%s,%zu,%d,%.3f,%.3f,%.3f,%zu,%zu,%zu\n",
+                      result.name.c_str(), result.shape.c_str(), result.bytes, result.iterations,
+                      result.meanUs, result.minUs, throughput(result), result.allocations,
+                      result.copies.nodes, result.copies.bytes);
+        out += line;
+    }
+    return out;
+}
+
+static std::string formatJson(const std::vector<BenchmarkResult> &results,
+                              const std::vector<std::pair<std::string, std::string>> &properties) {
+    DS::JsonBuilder items(DS::JsonValue::Array);
+    items.reserve(results.size());
+    for (const auto &result : results) {
+        DS::JsonBuilder item;
+        item.insert("name", result.name)
+            .insert("shape", result.shape)
+            .insert("bytes", int64_t(result.bytes))
+            .insert("iterations", result.iterations)
+            .insert("meanUs", result.meanUs)
+            .insert("minUs", result.minUs)
+            .insert("mbPerSecond", throughput(result))
+            .insert("allocations", int64_t(result.allocations))
+            .insert("nodesCopied", int64_t(result.copies.nodes))
+            .insert("bytesCopied", int64_t(result.copies.bytes));
+        items.append(item.build());
+    }
+    DS::JsonBuilder root;
+    for (const auto &property : properties) {
+        root.insert(property.first, property.second);
+    }
+    root.insert("results", items.build());
+    return root.build().toJson(4) + "\n";
+}
+
+std::string BenchmarkSuite::format(
+    Format format, const std::vector<std::pair<std::string, std::string>> &properties) const {
+    switch (format) {
+        case Csv:
+            return formatCsv(m_results);
+        case Json:
+            return formatJson(m_results, properties);
+        default:
+            break;
+    }
+    std::string out;
+    for (const auto &property : properties) {
+        out += property.first + ": " + property.second + "\n";
+    }
+    if (!out.empty()) {
+        out += "\n";
+    }
+    return out + formatText(m_results);
+}
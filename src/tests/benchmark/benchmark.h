@@ -0,0 +1,90 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Heap allocations of the whole process, counted by the replaced operator new
+extern size_t allocationCount;
+
+struct CopyStats {
+    size_t nodes = 0;
+    size_t bytes = 0;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::string shape;
+    size_t bytes = 0; // size of the payload processed by one iteration
+    int iterations = 0;
+    double meanUs = 0;
+    double minUs = 0;
+    size_t allocations = 0; // per iteration
+    CopyStats copies;       // per iteration
+    size_t checksum = 0;
+};
+
+class BenchmarkSuite {
+public:
+    enum Format {
+        Text,
+        Csv,
+        Json,
+    };
+
+    explicit BenchmarkSuite(int iterations) : m_iterations(iterations) {
+    }
+
+    // `func(CopyStats &)` runs one iteration and returns a checksum that keeps it from being
+    // optimized away, the first call is a warm-up and is not measured
+    template <class F>
+    void run(const std::string &name, const std::string &shape, size_t bytes, F func) {
+        namespace cho = std::chrono;
+
+        BenchmarkResult result;
+        result.name = name;
+        result.shape = shape;
+        result.bytes = bytes;
+        result.iterations = m_iterations;
+
+        CopyStats stats;
+        result.checksum += func(stats);
+
+        double totalUs = 0;
+        result.minUs = -1;
+        for (int i = 0; i < m_iterations; ++i) {
+            stats = {};
+            auto allocations = allocationCount;
+            auto start_time = cho::steady_clock::now();
+            result.checksum += func(stats);
+            auto end_time = cho::steady_clock::now();
+            result.allocations = allocationCount - allocations;
+            auto us = cho::duration<double, std::micro>(end_time - start_time).count();
+            totalUs += us;
+            result.minUs = result.minUs < 0 ? us : std::min(result.minUs, us);
+        }
+        result.meanUs = m_iterations > 0 ? totalUs / m_iterations : 0;
+        result.copies = stats;
+        m_results.push_back(std::move(result));
+    }
+
+    inline const std::vector<BenchmarkResult> &results() const {
+        return m_results;
+    }
+
+    // `properties` describe the run, like the build configuration, they head the text and JSON
+    // reports
+    std::string format(Format format,
+                       const std::vector<std::pair<std::string, std::string>> &properties = {})
+        const;
+
+protected:
+    int m_iterations;
+    std::vector<BenchmarkResult> m_results;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,74 @@
+#include "acoustictest.h"
+
+#include <cstring>
+#include <string>
+
+#include "preprocess.h"
+
+#define ENSURE(cond)                                                                               \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            logger.critical("%1:%2: check failed: %3", __FILE__, __LINE__, #cond);                 \
+            return false;                                                                          \
+        }                                                                                          \
+    } while (false)
+
+namespace DS = dsinfer;
+
+// The scalar of a tensor built by the preprocessing
+template <class T>
+static bool tensorScalar(const DS::JsonValue &tensor, const char *type, T &value) {
+    const DS::JsonValueRef data = DS::JsonValueRef(tensor)["data"];
+    auto bytes = data["value"].toBinary();
+    if (data["type"].toString() != type || bytes.size() != sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, bytes.data(), sizeof(T));
+    return true;
+}
+
+AcousticTest::AcousticTest(DS::Log::Category &logger) : logger(logger) {
+}
+
+bool AcousticTest::testDepth() {
+    const DS::JsonValue noDepth = DS::JsonObject{{"offset", 0.0}};
+    const DS::JsonValue halfDepth = DS::JsonObject{{"depth", 0.5}};
+    const DS::JsonValue tooDeep = DS::JsonObject{{"depth", 2.0}};
+    DS::JsonValue out;
+    DS::Error error;
+
+    // Continuous acceleration takes the depth as is, up to "maxDepth"
+    const DS::JsonObject floatConfig{{"maxDepth", 1.0}};
+    float depth = 0;
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(noDepth), floatConfig, 0.6f, true, 10, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "float", depth) && depth == 0.6f);
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(halfDepth), floatConfig, 0.6f, true, 10, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "float", depth) && depth == 0.5f);
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(tooDeep), floatConfig, 0.6f, true, 10, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "float", depth) && depth == 1.0f);
+
+    // Otherwise it is counted in steps of 1/1000 and rounded down to a multiple of the speedup
+    const DS::JsonObject intConfig{{"maxDepth", int64_t(1000)}};
+    int64_t intDepth = 0;
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(noDepth), intConfig, 1.0f, false, 10, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "int64", intDepth) && intDepth == 1000);
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(noDepth), intConfig, 0.456f, false, 20, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "int64", intDepth) && intDepth == 440);
+    ENSURE(DS::dsinterp::parseDepth(DS::JsonValueRef(tooDeep), intConfig, 0.5f, false, 10, out,
+                                    &error));
+    ENSURE(tensorScalar(out, "int64", intDepth) && intDepth == 1000);
+
+    // "maxDepth" must match the acceleration
+    ENSURE(!DS::dsinterp::parseDepth(DS::JsonValueRef(noDepth), {}, 1.0f, true, 10, out, &error));
+    ENSURE(error.type() == DS::Error::InvalidFormat);
+    error = {};
+    ENSURE(!DS::dsinterp::parseDepth(DS::JsonValueRef(noDepth), floatConfig, 1.0f, false, 10,
+                                     out, &error));
+    ENSURE(error.type() == DS::Error::InvalidFormat);
+    return true;
+}
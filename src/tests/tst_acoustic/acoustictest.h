@@ -0,0 +1,14 @@
+#ifndef TST_ACOUSTIC_ACOUSTICTEST_H
+#define TST_ACOUSTIC_ACOUSTICTEST_H
+
+#include <dsinfer/log.h>
+
+class AcousticTest {
+public:
+    explicit AcousticTest(dsinfer::Log::Category &logger);
+    bool testDepth();
+protected:
+    dsinfer::Log::Category &logger;
+};
+
+#endif // TST_ACOUSTIC_ACOUSTICTEST_H
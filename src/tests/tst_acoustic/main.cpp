@@ -0,0 +1,23 @@
+#include <cstdlib>
+
+#include <dsinfer/log.h>
+
+#include "acoustictest.h"
+
+namespace DS = dsinfer;
+
+int main(int argc, char *argv[]) {
+    DS::Log::Category logger("acoustictest");
+
+    bool ok = true;
+    AcousticTest test(logger);
+
+    ok = test.testDepth();
+    if (!ok) {
+        logger.critical("testDepth - test failed");
+        return EXIT_FAILURE;
+    }
+
+    logger.info("All tests completed");
+    return EXIT_SUCCESS;
+}
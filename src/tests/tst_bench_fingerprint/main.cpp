@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "mappedfile.h"
+
+#ifndef TST_BENCH_FINGERPRINT_MODELS
+#  define TST_BENCH_FINGERPRINT_MODELS "."
+#endif
+
+namespace fs = std::filesystem;
+
+namespace OD = dsinfer::onnxdriver;
+
+static const OD::FingerprintAlgorithm algorithms[] = {
+    OD::FA_SHA256,
+    OD::FA_XXH3Tree,
+};
+
+// The fixtures used by tst_onnxdriver to test session deduplication
+static bool checkFixtures(FILE *out) {
+    fs::path dir(TST_BENCH_FINGERPRINT_MODELS);
+    bool ok = true;
+    for (const auto &algorithm : algorithms) {
+        std::vector<uint8_t> digests[3];
+        int64_t sizes[3] = {};
+        const char *names[3] = {
+            "vector_add.onnx",
+            "vector_add-duplicate.onnx",
+            "vector_add-same_filesize.onnx",
+        };
+        for (int i = 0; i < 3; ++i) {
+            std::string errorMessage;
+            if (!OD::fingerprintFile(dir / names[i], algorithm, digests[i], sizes[i],
+                                     &errorMessage)) {
+                std::fprintf(stderr, "%s: %s\n", names[i], errorMessage.c_str());
+                return false;
+            }
+        }
+        bool duplicate = sizes[0] == sizes[1] && digests[0] == digests[1];
+        bool distinct = sizes[0] == sizes[2] && digests[0] != digests[2];
+        std::fprintf(out, "%-16s duplicate: %s, same size: %s\n",
+                     OD::fingerprintAlgorithmName(algorithm), duplicate ? "equal" : "DIFFERENT",
+                     distinct ? "different" : "EQUAL");
+        ok = ok && duplicate && distinct;
+    }
+    return ok;
+}
+
+// The digest is folded into the checksum, so that the hashing is not optimized away
+static size_t checksum(const std::vector<uint8_t> &digest) {
+    size_t sum = 0;
+    for (auto byte : digest) {
+        sum = sum * 31 + byte;
+    }
+    return sum;
+}
+
+static void runAll(BenchmarkSuite &suite, const std::string &label, const uint8_t *data,
+                   size_t size) {
+    int cores = int(std::max(1u, std::thread::hardware_concurrency()));
+    suite.run("sha256", label, size,
+              [&](CopyStats &) { return checksum(OD::fingerprint(data, size, OD::FA_SHA256)); });
+    suite.run("xxh3 (1 thread)", label, size, [&](CopyStats &) {
+        return checksum(OD::fingerprint(data, size, OD::FA_XXH3Tree, 1));
+    });
+    if (cores > 1) {
+        suite.run("xxh3 (" + std::to_string(cores) + " threads)", label, size, [&](CopyStats &) {
+            return checksum(OD::fingerprint(data, size, OD::FA_XXH3Tree, cores));
+        });
+    }
+}
+
+static void printUsage(const char *program) {
+    std::printf("Usage: %s [--size MB] [--iterations N] [--file PATH] [--format text|csv|json] "
+                "[--output FILE]\n",
+                program);
+}
+
+int main(int argc, char *argv[]) {
+    size_t sizeMb = 512;
+    int iterations = 5;
+    std::string file;
+    auto format = BenchmarkSuite::Text;
+    std::string output;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--size") {
+            sizeMb = std::stoul(value);
+        } else if (arg == "--iterations") {
+            iterations = std::stoi(value);
+        } else if (arg == "--file") {
+            file = value;
+        } else if (arg == "--format") {
+            if (value == "text") {
+                format = BenchmarkSuite::Text;
+            } else if (value == "csv") {
+                format = BenchmarkSuite::Csv;
+            } else if (value == "json") {
+                format = BenchmarkSuite::Json;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--output") {
+            output = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Keeps the CSV and JSON reports on stdout parseable
+    if (!checkFixtures(format == BenchmarkSuite::Text && output.empty() ? stdout : stderr)) {
+        std::fprintf(stderr, "Fingerprints of the fixtures do not deduplicate correctly\n");
+        return 1;
+    }
+
+    BenchmarkSuite suite(iterations);
+
+    std::vector<uint8_t> buffer(sizeMb << 20);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = uint8_t(i * 2654435761u >> 24);
+    }
+    runAll(suite, "memory", buffer.data(), buffer.size());
+
+    // A real model through its mapping, the first pass reads it into the page cache
+    if (!file.empty()) {
+        OD::MappedFile mapped;
+        std::string errorMessage;
+        if (!mapped.open(file, &errorMessage)) {
+            std::fprintf(stderr, "%s: %s\n", file.c_str(), errorMessage.c_str());
+            return 1;
+        }
+        runAll(suite, "file", mapped.data(), mapped.size());
+    }
+
+    auto report = suite.format(format);
+    if (output.empty()) {
+        if (format == BenchmarkSuite::Text) {
+            std::fputc('\n', stdout);
+        }
+        std::fputs(report.c_str(), stdout);
+        return 0;
+    }
+    std::ofstream out(output, std::ios::binary);
+    if (!out.is_open()) {
+        std::fprintf(stderr, "Failed to open %s\n", output.c_str());
+        return 1;
+    }
+    out << report;
+    return 0;
+}
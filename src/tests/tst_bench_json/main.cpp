@@ -0,0 +1,555 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dsinfer/jsonvalue.h>
+
+#include "benchmark.h"
+#include "tensorbench.h"
+
+#ifndef TST_BENCH_JSON_BACKEND
+#  define TST_BENCH_JSON_BACKEND "nlohmann"
+#endif
+
+#ifndef TST_BENCH_JSON_FIXTURES
+#  define TST_BENCH_JSON_FIXTURES "."
+#endif
+
+namespace fs = std::filesystem;
+
+namespace DS = dsinfer;
+
+// Adds the size of the subtree that a deep copy of `ref` would materialize, binary payloads are
+// shared between copies and are not counted
+static void countCopy(const DS::JsonValueRef &ref, CopyStats &stats) {
+    stats.nodes++;
+    switch (ref.type()) {
+        case DS::JsonValue::String:
+            stats.bytes += ref.toStringView().size();
+            break;
+        case DS::JsonValue::Array:
+            if (ref.isTypedArray()) {
+                break;
+            }
+            for (const auto &item : ref.toArray()) {
+                countCopy(item, stats);
+            }
+            break;
+        case DS::JsonValue::Object:
+            for (const auto &[key, item] : ref.toObject()) {
+                stats.bytes += key.size();
+                countCopy(item, stats);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static DS::JsonValue makeTensor(const std::string &name, const std::string &type, int64_t frames,
+                                int64_t channels, size_t elemSize) {
+    std::vector<uint8_t> bytes(size_t(frames * channels) * elemSize, 0x3f);
+    return DS::JsonObject{
+        {"name",   name                                                      },
+        {"format", "bytes"                                                   },
+        {"data",
+         DS::JsonObject{
+             {"type", type},
+             {"shape", DS::JsonArray{int64_t(1), frames, channels}},
+             {"value", DS::JsonValue(bytes)},
+         }                                                                   },
+    };
+}
+
+// A task input shaped like the one AcousticInference passes to OnnxTask
+static DS::JsonValue makeTaskInput(int64_t frames) {
+    return DS::JsonObject{
+        {"session", int64_t(1)                                                     },
+        {"context", int64_t(1)                                                     },
+        {"input",
+         DS::JsonArray{
+             makeTensor("tokens", "int64", 1, frames / 8, sizeof(int64_t)),
+             makeTensor("durations", "int64", 1, frames / 8, sizeof(int64_t)),
+             makeTensor("f0", "float", 1, frames, sizeof(float)),
+             makeTensor("mel", "float", frames, 128, sizeof(float)),
+         }                                                                          },
+        {"output", DS::JsonArray{DS::JsonObject{{"name", "mel"}, {"format", "bytes"}}}},
+    };
+}
+
+// A segment shaped like the input of AcousticInference::start
+static DS::JsonValue makeSegment(int64_t frames, bool typed) {
+    std::vector<double> samples(frames);
+    for (int64_t i = 0; i < frames; ++i) {
+        samples[i] = 440.0 + double(i % 100);
+    }
+    DS::JsonValue values = typed ? DS::JsonValue(DS::JsonTypedArray(samples.data(), samples.size()))
+                                 : DS::JsonValue(DS::JsonArray(samples.begin(), samples.end()));
+    DS::JsonArray parameters;
+    for (const auto &tag : {"pitch", "energy", "breathiness", "voicing", "tension"}) {
+        parameters.emplace_back(DS::JsonObject{
+            {"tag",      tag   },
+            {"dynamic",  true  },
+            {"interval", 0.01  },
+            {"values",   values},
+        });
+    }
+    return DS::JsonObject{
+        {"context",    int64_t(0)     },
+        {"words",      DS::JsonArray{}},
+        {"parameters", parameters     },
+    };
+}
+
+// The access pattern of OnnxTask::Impl::prepareRunData and deserializeTensor before the views
+static size_t legacyTask(const DS::JsonValue &input, CopyStats &stats) {
+    size_t checksum = 0;
+    countCopy(input, stats);
+    auto obj = input.toObject();
+    auto it_input = obj.find("input");
+    countCopy(it_input->second, stats);
+    auto inputArr = it_input->second.toArray();
+    for (const auto &inputData : inputArr) {
+        countCopy(inputData, stats);
+        auto inputDataObj = inputData.toObject();
+        auto data = inputDataObj.find("data")->second;
+        countCopy(data, stats);
+        auto dataObj = data.toObject();
+        auto value = data["value"];
+        countCopy(value, stats);
+        countCopy(data["shape"], stats);
+        for (const auto &dim : data["shape"].toArray()) {
+            checksum += dim.toInt64();
+        }
+        // toBinary() and createTensorFromBytes
+        auto bytes = value.toBinary();
+        stats.bytes += 2 * bytes.size();
+        checksum += bytes.size();
+    }
+    countCopy(obj.find("output")->second, stats);
+    checksum += obj.find("output")->second.toArray().size();
+    return checksum;
+}
+
+static size_t refTask(const DS::JsonValue &input, CopyStats &stats) {
+    size_t checksum = 0;
+    auto obj = DS::JsonValueRef(input).toObject();
+    for (const auto &inputData : obj["input"].toArray()) {
+        auto inputDataObj = inputData.toObject();
+        auto data = inputDataObj["data"];
+        for (const auto &dim : data["shape"].toArray()) {
+            checksum += dim.toInt64();
+        }
+        // createTensorFromBytes copies the shared payload once into the tensor
+        auto bytes = data["value"].toBinaryView();
+        stats.bytes += bytes.size();
+        checksum += bytes.size();
+    }
+    checksum += obj["output"].toArray().size();
+    return checksum;
+}
+
+// The access pattern of from_json(Parameter) and from_json(Segment) before the views
+static size_t legacySegment(const DS::JsonValue &json, CopyStats &stats) {
+    double sum = 0;
+    auto j_parameters = json["parameters"];
+    countCopy(j_parameters, stats);
+    countCopy(j_parameters, stats);
+    for (const auto &parameter : j_parameters.toArray()) {
+        auto j_values = parameter["values"];
+        countCopy(j_values, stats);
+        countCopy(j_values, stats);
+        for (const auto &value : j_values.toArray()) {
+            sum += value.toDouble();
+        }
+    }
+    return size_t(sum);
+}
+
+static size_t refSegment(const DS::JsonValue &json, CopyStats &) {
+    double sum = 0;
+    for (const auto &parameter : DS::JsonValueRef(json)["parameters"].toArray()) {
+        for (const auto &value : parameter["values"].toArray()) {
+            sum += value.toDouble();
+        }
+    }
+    return size_t(sum);
+}
+
+// from_json(Parameter) with typed arrays, values are read in one block
+static size_t typedSegment(const DS::JsonValue &json, CopyStats &stats) {
+    double sum = 0;
+    for (const auto &parameter : DS::JsonValueRef(json)["parameters"].toArray()) {
+        auto values = parameter["values"].toTypedArray(DS::JsonTypedArray::Float64);
+        std::vector<double> samples(values.size());
+        std::memcpy(samples.data(), values.data(), values.binary().size());
+        stats.bytes += values.binary().size();
+        for (const auto &value : samples) {
+            sum += value;
+        }
+    }
+    return size_t(sum);
+}
+
+// JsonValue(const JsonObject &) and JsonValue(const JsonArray &) copy every child
+static DS::JsonValue copyObject(const DS::JsonObject &obj, CopyStats &stats) {
+    for (const auto &item : obj) {
+        countCopy(item.second, stats);
+    }
+    return obj;
+}
+
+static DS::JsonValue copyArray(const DS::JsonArray &arr, CopyStats &stats) {
+    for (const auto &item : arr) {
+        countCopy(item, stats);
+    }
+    return arr;
+}
+
+// How create_tensor and AcousticInference::start assembled the task input before JsonBuilder
+static size_t legacyBuild(const DS::JsonValue &input, CopyStats &stats) {
+    auto frames = DS::JsonValueRef(input).toInt64();
+    auto tensor = [&](const char *name, size_t size) {
+        std::vector<uint8_t> bytes(size, 0x3f);
+        stats.bytes += size;
+        auto shape = copyArray({int64_t(1), int64_t(size / 4)}, stats);
+        auto data = copyObject({{"type", "float"}, {"shape", shape}, {"value", bytes}}, stats);
+        return copyObject({{"name", name}, {"format", "bytes"}, {"data", data}}, stats);
+    };
+    DS::JsonArray inputParams;
+    inputParams.push_back(tensor("f0", frames * 4));
+    inputParams.push_back(tensor("mel", frames * 128 * 4));
+    auto output = copyArray({DS::JsonObject{{"name", "mel"}, {"format", "bytes"}}}, stats);
+    auto taskInput = copyObject({{"session", int64_t(1)},
+                                 {"context", int64_t(1)},
+                                 {"input", copyArray(inputParams, stats)},
+                                 {"output", output}},
+                                stats);
+    return DS::JsonValueRef(taskInput).size();
+}
+
+static size_t builderBuild(const DS::JsonValue &input, CopyStats &stats) {
+    auto frames = DS::JsonValueRef(input).toInt64();
+    auto tensor = [&](const char *name, size_t size) {
+        std::vector<uint8_t> bytes(size, 0x3f);
+        stats.bytes += size;
+        DS::JsonBuilder shape(DS::JsonValue::Array);
+        shape.append(int64_t(1)).append(int64_t(size / 4));
+        DS::JsonBuilder data;
+        data.insert("type", "float").insert("shape", shape.build()).insert("value", std::move(bytes));
+        DS::JsonBuilder t;
+        t.insert("name", name).insert("format", "bytes").insert("data", data.build());
+        return t.build();
+    };
+    DS::JsonArray inputParams;
+    inputParams.push_back(tensor("f0", frames * 4));
+    inputParams.push_back(tensor("mel", frames * 128 * 4));
+    DS::JsonBuilder output(DS::JsonValue::Array);
+    output.append(DS::JsonObject{{"name", "mel"}, {"format", "bytes"}});
+    DS::JsonBuilder taskInput;
+    taskInput.insert("session", int64_t(1))
+        .insert("context", int64_t(1))
+        .insert("input", std::move(inputParams))
+        .insert("output", output.build());
+    return DS::JsonValueRef(taskInput.build()).size();
+}
+
+static size_t binaryBytes(const DS::JsonValueRef &ref) {
+    size_t bytes = 0;
+    if (ref.isObject()) {
+        for (const auto &item : ref.toObject()) {
+            bytes += binaryBytes(item.second);
+        }
+    } else if (ref.isArray() && !ref.isTypedArray()) {
+        for (const auto &item : ref.toArray()) {
+            bytes += binaryBytes(item);
+        }
+    } else if (ref.isBinary()) {
+        bytes += ref.toBinaryView().size();
+    }
+    return bytes;
+}
+
+// Encodes into a new vector and decodes with from_cbor, which copies every byte string
+static size_t legacyCbor(const DS::JsonValue &input, CopyStats &stats) {
+    auto cbor = input.toCbor();
+    auto output = DS::JsonValue::fromCbor(cbor);
+    auto payload = binaryBytes(output);
+    stats.bytes += cbor.size() + payload;
+    return payload;
+}
+
+// Encodes into a reused buffer and decodes with byte strings referring to that buffer
+static size_t viewCbor(const DS::JsonValue &input, CopyStats &stats) {
+    static std::vector<uint8_t> cbor;
+    cbor.clear();
+    input.toCbor(cbor);
+    auto output = DS::JsonValue::fromCbor(DS::JsonBinary(nullptr, cbor.data(), cbor.size()));
+    stats.bytes += cbor.size();
+    return binaryBytes(output);
+}
+
+// A request as AcousticInference::start sees it: the segment arrives as JSON text, then the
+// task input is assembled from it
+static size_t request(const DS::JsonValue &input, CopyStats &stats) {
+    auto segment = DS::JsonValue::fromJson(DS::JsonValueRef(input).toString(), false);
+    auto frames = DS::JsonValue(int64_t(segment["parameters"][0]["values"].toArray().size()));
+    return refSegment(segment, stats) + builderBuild(frames, stats);
+}
+
+static size_t arenaRequest(const DS::JsonValue &input, CopyStats &stats) {
+    DS::JsonArena arena;
+    return request(input, stats);
+}
+
+// A phoneme map like the phonemes.json of an acoustic model
+static std::string makePhonemeMap(int count) {
+    DS::JsonBuilder phonemes;
+    phonemes.insert("AP", 1).insert("SP", 2);
+    for (int i = 0; i < count; ++i) {
+        phonemes.insert("lang" + std::to_string(i % 4) + "/ph" + std::to_string(i), i + 3);
+    }
+    return phonemes.build().toJson(4);
+}
+
+// A tensor in the "array" format of serializeTensorAsArray, the value is a Float32 typed array
+static DS::JsonValue makeArrayTensor(const std::vector<int64_t> &shape) {
+    size_t count = 1;
+    for (const auto &dim : shape) {
+        count *= size_t(dim);
+    }
+    std::vector<float> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = float(i % 1000) * 0.001f;
+    }
+    DS::JsonBuilder data;
+    data.insert("type", "float")
+        .insert("shape", DS::JsonArray(shape.begin(), shape.end()))
+        .insert("value", DS::JsonTypedArray(values.data(), values.size()));
+    DS::JsonBuilder tensor;
+    tensor.insert("name", "mel").insert("format", "array").insert("data", data.build());
+    return tensor.build();
+}
+
+static std::string shapeLabel(const std::vector<int64_t> &shape) {
+    std::string label;
+    for (const auto &dim : shape) {
+        label += (label.empty() ? "" : "x") + std::to_string(dim);
+    }
+    return label;
+}
+
+// The JsonValue operations a tensor goes through between the driver and its callers
+static void runCoreBenchmarks(BenchmarkSuite &suite, const std::vector<int64_t> &shape) {
+    auto label = shapeLabel(shape);
+    auto elements = size_t(shape[1]) * (shape.size() > 2 ? size_t(shape[2]) : 1);
+    auto bytes = elements * sizeof(float);
+
+    auto arrayTensor = makeArrayTensor(shape);
+    auto bytesTensor = makeTensor("mel", "float", shape[1], shape.size() > 2 ? shape[2] : 1,
+                                  sizeof(float));
+    auto text = arrayTensor.toJson();
+    auto cbor = bytesTensor.toCbor();
+
+    suite.run("toJson", label, bytes, [&](CopyStats &stats) {
+        auto out = arrayTensor.toJson();
+        stats.bytes += out.size();
+        return out.size();
+    });
+    suite.run("fromJson", label, text.size(), [&](CopyStats &) {
+        return DS::JsonValueRef(DS::JsonValue::fromJson(text, false))["data"]["value"].size();
+    });
+    suite.run("toCbor", label, bytes, [&](CopyStats &stats) {
+        auto out = bytesTensor.toCbor();
+        stats.bytes += out.size();
+        return out.size();
+    });
+    std::vector<uint8_t> buffer;
+    suite.run("toCbor/append", label, bytes, [&](CopyStats &stats) {
+        buffer.clear();
+        bytesTensor.toCbor(buffer);
+        stats.bytes += buffer.size();
+        return buffer.size();
+    });
+    suite.run("fromCbor", label, cbor.size(), [&](CopyStats &stats) {
+        auto payload = binaryBytes(DS::JsonValue::fromCbor(cbor));
+        stats.bytes += payload;
+        return payload;
+    });
+    suite.run("fromCbor/view", label, cbor.size(), [&](CopyStats &) {
+        return binaryBytes(
+            DS::JsonValue::fromCbor(DS::JsonBinary(nullptr, cbor.data(), cbor.size())));
+    });
+
+    auto typedValue = DS::JsonValueRef(arrayTensor)["data"]["value"].toValue();
+    auto plainValue = DS::JsonValue(typedValue.toArray());
+    suite.run("toArray", label, bytes, [&](CopyStats &stats) {
+        countCopy(plainValue, stats);
+        return plainValue.toArray().size();
+    });
+    // Expands every element of the typed array into a node
+    suite.run("toArray/typed", label, bytes, [&](CopyStats &stats) {
+        auto arr = typedValue.toArray();
+        stats.nodes += arr.size() + 1;
+        return arr.size();
+    });
+    suite.run("toObject", label, bytes, [&](CopyStats &stats) {
+        countCopy(arrayTensor, stats);
+        return arrayTensor.toObject().size();
+    });
+}
+
+static void runParseBenchmark(BenchmarkSuite &suite, const std::string &name,
+                              const std::string &text) {
+    suite.run("fromJson", name, text.size(), [&](CopyStats &) {
+        std::string error;
+        auto value = DS::JsonValue::fromJson(text, false, &error);
+        return error.empty() ? DS::JsonValueRef(value).size() : 0;
+    });
+}
+
+static void printUsage(const char *program) {
+    std::printf("Usage: %s [--frames N] [--iterations N] [--format text|csv|json] "
+                "[--output FILE] [--ort PATH]\n",
+                program);
+}
+
+int main(int argc, char *argv[]) {
+    int64_t frames = 2000;
+    int iterations = 20;
+    auto format = BenchmarkSuite::Text;
+    std::string output;
+    std::string ortPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--frames") {
+            frames = std::stoll(value);
+        } else if (arg == "--iterations") {
+            iterations = std::stoi(value);
+        } else if (arg == "--format") {
+            if (value == "text") {
+                format = BenchmarkSuite::Text;
+            } else if (value == "csv") {
+                format = BenchmarkSuite::Csv;
+            } else if (value == "json") {
+                format = BenchmarkSuite::Json;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--output") {
+            output = value;
+        } else if (arg == "--ort") {
+            ortPath = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    BenchmarkSuite suite(iterations);
+
+    auto task = makeTaskInput(frames);
+    suite.run("task/legacy", "task", 0, [&](CopyStats &stats) { return legacyTask(task, stats); });
+    suite.run("task/ref", "task", 0, [&](CopyStats &stats) { return refTask(task, stats); });
+
+    auto segment = makeSegment(frames, false);
+    suite.run("segment/legacy", "segment", 0,
+              [&](CopyStats &stats) { return legacySegment(segment, stats); });
+    suite.run("segment/ref", "segment", 0,
+              [&](CopyStats &stats) { return refSegment(segment, stats); });
+
+    auto typed = makeSegment(frames, true);
+    auto typedCbor = DS::JsonValue::fromCbor(typed.toCbor());
+    suite.run("segment/typed", "segment", 0,
+              [&](CopyStats &stats) { return typedSegment(typed, stats); });
+    suite.run("segment/typed+cbor", "segment", 0,
+              [&](CopyStats &stats) { return typedSegment(typedCbor, stats); });
+
+    // Round trip of a task input carrying a 10 MB mel tensor
+    auto cborTask = makeTaskInput(10 * 1024 * 1024 / (128 * sizeof(float)));
+    suite.run("cbor/legacy", "task", 0,
+              [&](CopyStats &stats) { return legacyCbor(cborTask, stats); });
+    suite.run("cbor/view", "task", 0, [&](CopyStats &stats) { return viewCbor(cborTask, stats); });
+
+    // Allocations of one request with and without a JsonArena scope
+    auto segmentText = DS::JsonValue(makeSegment(frames, false).toJson());
+    suite.run("request/heap", "segment", 0,
+              [&](CopyStats &stats) { return request(segmentText, stats); });
+    suite.run("request/arena", "segment", 0,
+              [&](CopyStats &stats) { return arenaRequest(segmentText, stats); });
+
+    // Every tensor is created once (counted as copied bytes), the rest is JsonValue overhead
+    auto framesValue = DS::JsonValue(frames);
+    suite.run("build/legacy", "task", 0,
+              [&](CopyStats &stats) { return legacyBuild(framesValue, stats); });
+    suite.run("build/builder", "task", 0,
+              [&](CopyStats &stats) { return builderBuild(framesValue, stats); });
+
+    // From a single frame to a full mel spectrogram
+    for (const auto &shape : std::vector<std::vector<int64_t>>{
+             {1, frames},
+             {1, frames, 128},
+         }) {
+        runCoreBenchmarks(suite, shape);
+    }
+
+#ifdef TST_BENCH_JSON_ONNX
+    std::string errorMessage;
+    if (initOrt(ortPath.empty() ? defaultOrtPath() : fs::path(ortPath), &errorMessage)) {
+        for (const auto &shape : std::vector<std::vector<int64_t>>{
+                 {1, frames},
+                 {1, frames, 128},
+             }) {
+            runTensorBenchmarks(suite, shapeLabel(shape), shape);
+        }
+    } else {
+        std::fprintf(stderr, "Skipping tensor benchmarks: %s\n", errorMessage.c_str());
+    }
+#else
+    if (!ortPath.empty()) {
+        std::fprintf(stderr, "Skipping tensor benchmarks: built without onnxruntime\n");
+    }
+#endif
+
+    // The parse backend is chosen when dsinfer is built, run once per build to compare them
+    std::error_code ec;
+    for (const auto &entry : fs::recursive_directory_iterator(TST_BENCH_JSON_FIXTURES, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::stringstream ss;
+            ss << file.rdbuf();
+            runParseBenchmark(suite, entry.path().filename().string(), ss.str());
+        }
+    }
+    runParseBenchmark(suite, "phonemes (1k entries)", makePhonemeMap(1000));
+    runParseBenchmark(suite, "phonemes (50k entries)", makePhonemeMap(50000));
+    runParseBenchmark(suite, "segment", makeSegment(frames, false).toJson());
+
+    auto report = suite.format(format, {{"jsonBackend", TST_BENCH_JSON_BACKEND}});
+    if (output.empty()) {
+        std::fputs(report.c_str(), stdout);
+        return 0;
+    }
+    std::ofstream file(output, std::ios::binary);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "Failed to open %s\n", output.c_str());
+        return 1;
+    }
+    file << report;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "tensorbench.h"
+
+#ifdef TST_BENCH_JSON_ONNX
+
+#include <numeric>
+
+#include <stdcorelib/library.h>
+#include <stdcorelib/strings.h>
+
+#include <onnxruntime_cxx_api.h>
+
+#include <dsinfer/jsonvalue.h>
+
+#include "valueparser.h"
+
+namespace fs = std::filesystem;
+
+namespace DS = dsinfer;
+
+bool initOrt(const fs::path &path, std::string *errorMessage) {
+    static stdc::Library library;
+#ifdef _WIN32
+    auto orgLibPath = stdc::Library::setLibraryPath(path.parent_path());
+#endif
+    bool opened = library.open(path, stdc::Library::ResolveAllSymbolsHint);
+#ifdef _WIN32
+    stdc::Library::setLibraryPath(orgLibPath);
+#endif
+    if (!opened) {
+        *errorMessage = stdc::formatN("Load library failed: %1 [%2]", library.lastError(), path);
+        return false;
+    }
+    auto handle = (OrtApiBase * (ORT_API_CALL *) ()) library.resolve("OrtGetApiBase");
+    if (!handle) {
+        *errorMessage = stdc::formatN("Failed to get API handle: %1 [%2]", library.lastError(), path);
+        return false;
+    }
+    auto api = handle()->GetApi(ORT_API_VERSION);
+    if (!api) {
+        *errorMessage = "Failed to get API instance";
+        return false;
+    }
+    Ort::InitApi(api);
+    return true;
+}
+
+fs::path defaultOrtPath() {
+    return fs::path(TST_BENCH_JSON_ORT_DIR) /
+#if defined(_WIN32)
+           L"onnxruntime.dll"
+#elif defined(__APPLE__)
+           "libonnxruntime.dylib"
+#else
+           "libonnxruntime.so"
+#endif
+        ;
+}
+
+void runTensorBenchmarks(BenchmarkSuite &suite, const std::string &label,
+                         const std::vector<int64_t> &shape) {
+    auto count = std::accumulate(shape.begin(), shape.end(), int64_t{1}, std::multiplies<>());
+    auto bytes = size_t(count) * sizeof(float);
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    auto tensor = Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size());
+    auto data = tensor.GetTensorMutableData<float>();
+    for (int64_t i = 0; i < count; ++i) {
+        data[i] = float(i % 1000) * 0.001f;
+    }
+
+    auto elementCount = [](const Ort::Value &value) {
+        return value ? value.GetTensorTypeAndShapeInfo().GetElementCount() : size_t(0);
+    };
+
+    suite.run("serializeTensorAsBytes", label, bytes, [&](CopyStats &stats) {
+        auto value = dsinfer::onnxdriver::serializeTensorAsBytes(tensor);
+        stats.bytes += bytes;
+        return DS::JsonValueRef(value)["value"].toBinaryView().size();
+    });
+    suite.run("serializeTensorAsArray", label, bytes, [&](CopyStats &stats) {
+        auto value = dsinfer::onnxdriver::serializeTensorAsArray(tensor);
+        stats.bytes += bytes;
+        return DS::JsonValueRef(value)["value"].size();
+    });
+
+    auto asBytes = dsinfer::onnxdriver::serializeTensorAsBytes(tensor);
+    auto asTypedArray = dsinfer::onnxdriver::serializeTensorAsArray(tensor);
+    // The same array as it arrives in JSON text, one node per element
+    auto asArray = DS::JsonValue::fromJson(asTypedArray.toJson(), false);
+
+    suite.run("deserializeTensor/bytes", label, bytes, [&](CopyStats &stats) {
+        stats.bytes += bytes;
+        return elementCount(dsinfer::onnxdriver::deserializeTensor(asBytes));
+    });
+    suite.run("deserializeTensor/typed", label, bytes, [&](CopyStats &stats) {
+        stats.bytes += bytes;
+        return elementCount(dsinfer::onnxdriver::deserializeTensor(asTypedArray));
+    });
+    suite.run("deserializeTensor/array", label, bytes, [&](CopyStats &stats) {
+        stats.bytes += bytes;
+        return elementCount(dsinfer::onnxdriver::deserializeTensor(asArray));
+    });
+
+    // Bytes and typed arrays are wrapped in place
+    auto sharedElementCount = [&](const std::shared_ptr<Ort::Value> &value) {
+        return value ? elementCount(*value) : size_t(0);
+    };
+    suite.run("deserializeSharedTensor/bytes", label, bytes, [&](CopyStats &) {
+        return sharedElementCount(dsinfer::onnxdriver::deserializeSharedTensor(asBytes));
+    });
+    suite.run("deserializeSharedTensor/typed", label, bytes, [&](CopyStats &) {
+        return sharedElementCount(dsinfer::onnxdriver::deserializeSharedTensor(asTypedArray));
+    });
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef TENSORBENCH_H
+#define TENSORBENCH_H
+
+#ifdef TST_BENCH_JSON_ONNX
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+// Loads the onnxruntime library at `path` and initializes the C++ API with it
+bool initOrt(const std::filesystem::path &path, std::string *errorMessage);
+
+std::filesystem::path defaultOrtPath();
+
+// serializeTensorAsBytes/AsArray and deserializeTensor of a float tensor of `shape`
+void runTensorBenchmarks(BenchmarkSuite &suite, const std::string &label,
+                         const std::vector<int64_t> &shape);
+
+#endif
+
+#endif // TENSORBENCH_H
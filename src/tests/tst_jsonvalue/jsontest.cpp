@@ -0,0 +1,734 @@
+#include "jsontest.h"
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <dsinfer/jsonvalue.h>
+#include <dsinfer/jsonstreamreader.h>
+
+#define ENSURE(cond)                                                                               \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            logger.critical("%1:%2: check failed: %3", __FILE__, __LINE__, #cond);                 \
+            return false;                                                                          \
+        }                                                                                          \
+    } while (false)
+
+namespace DS = dsinfer;
+
+JsonTest::JsonTest(DS::Log::Category &logger) : logger(logger) {
+}
+
+bool JsonTest::testValueRef() {
+    std::string error;
+    auto value = DS::JsonValue::fromJson(
+        R"({"name":"mel","shape":[1,2.5,"x"],"data":{"type":"float","empty":{}}})", false, &error);
+    ENSURE(error.empty());
+
+    DS::JsonValueRef ref(value);
+    ENSURE(ref.isObject());
+    ENSURE(ref.size() == 3);
+
+    // Lookups point into the tree instead of copying it
+    ENSURE(ref["name"].toStringView() == "mel");
+    ENSURE(ref["name"].toStringView().data() == ref["name"].toStringView().data());
+    ENSURE(ref["shape"].isArray());
+    ENSURE(ref["shape"].size() == 3);
+    ENSURE(ref["shape"][0].toInt() == 1);
+    ENSURE(ref["shape"][1].toDouble() == 2.5);
+    ENSURE(ref["shape"][2].toString() == "x");
+    ENSURE(ref["data"]["type"].toStringView() == "float");
+    ENSURE(ref["data"]["empty"].isObject());
+    ENSURE(ref["data"]["empty"].size() == 0);
+
+    // Misses yield Undefined references and defaults
+    ENSURE(DS::JsonValueRef().isUndefined());
+    ENSURE(ref["missing"].isUndefined());
+    ENSURE(ref["missing"]["deeper"].isUndefined());
+    ENSURE(ref["shape"][3].isUndefined());
+    ENSURE(ref["shape"][-1].isUndefined());
+    ENSURE(ref["name"]["key"].isUndefined());
+    ENSURE(ref["name"][0].isUndefined());
+    ENSURE(ref[0].isUndefined());
+    ENSURE(ref["missing"].toInt(7) == 7);
+    ENSURE(ref["missing"].toStringView("none") == "none");
+    ENSURE(ref["name"].toInt(7) == 7);
+    ENSURE(ref["missing"].toArray().empty());
+    ENSURE(ref["missing"].toObject().empty());
+    ENSURE(ref["missing"].toValue() == value["missing"]);
+
+    // Objects are iterated in key order and searched by key
+    auto object = ref.toObject();
+    ENSURE(object.size() == 3);
+    std::vector<std::string> keys;
+    for (const auto &[key, item] : object) {
+        keys.emplace_back(key);
+    }
+    ENSURE((keys == std::vector<std::string>{"data", "name", "shape"}));
+    ENSURE(object.contains("name"));
+    ENSURE(!object.contains("nam"));
+    ENSURE(object.find("missing") == object.end());
+    ENSURE(object["shape"].size() == 3);
+    ENSURE(object["missing"].isUndefined());
+
+    // Arrays are iterated in order
+    auto array = ref["shape"].toArray();
+    ENSURE(array.size() == 3);
+    int count = 0;
+    for (const auto &item : array) {
+        ENSURE(item == array[count]);
+        count++;
+    }
+    ENSURE(count == 3);
+    ENSURE(array.at(3).isUndefined());
+
+    // Elements of typed arrays are read through the same interface
+    auto typed = DS::JsonValue(DS::JsonObject{
+        {"f0", DS::JsonTypedArray(std::vector<float>{1.5f, 2.5f})},
+    });
+    DS::JsonValueRef typedRef(typed);
+    ENSURE(typedRef["f0"].isArray());
+    ENSURE(typedRef["f0"].isTypedArray());
+    ENSURE(typedRef["f0"].size() == 2);
+    ENSURE(typedRef["f0"][1].isDouble());
+    ENSURE(typedRef["f0"][1].toDouble() == 2.5);
+    ENSURE(!typedRef["f0"][1].isTypedArray());
+    ENSURE(typedRef["f0"][2].isUndefined());
+
+    // Copies and comparisons
+    ENSURE(ref["data"].toValue() == value["data"]);
+    ENSURE(ref["shape"] == DS::JsonValueRef(value)["shape"]);
+    ENSURE(ref["shape"] != ref["name"]);
+    ENSURE(DS::JsonValueRef() == ref["missing"]);
+    ENSURE(DS::JsonValueRef() != ref["name"]);
+    return true;
+}
+
+bool JsonTest::testBuilder() {
+    // Empty arrays and objects stay arrays and objects
+    ENSURE(DS::JsonValue(DS::JsonArray()).isArray());
+    ENSURE(DS::JsonValue(DS::JsonObject()).isObject());
+    ENSURE(DS::JsonValue(DS::JsonArray()).toJson() == "[]");
+    ENSURE(DS::JsonValue(DS::JsonObject()).toJson() == "{}");
+    {
+        const DS::JsonArray emptyArray;
+        const DS::JsonObject emptyObject;
+        ENSURE(DS::JsonValue(emptyArray).isArray());
+        ENSURE(DS::JsonValue(emptyObject).isObject());
+    }
+    ENSURE(DS::JsonBuilder(DS::JsonValue::Array).build().isArray());
+    ENSURE(DS::JsonBuilder(DS::JsonValue::Object).build().isObject());
+
+    // Children nobody else refers to are moved, a string keeps its buffer
+    const std::string longString(1000, 'a');
+    {
+        DS::JsonValue item(longString);
+        auto data = DS::JsonValueRef(item).toStringView().data();
+        DS::JsonArray array;
+        array.push_back(std::move(item));
+        DS::JsonValue value(std::move(array));
+        ENSURE(array.empty());
+        ENSURE(value.isArray());
+        ENSURE(DS::JsonValueRef(value)[0].toStringView().data() == data);
+    }
+    {
+        DS::JsonValue item(longString);
+        auto data = DS::JsonValueRef(item).toStringView().data();
+        DS::JsonObject object;
+        object.emplace("key", std::move(item));
+        DS::JsonValue value(std::move(object));
+        ENSURE(object.empty());
+        ENSURE(DS::JsonValueRef(value)["key"].toStringView().data() == data);
+    }
+
+    // Children shared with another value are copied, the other one is left intact
+    {
+        DS::JsonValue shared(longString);
+        DS::JsonArray array{shared, DS::JsonValue(1)};
+        DS::JsonValue value(std::move(array));
+        ENSURE(shared.toString() == longString);
+        ENSURE(value[0].toString() == longString);
+        ENSURE(value[1].toInt() == 1);
+        ENSURE(DS::JsonValueRef(value)[0].toStringView().data() !=
+               DS::JsonValueRef(shared).toStringView().data());
+
+        DS::JsonObject object{
+            {"shared", shared},
+        };
+        DS::JsonValue objectValue(std::move(object));
+        ENSURE(shared.toString() == longString);
+        ENSURE(objectValue["shared"].toString() == longString);
+    }
+
+    // Array builder
+    {
+        DS::JsonValue shared("shared");
+        DS::JsonValue item(longString);
+        auto data = DS::JsonValueRef(item).toStringView().data();
+        DS::JsonBuilder builder(DS::JsonValue::Array);
+        builder.reserve(3).append(shared).append(std::move(item)).append(DS::JsonValue(2.5));
+        builder.insert("ignored", 1);
+        auto value = builder.build();
+        ENSURE(value.isArray());
+        ENSURE(value.toArray().size() == 3);
+        ENSURE(value[0].toString() == "shared");
+        ENSURE(shared.toString() == "shared");
+        ENSURE(DS::JsonValueRef(value)[1].toStringView().data() == data);
+        ENSURE(value[2].toDouble() == 2.5);
+
+        // The builder is empty afterwards
+        auto next = builder.build();
+        ENSURE(next.isArray());
+        ENSURE(next.toArray().empty());
+    }
+
+    // Object builder
+    {
+        DS::JsonBuilder builder(DS::JsonValue::Object);
+        builder.insert("b", DS::JsonValue(true)).insert("a", DS::JsonArray{1, 2});
+        builder.append(DS::JsonValue(3));
+        builder.insert("b", DS::JsonValue(false));
+        auto value = builder.build();
+        ENSURE(value.isObject());
+        ENSURE(value.toJson() == R"({"a":[1,2],"b":false})");
+        ENSURE(builder.build().toObject().empty());
+    }
+    return true;
+}
+
+bool JsonTest::testBinary() {
+    // A moved vector is adopted without copying
+    {
+        std::vector<uint8_t> bytes{1, 2, 3};
+        auto data = bytes.data();
+        DS::JsonBinary binary(std::move(bytes));
+        ENSURE(binary.data() == data);
+        ENSURE(binary.size() == 3);
+        ENSURE(binary.owner());
+
+        // Copies share the buffer, a moved-from binary is empty
+        auto copy = binary;
+        ENSURE(copy.data() == data);
+        auto moved = std::move(copy);
+        ENSURE(moved.data() == data);
+        ENSURE(copy.empty());
+        ENSURE(copy.data() == nullptr);
+        ENSURE((moved.toVector() == std::vector<uint8_t>{1, 2, 3}));
+    }
+
+    // A foreign allocation lives as long as any copy of the binary
+    std::weak_ptr<std::vector<uint8_t>> weakOwner;
+    {
+        auto owner = std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>{4, 5, 6, 7});
+        weakOwner = owner;
+        DS::JsonBinary binary(owner, owner->data() + 1, 2);
+        owner.reset();
+        ENSURE(!weakOwner.expired());
+        ENSURE(binary.size() == 2);
+        ENSURE(binary.data()[0] == 5);
+
+        DS::JsonValue value(binary);
+        binary = DS::JsonBinary();
+        ENSURE(!weakOwner.expired());
+        ENSURE(value.isBinary());
+        ENSURE((value.toBinary() == std::vector<uint8_t>{5, 6}));
+
+        // A view taken from the value keeps the buffer after the value is gone
+        auto view = value.toBinaryView();
+        value = DS::JsonValue();
+        ENSURE(!weakOwner.expired());
+        ENSURE(view.data()[1] == 6);
+    }
+    ENSURE(weakOwner.expired());
+
+    // Values share the payload with the views taken from them
+    {
+        std::vector<uint8_t> bytes(4096, 0x5a);
+        auto data = bytes.data();
+        DS::JsonValue value(std::move(bytes));
+        ENSURE(value.isBinary());
+        ENSURE(value.toBinaryView().data() == data);
+
+        auto copy = value;
+        ENSURE(copy.toBinaryView().data() == data);
+        auto tree = DS::JsonValue(DS::JsonObject{
+            {"value", value},
+        });
+        ENSURE(tree["value"].toBinaryView().data() == data);
+        ENSURE(DS::JsonValueRef(tree)["value"].toBinaryView().data() == data);
+        ENSURE(DS::JsonValueRef(tree)["value"].toBinaryView().size() == 4096);
+
+        // toBinary() copies
+        ENSURE(value.toBinary().data() != data);
+        ENSURE(value.toBinary().size() == 4096);
+    }
+
+    // Raw pointers are copied
+    {
+        uint8_t raw[] = {9, 8};
+        DS::JsonValue value(raw, 2);
+        ENSURE(value.toBinaryView().data() != raw);
+        ENSURE((value.toBinary() == std::vector<uint8_t>{9, 8}));
+    }
+
+    // Views of anything else are empty
+    ENSURE(DS::JsonValue("text").toBinaryView().empty());
+    ENSURE(DS::JsonValue(DS::JsonTypedArray(std::vector<float>{1.0f})).toBinaryView().empty());
+    ENSURE(DS::JsonValueRef()["missing"].toBinaryView().empty());
+    ENSURE(DS::JsonValue("text").toBinary({1}) == std::vector<uint8_t>{1});
+    return true;
+}
+
+// Whether `value` is a typed array of `type` holding `expected`
+static bool isTypedArrayOf(const DS::JsonValue &value, DS::JsonTypedArray::ElementType type,
+                           const std::vector<double> &expected) {
+    if (!value.isArray() || !value.isTypedArray()) {
+        return false;
+    }
+    auto array = value.toTypedArray(type);
+    if (array.elementType() != type || array.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        auto item = value[int(i)];
+        auto itemValue = item.isBool() ? double(item.toBool()) : item.toDouble();
+        if (array.toDouble(i) != expected[i] || itemValue != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonTest::testTypedArray() {
+    using Type = DS::JsonTypedArray::ElementType;
+
+    const std::vector<double> numbers{1.5, -2, 0, 1e10};
+    const std::vector<double> integers{1, -2, 0, 1 << 30};
+    const std::vector<double> flags{1, 0, 0, 1};
+    const bool bools[] = {true, false, false, true};
+    auto value = DS::JsonValue(DS::JsonObject{
+        {"f32", DS::JsonTypedArray(std::vector<float>{1.5f, -2, 0, 1e10f})},
+        {"f64", DS::JsonTypedArray(std::vector<double>(numbers))},
+        {"i64", DS::JsonTypedArray(std::vector<int64_t>{1, -2, 0, 1 << 30})},
+        {"bool", DS::JsonTypedArray(bools, 4)},
+        {"empty", DS::JsonTypedArray(std::vector<float>())},
+    });
+    ENSURE(isTypedArrayOf(value["f32"], Type::Float32, numbers));
+    ENSURE(isTypedArrayOf(value["f64"], Type::Float64, numbers));
+    ENSURE(isTypedArrayOf(value["i64"], Type::Int64, integers));
+    ENSURE(isTypedArrayOf(value["bool"], Type::Bool, flags));
+    ENSURE(value["bool"][0].isBool());
+    ENSURE(value["empty"].isTypedArray());
+    ENSURE(value["empty"].toArray().empty());
+
+    // Converting to another element type packs a new array, the same type shares the storage
+    ENSURE(value["f32"].toTypedArray(Type::Float32).data() ==
+           value["f32"].toTypedArray(Type::Float32).data());
+    ENSURE(value["i64"].toTypedArray(Type::Float64).toDouble(3) == double(1 << 30));
+    ENSURE(DS::JsonValue(DS::JsonArray{1, 2.5, true}).toTypedArray(Type::Float32).toDouble(1) ==
+           2.5);
+    ENSURE(DS::JsonValue("text").toTypedArray(Type::Float32).empty());
+
+    // JSON text has no typed arrays, they come back as arrays of the same numbers
+    const std::string expectedJson =
+        R"({"bool":[true,false,false,true],"empty":[],"f32":[1.5,-2.0,0.0,10000000000.0],)"
+        R"("f64":[1.5,-2.0,0.0,10000000000.0],"i64":[1,-2,0,1073741824]})";
+    ENSURE(value.toJson() == expectedJson);
+    std::string error;
+    auto fromJson = DS::JsonValue::fromJson(value.toJson(), false, &error);
+    ENSURE(error.empty());
+    ENSURE(!fromJson["f32"].isTypedArray());
+    ENSURE(fromJson.toJson() == expectedJson);
+    ENSURE(fromJson == value);
+    ENSURE(value == fromJson);
+    ENSURE(DS::JsonValueRef(value) == DS::JsonValueRef(fromJson));
+    ENSURE(DS::JsonValueRef(fromJson)["i64"] == DS::JsonValueRef(value)["i64"]);
+    ENSURE(fromJson["f64"].toTypedArray(Type::Float64).toDouble(0) == 1.5);
+    ENSURE(fromJson["bool"].toTypedArray(Type::Bool).toBool(3));
+
+    // Typed arrays equal the plain arrays holding the same elements, as they read back from JSON
+    auto tenth = DS::JsonValue(DS::JsonTypedArray(std::vector<float>{0.1f}));
+    ENSURE(DS::JsonValue::fromJson(tenth.toJson(), false, &error) == tenth);
+    ENSURE(tenth != DS::JsonValue(DS::JsonArray{0.1}));
+    ENSURE(value["f32"] == value["f64"]);
+    ENSURE(value["f32"] != value["i64"]);
+    ENSURE(value["bool"] != DS::JsonValue(DS::JsonArray{true, false, false}));
+    ENSURE(value["empty"] == DS::JsonValue(DS::JsonArray()));
+    ENSURE(value["empty"] != DS::JsonValue(DS::JsonObject()));
+
+    // CBOR keeps the element types, through both decoders
+    auto cbor = value.toCbor();
+    for (const auto &decoded : {
+             DS::JsonValue::fromCbor(cbor, &error),
+             DS::JsonValue::fromCbor(DS::JsonBinary(cbor.data(), cbor.size()), &error),
+         }) {
+        ENSURE(error.empty());
+        ENSURE(decoded == value);
+        ENSURE(isTypedArrayOf(decoded["f32"], Type::Float32, numbers));
+        ENSURE(isTypedArrayOf(decoded["f64"], Type::Float64, numbers));
+        ENSURE(isTypedArrayOf(decoded["i64"], Type::Int64, integers));
+        ENSURE(isTypedArrayOf(decoded["bool"], Type::Bool, flags));
+        ENSURE(decoded.toJson() == expectedJson);
+    }
+
+    // The tags of RFC 8746 are written for the numbers
+    auto f32Cbor = DS::JsonValue(DS::JsonTypedArray(std::vector<float>{1.0f})).toCbor();
+    ENSURE((std::vector<uint8_t>(f32Cbor.begin(), f32Cbor.begin() + 3) ==
+            std::vector<uint8_t>{0xD8, 85, 0x44}));
+
+    // A uint8 typed array (tag 64) of another producer is a plain binary
+    const std::vector<uint8_t> uint8Cbor{0xD8, 64, 0x43, 1, 2, 3};
+    for (const auto &decoded : {
+             DS::JsonValue::fromCbor(uint8Cbor, &error),
+             DS::JsonValue::fromCbor(DS::JsonBinary(uint8Cbor.data(), uint8Cbor.size()), &error),
+         }) {
+        ENSURE(error.empty());
+        ENSURE(decoded.isBinary());
+        ENSURE(!decoded.isTypedArray());
+        ENSURE((decoded.toBinary() == std::vector<uint8_t>{1, 2, 3}));
+    }
+    return true;
+}
+
+// Decodes `cbor` with Json::from_cbor() and with the zero-copy reader, returns whether both agree
+static bool decodesAlike(const std::vector<uint8_t> &cbor, bool *accepted) {
+    std::string vectorError;
+    std::string binaryError;
+    auto fromVector = DS::JsonValue::fromCbor(cbor, &vectorError);
+    auto fromBinary = DS::JsonValue::fromCbor(DS::JsonBinary(cbor.data(), cbor.size()),
+                                              &binaryError);
+    if (vectorError.empty() != binaryError.empty() || fromVector != fromBinary) {
+        return false;
+    }
+    *accepted = binaryError.empty();
+    return true;
+}
+
+bool JsonTest::testCbor() {
+    const std::vector<std::vector<uint8_t>> valid{
+        // Integers
+        {0x00},
+        {0x17},
+        {0x18, 0x18},
+        {0x38, 0x63},
+        {0x1B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        {0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        // Simple values
+        {0xF4},
+        {0xF5},
+        {0xF6},
+        // Half floats, including a subnormal one and infinities
+        {0xF9, 0x3C, 0x00},
+        {0xF9, 0x7B, 0xFF},
+        {0xF9, 0x00, 0x01},
+        {0xF9, 0xC4, 0x00},
+        {0xF9, 0x7C, 0x00},
+        {0xF9, 0xFC, 0x00},
+        // Single and double floats
+        {0xFA, 0x47, 0xC3, 0x50, 0x00},
+        {0xFA, 0x7F, 0x80, 0x00, 0x00},
+        {0xFB, 0x3F, 0xF1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A},
+        // Definite and indefinite strings
+        {0x43, 0x01, 0x02, 0x03},
+        {0x5F, 0x42, 0x01, 0x02, 0x40, 0x41, 0x03, 0xFF},
+        {0x5F, 0xFF},
+        {0x62, 'a', 'b'},
+        {0x7F, 0x62, 'a', 'b', 0x61, 'c', 0xFF},
+        // Definite and indefinite containers
+        {0x82, 0x01, 0x80},
+        {0x9F, 0x01, 0x9F, 0xFF, 0x82, 0x02, 0x03, 0xFF},
+        {0xA2, 0x61, 'a', 0x01, 0x61, 'b', 0xA0},
+        {0xBF, 0x61, 'a', 0x01, 0x61, 'b', 0x9F, 0xF5, 0xFF, 0xFF},
+        {0xA2, 0x61, 'a', 0x01, 0x61, 'a', 0x02},
+        // Tags are kept on byte strings, tags 6 to 20 are ignored
+        {0xD8, 0x55, 0x44, 0x00, 0x00, 0x80, 0x3F},
+        {0xD9, 0x01, 0x00, 0x41, 0x05},
+        {0xDA, 0x00, 0x01, 0x00, 0x00, 0x41, 0x05},
+        {0xDB, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x41, 0x05},
+        {0xC6, 0x41, 0x01},
+        {0xD4, 0x1A, 0x51, 0x4B, 0x67, 0xB0},
+        {0x81, 0xD8, 0x40, 0x5F, 0x41, 0x01, 0xFF},
+    };
+    bool accepted = false;
+    for (const auto &cbor : valid) {
+        ENSURE(decodesAlike(cbor, &accepted));
+        ENSURE(accepted);
+
+        // Every truncation fails in both decoders
+        for (size_t size = 0; size < cbor.size(); ++size) {
+            ENSURE(decodesAlike(std::vector<uint8_t>(cbor.begin(), cbor.begin() + size), &accepted));
+            ENSURE(!accepted);
+        }
+    }
+
+    // NaN never compares equal, check the decoded numbers instead
+    for (const auto &cbor : {
+             std::vector<uint8_t>{0xF9, 0x7E, 0x00},
+             std::vector<uint8_t>{0xFA, 0x7F, 0xC0, 0x00, 0x00},
+         }) {
+        std::string error;
+        ENSURE(std::isnan(DS::JsonValue::fromCbor(cbor, &error).toDouble()));
+        ENSURE(std::isnan(DS::JsonValue::fromCbor(DS::JsonBinary(cbor.data(), cbor.size()), &error)
+                              .toDouble()));
+        ENSURE(error.empty());
+    }
+    std::string error;
+    ENSURE(DS::JsonValue::fromCbor({0xF9, 0x00, 0x01}, &error).toDouble() == std::ldexp(1.0, -24));
+    ENSURE(DS::JsonValue::fromCbor({0xF9, 0x7B, 0xFF}, &error).toDouble() == 65504);
+
+    const std::vector<std::vector<uint8_t>> invalid{
+        // Stray breaks and reserved additional information
+        {0xFF},
+        {0x81, 0xFF},
+        {0x1C},
+        {0x9C},
+        {0x1F},
+        // Chunks of another type in indefinite strings
+        {0x5F, 0x61, 'a', 0xFF},
+        {0x7F, 0x41, 0x01, 0xFF},
+        // Non-string map keys, untagged values and unsupported simple values
+        {0xA1, 0x01, 0x02},
+        {0xA1, 0xC6, 0x61, 'a', 0x02},
+        {0xD8, 0x20, 0x01},
+        {0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0},
+        {0xD5, 0x41, 0x01},
+        {0xF7},
+        {0xF8, 0x20},
+    };
+    for (const auto &cbor : invalid) {
+        ENSURE(decodesAlike(cbor, &accepted));
+        ENSURE(!accepted);
+    }
+
+    // The error names the offending byte
+    error.clear();
+    ENSURE(DS::JsonValue::fromCbor(DS::JsonBinary(invalid[1].data(), invalid[1].size()), &error)
+               .isNull());
+    ENSURE(error.find("at byte 2") != std::string::npos);
+
+    // Data after the top level value is ignored
+    const std::vector<uint8_t> trailing{0x01, 0x02};
+    ENSURE(decodesAlike(trailing, &accepted));
+    ENSURE(accepted);
+    ENSURE(DS::JsonValue::fromCbor(DS::JsonBinary(trailing.data(), 2), &error).toInt() == 1);
+
+    // Deep nesting is bounded
+    auto nested = [](size_t depth) {
+        std::vector<uint8_t> cbor(depth, 0x81);
+        cbor.push_back(0x00);
+        return cbor;
+    };
+    ENSURE(decodesAlike(nested(1000), &accepted));
+    ENSURE(accepted);
+    auto tooDeep = nested(1100);
+    error.clear();
+    ENSURE(DS::JsonValue::fromCbor(DS::JsonBinary(tooDeep.data(), tooDeep.size()), &error).isNull());
+    ENSURE(!error.empty());
+
+    // Definite byte strings share the input's owner, indefinite ones are copied
+    std::weak_ptr<const void> weakOwner;
+    DS::JsonValue value;
+    {
+        DS::JsonBinary input(std::vector<uint8_t>{
+            0xA2, 0x61, 'a', 0x43, 0x01, 0x02, 0x03, //
+            0x61, 'b', 0x5F, 0x41, 0x04, 0xFF,       //
+        });
+        weakOwner = input.owner();
+        error.clear();
+        value = DS::JsonValue::fromCbor(input, &error);
+        ENSURE(error.empty());
+
+        auto a = value["a"].toBinaryView();
+        ENSURE(a.owner() == input.owner());
+        ENSURE(a.data() == input.data() + 4);
+        ENSURE(a.size() == 3);
+        auto b = value["b"].toBinaryView();
+        ENSURE(b.owner() != input.owner());
+        ENSURE((value["b"].toBinary() == std::vector<uint8_t>{4}));
+    }
+    ENSURE(!weakOwner.expired());
+    ENSURE((value["a"].toBinary() == std::vector<uint8_t>{1, 2, 3}));
+    value = DS::JsonValue();
+    ENSURE(weakOwner.expired());
+    return true;
+}
+
+bool JsonTest::testArena() {
+    DS::JsonValue value;
+    DS::JsonValue nestedValue;
+    std::vector<DS::JsonValue> items;
+    {
+        DS::JsonArena arena(4096);
+        value = DS::JsonValue(DS::JsonObject{
+            {"name", "mel"},
+            {"shape", DS::JsonArray{1, 2, 3}},
+        });
+        auto stats = arena.statistics();
+        ENSURE(stats.allocations > 0);
+        ENSURE(stats.blocks == 1);
+        ENSURE(stats.bytes > 0);
+
+        // Nested scopes take over until they end
+        {
+            DS::JsonArena nested(4096);
+            nestedValue = DS::JsonValue(DS::JsonArray{"a", DS::JsonArray{4, 5}});
+            ENSURE(nested.statistics().allocations > 0);
+            ENSURE(arena.statistics().allocations == stats.allocations);
+        }
+        auto inner = DS::JsonValue(DS::JsonArray{6});
+        ENSURE(arena.statistics().allocations > stats.allocations);
+        stats = arena.statistics();
+
+        // Other threads do not use the scope
+        std::thread([]() {
+            DS::JsonValue other(DS::JsonArray{7, 8});
+        }).join();
+        ENSURE(arena.statistics().allocations == stats.allocations);
+
+        // Further blocks are taken as needed
+        for (int i = 0; i < 1000; ++i) {
+            items.emplace_back(DS::JsonObject{{"index", i}});
+        }
+        ENSURE(arena.statistics().blocks > 1);
+    }
+
+    // The values outlive the scopes
+    ENSURE(value["name"].toString() == "mel");
+    ENSURE(value["shape"][2].toInt() == 3);
+    ENSURE(nestedValue[1][0].toInt() == 4);
+    ENSURE(items[999]["index"].toInt() == 999);
+
+    // and are freed on other threads, the blocks go with the last of them
+    bool ok = false;
+    std::thread([&ok, value = std::move(value), nestedValue = std::move(nestedValue)]() mutable {
+        ok = value["shape"][0].toInt() == 1 && nestedValue[0].toString() == "a";
+        value = DS::JsonValue();
+        nestedValue = DS::JsonValue();
+    }).join();
+    ENSURE(ok);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        std::vector<DS::JsonValue> part(items.begin() + i * 250, items.begin() + (i + 1) * 250);
+        threads.emplace_back([part = std::move(part)]() mutable {
+            part.clear();
+        });
+    }
+    items.clear();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return true;
+}
+
+// Reads every element of `text`, returns whether the reader ended without an error
+static bool readAll(const std::string &text, const std::string &key,
+                    std::vector<DS::JsonValue> &values, DS::Error &error) {
+    std::istringstream stream(text);
+    DS::JsonStreamReader reader(stream, key);
+    values.clear();
+    error = {};
+    DS::JsonValue value;
+    while (reader.readNext(value, &error)) {
+        values.push_back(value);
+    }
+    return error.ok() && reader.index() == values.size();
+}
+
+bool JsonTest::testStreamReader() {
+    std::vector<DS::JsonValue> values;
+    DS::Error error;
+
+    // A top level array
+    ENSURE(readAll(R"( [1, "a" ,{"b":[2, {}]}, [] ,null] )", {}, values, error));
+    ENSURE((values == std::vector<DS::JsonValue>{
+                          1,
+                          "a",
+                          DS::JsonObject{{"b", DS::JsonArray{2, DS::JsonObject()}}},
+                          DS::JsonArray(),
+                          DS::JsonValue(),
+                      }));
+    ENSURE(readAll("[]", {}, values, error));
+    ENSURE(values.empty());
+
+    // The array under a key of the top level object, other values are skipped unread
+    ENSURE(readAll(R"({"name":"x]","other":{"segments":[9]},"se\"g":[8],)"
+                   R"("segm\u0065nts":[{"v":1},{"v":2}],"tail":1})",
+                   "segments", values, error));
+    ENSURE((values == std::vector<DS::JsonValue>{
+                          DS::JsonObject{{"v", 1}},
+                          DS::JsonObject{{"v", 2}},
+                      }));
+    ENSURE(readAll(R"({"segments":[]})", "segments", values, error));
+    ENSURE(values.empty());
+
+    // Brackets, braces and commas in strings do not end the element
+    ENSURE(readAll(R"([{"s":"a]b[\"}{,"},"\\","\"]"])", {}, values, error));
+    ENSURE((values == std::vector<DS::JsonValue>{
+                          DS::JsonObject{{"s", "a]b[\"}{,"}},
+                          "\\",
+                          "\"]",
+                      }));
+
+    // Truncated and malformed input fails once the broken element is reached
+    for (const auto &[text, key, count] : std::vector<std::tuple<std::string, std::string, size_t>>{
+             {R"([1, {"a": [2)", "", 1},
+             {R"([1, "abc)", "", 1},
+             {R"([1, "abc\)", "", 1},
+             {R"([1, 2)", "", 2},
+             {R"([1 2])", "", 1},
+             {R"([1, tru])", "", 1},
+             {R"([1, ])", "", 1},
+             {R"([1, }])", "", 1},
+             {R"({"segments":[1, {"a)", "segments", 1},
+             {R"({"segments" [1]})", "segments", 0},
+             {R"({"name":"x", "other":[1]})", "segments", 0},
+             {R"({"name":"x)", "segments", 0},
+             {R"({})", "segments", 0},
+             {R"({"segments":[1]})", "", 0},
+             {R"("text")", "", 0},
+             {"", "", 0},
+         }) {
+        ENSURE(!readAll(text, key, values, error));
+        ENSURE(values.size() == count);
+        ENSURE(error.type() == DS::Error::InvalidFormat);
+        ENSURE(!error.message().empty());
+    }
+
+    // Every later call fails with the same error
+    {
+        std::istringstream stream("[1 2]");
+        DS::JsonStreamReader reader(stream);
+        DS::JsonValue value;
+        ENSURE(reader.readNext(value, &error));
+        ENSURE(!reader.readNext(value, &error));
+        auto message = error.message();
+        error = {};
+        ENSURE(!reader.readNext(value, &error));
+        ENSURE(error.message() == message);
+        ENSURE(reader.index() == 1);
+    }
+
+    // No input after the current element is consumed
+    {
+        std::istringstream stream(R"([{"a":[1]} , 2] tail)");
+        DS::JsonStreamReader reader(stream);
+        DS::JsonValue value;
+        ENSURE(reader.readNext(value, &error));
+        ENSURE(stream.tellg() == 10);
+        ENSURE(reader.readNext(value, &error));
+        ENSURE(value.toInt() == 2);
+        ENSURE(stream.tellg() == 14);
+        ENSURE(!reader.readNext(value, &error));
+        ENSURE(stream.tellg() == 15);
+        std::string rest;
+        std::getline(stream, rest);
+        ENSURE(rest == " tail");
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef TST_JSONVALUE_JSONTEST_H
+#define TST_JSONVALUE_JSONTEST_H
+
+#include <dsinfer/log.h>
+
+class JsonTest {
+public:
+    explicit JsonTest(dsinfer::Log::Category &logger);
+    bool testValueRef();
+    bool testBuilder();
+    bool testBinary();
+    bool testTypedArray();
+    bool testCbor();
+    bool testArena();
+    bool testStreamReader();
+protected:
+    dsinfer::Log::Category &logger;
+};
+
+#endif // TST_JSONVALUE_JSONTEST_H
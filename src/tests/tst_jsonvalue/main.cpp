@@ -0,0 +1,59 @@
+#include <cstdlib>
+
+#include <dsinfer/log.h>
+
+#include "jsontest.h"
+
+namespace DS = dsinfer;
+
+int main(int argc, char *argv[]) {
+    DS::Log::Category logger("jsontest");
+
+    bool ok = true;
+    JsonTest test(logger);
+
+    ok = test.testValueRef();
+    if (!ok) {
+        logger.critical("testValueRef - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testBuilder();
+    if (!ok) {
+        logger.critical("testBuilder - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testBinary();
+    if (!ok) {
+        logger.critical("testBinary - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testTypedArray();
+    if (!ok) {
+        logger.critical("testTypedArray - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testCbor();
+    if (!ok) {
+        logger.critical("testCbor - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testArena();
+    if (!ok) {
+        logger.critical("testArena - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testStreamReader();
+    if (!ok) {
+        logger.critical("testStreamReader - test failed");
+        return EXIT_FAILURE;
+    }
+
+    logger.info("All tests completed");
+    return EXIT_SUCCESS;
+}
@@ -35,6 +35,54 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    ok = test.testAsyncTasks(16);
+    if (!ok) {
+        ctx.logger.critical("testAsyncTasks - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testAsyncTasks(16, true);
+    if (!ok) {
+        ctx.logger.critical("testAsyncTasks (batching) - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testBucketing(200);
+    if (!ok) {
+        ctx.logger.critical("testBucketing - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testBucketingDurations(50);
+    if (!ok) {
+        ctx.logger.critical("testBucketingDurations - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testWarmup();
+    if (!ok) {
+        ctx.logger.critical("testWarmup - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testPreload();
+    if (!ok) {
+        ctx.logger.critical("testPreload - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testIdleCache();
+    if (!ok) {
+        ctx.logger.critical("testIdleCache - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testCacheDirectory();
+    if (!ok) {
+        ctx.logger.critical("testCacheDirectory - test failed");
+        return EXIT_FAILURE;
+    }
+
     ctx.logger.info("All tests completed");
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -1,8 +1,19 @@
 #include "onnxtest.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
 
 #include <stdcorelib/console.h>
 #include <stdcorelib/pimpl.h>
@@ -65,6 +76,80 @@ bool insertObjectHelper(DS::Log::Category &logger, DS::InferenceContext *context
     return true;
 }
 
+// Adds two vectors of `size` elements with vector_add.onnx opened by `session`
+static bool runVectorAdd(DS::Log::Category &logger, DS::InferenceDriver *driver,
+                         DS::InferenceSession *session, size_t size) {
+    std::vector<float> input1(size), input2(size);
+    for (size_t j = 0; j < size; ++j) {
+        input1[j] = float(j);
+        input2[j] = 1.0f;
+    }
+    DS::Error error;
+    std::shared_ptr<DS::InferenceContext> context(driver->createContext());
+    std::shared_ptr<DS::InferenceTask> task(driver->createTask());
+    bool ok = task->initialize({}, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxTask::initialize", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    DS::JsonValue input = DS::JsonObject{
+        {"session", session->id()},
+        {"context", context->id()},
+        {"input",
+         DS::JsonArray{
+             VU::toInputDataBytes("input1", input1.data(), size),
+             VU::toInputDataBytes("input2", input2.data(), size),
+         }},
+        {"output", DS::JsonArray{DS::JsonObject{{"name", "output"}, {"format", "bytes"}}}},
+    };
+    ok = task->start(input, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxTask::start", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    auto bytes = task->result()[0]["data"]["value"].toBinary();
+    if (bytes.size() != size * sizeof(float)) {
+        logger.critical("Run of length %1 returned %2 bytes", size, bytes.size());
+        return false;
+    }
+    std::vector<float> output(size);
+    std::memcpy(output.data(), bytes.data(), bytes.size());
+    for (size_t j = 0; j < size; ++j) {
+        if (output[j] != input1[j] + input2[j]) {
+            logger.critical("Run of length %1 returned a wrong result at %2", size, j);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where the driver caches fingerprints and optimized models, emptied by initDriver()
+static fs::path cacheDirectory() {
+    return fs::temp_directory_path() / "tst_onnxdriver-cache";
+}
+
+// The files in `dir` with `extension` and their contents
+static std::map<fs::path, std::string> readFiles(const fs::path &dir, const char *extension) {
+    std::map<fs::path, std::string> files;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        if (entry.path().extension() == extension) {
+            std::ifstream file(entry.path(), std::ios::binary);
+            files[entry.path()].assign(std::istreambuf_iterator<char>(file), {});
+        }
+    }
+    return files;
+}
+
+// Statistics of the idle session images of the driver
+static DS::JsonValue idleCacheStats(DS::InferenceDriver *driver) {
+    DS::JsonValue stats;
+    std::ignore = driver->executeCommand(DS::JsonObject{{"command", "idleCacheStats"}}, &stats);
+    return stats;
+}
+
 class OnnxTest::Impl {
 public:
     Context *ctx = nullptr;
@@ -91,11 +176,18 @@ bool OnnxTest::initDriver(const char *ep) {
     auto inferenceReg =
         impl.ctx->env.registry(DS::ContributeSpec::Inference)->cast<DS::InferenceRegistry>();
 
+    std::error_code ec;
+    fs::remove_all(cacheDirectory(), ec);
+
+    // The idle cache is small enough for testIdleCache to fill it
     DS::Error error;
     bool ok = inferenceReg->setup("onnx",
                                   DS::JsonObject({
-                                      {"ep",          ep },
-                                      {"deviceIndex", "0"},
+                                      {"ep",           ep                          },
+                                      {"deviceIndex",  "0"                         },
+                                      {"asyncWorkers", 4                           },
+                                      {"idleCacheMB",  1                           },
+                                      {"cacheDir",     cacheDirectory().u8string()},
     }),
                                   &error);
     ENSURE_OK_ERROR_CONSISTENT("OnnxDriver::initialize", ok, error);
@@ -355,3 +447,733 @@ bool OnnxTest::testTask() {
 
     return true;
 }
+
+bool OnnxTest::testAsyncTasks(int taskCount, bool batching) {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    DS::Error error;
+    // The first axis of vector_add is fixed to 1, the batched model takes [batch, n] inputs and
+    // a mask of the valid elements so that runs of different lengths are stacked, padded and
+    // cut back
+    std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+    bool ok = session->open(batching ? _TSTR("test_data/onnx_models/vector_add-batched.onnx")
+                                     : _TSTR("test_data/onnx_models/vector_add.onnx"),
+                            DS::JsonObject{{"useCpuHint", false}, {"batching", batching}},
+                            &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    std::shared_ptr<DS::InferenceContext> context(impl.driver->createContext());
+
+    // Every task adds its own vectors of its own length, so that a result delivered to the
+    // wrong task, or cut wrongly out of a batch, is detected
+    struct AsyncCase {
+        std::shared_ptr<DS::InferenceTask> task;
+        std::vector<float> expected;
+        bool finished = false;
+        DS::Error error;
+        DS::JsonValue result;
+    };
+    std::vector<AsyncCase> cases(taskCount);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int finishedCount = 0;
+
+    logger.info("Starting %1 asynchronous OnnxTasks%2", taskCount,
+                batching ? " on a batching session" : "");
+    for (int i = 0; i < taskCount; ++i) {
+        auto &c = cases[i];
+        size_t size = 20 + i;
+        std::vector<float> input1(size), input2(size);
+        c.expected.resize(size);
+        for (size_t j = 0; j < size; ++j) {
+            input1[j] = float(i) + float(j) * 0.5f;
+            input2[j] = float(i) * 0.25f - float(j);
+            c.expected[j] = input1[j] + input2[j];
+        }
+
+        c.task.reset(impl.driver->createTask());
+        ok = c.task->initialize({}, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxTask::initialize", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+
+        DS::JsonArray inputArr{
+            VU::toInputDataBytes("input1", input1.data(), size),
+            VU::toInputDataBytes("input2", input2.data(), size),
+        };
+        if (batching) {
+            std::unique_ptr<bool[]> mask(new bool[size]);
+            std::fill_n(mask.get(), size, true);
+            inputArr.push_back(VU::toInputDataBytes("mask", mask.get(), size));
+        }
+        DS::JsonArray outputArr{
+            DS::JsonObject{{"name", "output"}, {"format", "bytes"}},
+        };
+        DS::JsonValue input = DS::JsonObject{
+            {"session", session->id()},
+            {"context", context->id()},
+            {"input",   inputArr     },
+            {"output",  outputArr    },
+        };
+        ok = c.task->startAsync(
+            input,
+            [&, i](const DS::JsonValue &result, const DS::Error &taskError) {
+                std::lock_guard<std::mutex> lock(mutex);
+                cases[i].finished = true;
+                cases[i].error = taskError;
+                cases[i].result = result;
+                finishedCount++;
+                cv.notify_all();
+            },
+            &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxTask::startAsync", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(60),
+                         [&] { return finishedCount == taskCount; })) {
+            logger.critical("Only %1 of %2 asynchronous tasks finished", finishedCount, taskCount);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < taskCount; ++i) {
+        const auto &c = cases[i];
+        if (!c.error.ok()) {
+            logger.critical("Asynchronous task %1 failed: %2", i, c.error.what());
+            return false;
+        }
+        if (c.task->state() != DS::InferenceTask::Idle) {
+            logger.critical("Asynchronous task %1 is not idle after finishing", i);
+            return false;
+        }
+        auto size = c.expected.size();
+        auto bytes = c.result[0]["data"]["value"].toBinary();
+        if (bytes.size() != size * sizeof(float)) {
+            logger.critical("Asynchronous task %1 returned %2 bytes", i, bytes.size());
+            return false;
+        }
+        std::vector<float> output(size);
+        std::memcpy(output.data(), bytes.data(), bytes.size());
+        for (size_t j = 0; j < size; ++j) {
+            if (std::abs(output[j] - c.expected[j]) > 1e-5f) {
+                logger.critical("Asynchronous task %1 returned a wrong result: %2",
+                                i, VU::arrayStringify(output));
+                return false;
+            }
+        }
+    }
+    logger.info("All %1 asynchronous OnnxTasks returned their own results", taskCount);
+
+    ok = session->close(&error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    return true;
+}
+
+bool OnnxTest::testBucketing(int runCount) {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // The same random lengths are run without and with buckets
+    std::mt19937 generator(20240601);
+    std::uniform_int_distribution<size_t> lengthDistribution(100, 4000);
+    std::vector<size_t> lengths(runCount);
+    for (auto &length : lengths) {
+        length = lengthDistribution(generator);
+    }
+
+    DS::JsonObject bucketArgs{
+        {"axes",       DS::JsonArray{"N"}                         },
+        {"boundaries", DS::JsonArray{256, 512, 1024, 2048, 4096}},
+    };
+
+    for (bool bucketing : {false, true}) {
+        DS::Error error;
+        DS::JsonObject sessionArgs{{"useCpuHint", true}};
+        if (bucketing) {
+            sessionArgs["buckets"] = bucketArgs;
+        }
+        std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+        bool ok = session->open(_TSTR("test_data/onnx_models/vector_add.onnx"), sessionArgs,
+                                &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        std::shared_ptr<DS::InferenceContext> context(impl.driver->createContext());
+        std::shared_ptr<DS::InferenceTask> task(impl.driver->createTask());
+        ok = task->initialize({}, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxTask::initialize", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+
+        std::vector<double> latencies;
+        latencies.reserve(lengths.size());
+        for (auto length : lengths) {
+            std::vector<float> input1(length), input2(length);
+            for (size_t j = 0; j < length; ++j) {
+                input1[j] = float(j) * 0.5f;
+                input2[j] = 1.0f - float(j);
+            }
+            DS::JsonValue input = DS::JsonObject{
+                {"session", session->id()},
+                {"context", context->id()},
+                {"input",
+                 DS::JsonArray{
+                     VU::toInputDataBytes("input1", input1.data(), length),
+                     VU::toInputDataBytes("input2", input2.data(), length),
+                 }},
+                {"output", DS::JsonArray{DS::JsonObject{{"name", "output"}, {"format", "bytes"}}}},
+            };
+
+            auto start = std::chrono::steady_clock::now();
+            ok = task->start(input, &error);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            ENSURE_OK_ERROR_CONSISTENT("OnnxTask::start", ok, error);
+            if (!ok) {
+                logger.critical(error.what());
+                return false;
+            }
+            latencies.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+
+            // The padding must not be visible in the output
+            auto bytes = task->result()[0]["data"]["value"].toBinary();
+            if (bytes.size() != length * sizeof(float)) {
+                logger.critical("Run of length %1 returned %2 bytes", length, bytes.size());
+                return false;
+            }
+            std::vector<float> output(length);
+            std::memcpy(output.data(), bytes.data(), bytes.size());
+            for (size_t j = 0; j < length; ++j) {
+                if (std::abs(output[j] - (input1[j] + input2[j])) > 1e-4f) {
+                    logger.critical("Run of length %1 returned a wrong result at %2", length, j);
+                    return false;
+                }
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) {
+            return latencies[std::min(latencies.size() - 1, size_t(p * double(latencies.size())))];
+        };
+        logger.info("%1 runs of random lengths %2 buckets: p50 %3 ms, p99 %4 ms", runCount,
+                    bucketing ? "with" : "without", percentile(0.5), percentile(0.99));
+
+        ok = session->close(&error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OnnxTest::testBucketingDurations(int runCount) {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // The model repeats each token for its duration, its gather fails unless the durations add
+    // up to the padded frames
+    DS::Error error;
+    std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+    bool ok = session->open(
+        _TSTR("test_data/onnx_models/duration_expand.onnx"),
+        DS::JsonObject{
+            {"useCpuHint", true},
+            {"buckets", DS::JsonObject{{"boundaries", DS::JsonArray{8, 16, 32, 64}}}},
+        },
+        &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    std::shared_ptr<DS::InferenceContext> context(impl.driver->createContext());
+    std::shared_ptr<DS::InferenceTask> task(impl.driver->createTask());
+    ok = task->initialize({}, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxTask::initialize", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+
+    std::mt19937 generator(20240602);
+    std::uniform_int_distribution<int64_t> tokenDistribution(1, 12);
+    std::uniform_int_distribution<int64_t> durationDistribution(1, 6);
+    for (int i = 0; i < runCount; ++i) {
+        auto tokenCount = size_t(tokenDistribution(generator));
+        std::vector<float> tokens(tokenCount);
+        std::vector<int64_t> durations(tokenCount);
+        std::vector<float> expected;
+        for (size_t j = 0; j < tokenCount; ++j) {
+            tokens[j] = float(j + 1);
+            durations[j] = durationDistribution(generator);
+            expected.insert(expected.end(), size_t(durations[j]), tokens[j]);
+        }
+        auto frameCount = expected.size();
+        std::vector<float> f0(frameCount);
+        for (size_t j = 0; j < frameCount; ++j) {
+            f0[j] = float(j) * 100.0f;
+            expected[j] += f0[j];
+        }
+        DS::JsonValue input = DS::JsonObject{
+            {"session", session->id()},
+            {"context", context->id()},
+            {"input",
+             DS::JsonArray{
+                 VU::toInputDataBytes("tokens", tokens.data(), tokenCount),
+                 VU::toInputDataBytes("durations", durations.data(), tokenCount),
+                 VU::toInputDataBytes("f0", f0.data(), frameCount),
+             }},
+            {"output", DS::JsonArray{DS::JsonObject{{"name", "mel"}, {"format", "bytes"}}}},
+        };
+        ok = task->start(input, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxTask::start", ok, error);
+        if (!ok) {
+            logger.critical("Run of %1 tokens and %2 frames failed: %3", tokenCount, frameCount,
+                            error.what());
+            return false;
+        }
+
+        auto bytes = task->result()[0]["data"]["value"].toBinary();
+        if (bytes.size() != frameCount * sizeof(float)) {
+            logger.critical("Run of %1 frames returned %2 bytes", frameCount, bytes.size());
+            return false;
+        }
+        std::vector<float> output(frameCount);
+        std::memcpy(output.data(), bytes.data(), bytes.size());
+        if (output != expected) {
+            logger.critical("Run of %1 tokens returned a wrong result: %2", tokenCount,
+                            VU::arrayStringify(output));
+            return false;
+        }
+    }
+
+    ok = session->close(&error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    return true;
+}
+
+bool OnnxTest::testWarmup() {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // Warmed up before open returns, then run for real
+    DS::Error error;
+    std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+    bool ok = session->open(_TSTR("test_data/onnx_models/vector_add.onnx"),
+                            DS::JsonObject{
+                                {"useCpuHint", true},
+                                {"warmup", DS::JsonObject{
+                                               {"runs", 2},
+                                               {"dims", DS::JsonObject{{"N", 64}}},
+                                           }},
+    },
+                            &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+
+    constexpr size_t size = 64;
+    std::vector<float> input1(size, 1.0f), input2(size, 2.0f);
+    std::shared_ptr<DS::InferenceContext> context(impl.driver->createContext());
+    std::shared_ptr<DS::InferenceTask> task(impl.driver->createTask());
+    ok = task->initialize({}, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxTask::initialize", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    DS::JsonValue input = DS::JsonObject{
+        {"session", session->id()},
+        {"context", context->id()},
+        {"input",
+         DS::JsonArray{
+             VU::toInputDataBytes("input1", input1.data(), size),
+             VU::toInputDataBytes("input2", input2.data(), size),
+         }},
+        {"output", DS::JsonArray{DS::JsonObject{{"name", "output"}, {"format", "bytes"}}}},
+    };
+    ok = task->start(input, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxTask::start", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    ok = session->close(&error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+
+    // Closing does not wait for a warm-up still running in the background. The image is
+    // created with other hints, so that it is not the idle one warmed up above
+    ok = session->open(_TSTR("test_data/onnx_models/vector_add.onnx"),
+                       DS::JsonObject{
+                           {"useCpuHint", false},
+                           {"batching", true},
+                           {"warmup", DS::JsonObject{
+                                          {"runs", 100},
+                                          {"background", true},
+                                          {"dims", DS::JsonObject{{"N", 1 << 20}}},
+                                      }},
+    },
+                       &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    ok = session->close(&error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+    return true;
+}
+
+bool OnnxTest::testPreload() {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // Args that no earlier test opened the models with, so that nothing is idle before
+    DS::JsonObject args{
+        {"sessionOptions", DS::JsonObject{{"memPattern", false}}},
+    };
+    std::vector<fs::path> paths{
+        _TSTR("test_data/onnx_models/vector_rss_sigmoid.onnx"),
+        _TSTR("test_data/onnx_models/vector_add-duplicate.onnx"),
+        _TSTR("test_data/onnx_models/not_exist.onnx"),
+    };
+
+    auto stats0 = idleCacheStats(impl.driver);
+    if (!stats0.isObject()) {
+        logger.critical("OnnxDriver does not report idle cache statistics");
+        return false;
+    }
+    const auto idleOrEvicted = [](const DS::JsonValue &stats) {
+        return stats["images"].toInt64() + stats["evictions"].toInt64();
+    };
+
+    // Invalid args are rejected at once, a missing model only fails in the background
+    DS::Error error;
+    bool ok = impl.driver->preload(paths, DS::JsonValue(1), &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxDriver::preload", ok, error);
+    if (ok) {
+        logger.critical("OnnxDriver::preload accepted invalid args");
+        return false;
+    }
+    error = {};
+    ok = impl.driver->preload(paths, args, &error);
+    ENSURE_OK_ERROR_CONSISTENT("OnnxDriver::preload", ok, error);
+    if (!ok) {
+        logger.critical(error.what());
+        return false;
+    }
+
+    // The two existing models end up idle, the missing one adds nothing
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    auto stats = idleCacheStats(impl.driver);
+    while (idleOrEvicted(stats) < idleOrEvicted(stats0) + 2) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            logger.critical("Preloaded images are not idle: %1", stats.toJson());
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stats = idleCacheStats(impl.driver);
+    }
+
+    // Opening with the same args attaches to the preloaded images
+    for (size_t i = 0; i < 2; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+        ok = session->open(paths[i], args, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        logger.info("Opened preloaded %1 in %2 ms", paths[i].filename(), elapsed.count());
+        auto opened = idleCacheStats(impl.driver);
+        if (opened["hits"].toInt64() != stats["hits"].toInt64() + 1) {
+            logger.critical("Opening %1 did not take the preloaded image: %2",
+                            paths[i].filename(), opened.toJson());
+            return false;
+        }
+        stats = opened;
+        ok = session->close(&error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OnnxTest::testIdleCache() {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // Args that no earlier test opened the model with
+    const fs::path modelPath(_TSTR("test_data/onnx_models/vector_add.onnx"));
+    DS::JsonObject args{
+        {"useCpuHint",     true                                      },
+        {"sessionOptions", DS::JsonObject{{"memPattern", false}}},
+    };
+    auto openRunClose = [&](size_t size) {
+        DS::Error error;
+        std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+        bool ok = session->open(modelPath, args, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        if (!runVectorAdd(logger, impl.driver, session.get(), size)) {
+            return false;
+        }
+        ok = session->close(&error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        return true;
+    };
+
+    auto stats0 = idleCacheStats(impl.driver);
+    if (!stats0.isObject()) {
+        logger.critical("OnnxDriver does not report idle cache statistics");
+        return false;
+    }
+
+    // A closed session keeps its image idle, opening the model again takes it back
+    if (!openRunClose(64)) {
+        return false;
+    }
+    auto stats1 = idleCacheStats(impl.driver);
+    if (stats1["images"].toInt() != stats0["images"].toInt() + 1 ||
+        stats1["bytes"].toInt64() <= stats0["bytes"].toInt64()) {
+        logger.critical("Closed session image is not idle: %1", stats1.toJson());
+        return false;
+    }
+    if (!openRunClose(64)) {
+        return false;
+    }
+    auto stats2 = idleCacheStats(impl.driver);
+    if (stats2["hits"].toInt64() != stats1["hits"].toInt64() + 1 ||
+        stats2["images"].toInt() != stats1["images"].toInt()) {
+        logger.critical("Reopened session did not reuse the idle image: %1", stats2.toJson());
+        return false;
+    }
+
+    // A run of several megabytes leaves the image beyond the budget of 1 MB, it is evicted with
+    // every older idle image
+    if (!openRunClose(size_t(1) << 18)) {
+        return false;
+    }
+    auto stats3 = idleCacheStats(impl.driver);
+    if (stats3["hits"].toInt64() != stats2["hits"].toInt64() + 1 ||
+        stats3["evictions"].toInt64() < stats2["evictions"].toInt64() + stats2["images"].toInt() ||
+        stats3["images"].toInt() != 0 || stats3["bytes"].toInt64() != 0) {
+        logger.critical("Idle images over budget were not evicted: %1", stats3.toJson());
+        return false;
+    }
+
+    // Nothing is left to reuse
+    if (!openRunClose(64)) {
+        return false;
+    }
+    auto stats4 = idleCacheStats(impl.driver);
+    if (stats4["hits"].toInt64() != stats3["hits"].toInt64() || stats4["images"].toInt() != 1) {
+        logger.critical("Evicted image was reused: %1", stats4.toJson());
+        return false;
+    }
+    logger.info("Idle cache statistics: %1", stats4.toJson());
+    return true;
+}
+
+bool OnnxTest::testCacheDirectory() {
+    __stdc_impl_t;
+    ENSURE_CTX(impl.ctx);
+    auto &logger = impl.ctx->logger;
+
+    if (!impl.driver) {
+        logger.critical("Onnx driver plugin is not loaded!");
+        return false;
+    }
+
+    // A copy of the model, whose modification time can be changed
+    std::error_code ec;
+    auto modelDir = fs::temp_directory_path() / "tst_onnxdriver-models";
+    auto modelPath = modelDir / "vector_add.onnx";
+    fs::create_directories(modelDir, ec);
+    if (!fs::copy_file(_TSTR("test_data/onnx_models/vector_add.onnx"), modelPath,
+                       fs::copy_options::overwrite_existing, ec)) {
+        logger.critical("Failed to copy the model to %1: %2", modelDir, ec.message());
+        return false;
+    }
+
+    // The run of several megabytes evicts the image when the session closes, so that every
+    // open creates it again
+    DS::JsonObject args{
+        {"useCpuHint",     true                                    },
+        {"sessionOptions", DS::JsonObject{{"cpuArena", false}}},
+    };
+    auto openRunClose = [&]() {
+        DS::Error error;
+        std::shared_ptr<DS::InferenceSession> session(impl.driver->createSession());
+        bool ok = session->open(modelPath, args, &error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::open", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        if (!runVectorAdd(logger, impl.driver, session.get(), size_t(1) << 18)) {
+            return false;
+        }
+        ok = session->close(&error);
+        ENSURE_OK_ERROR_CONSISTENT("OnnxSession::close", ok, error);
+        if (!ok) {
+            logger.critical(error.what());
+            return false;
+        }
+        return true;
+    };
+
+    // The first open hashes the model and records its fingerprint, and saves the optimized
+    // model, whose key includes the session options that no other test uses
+    auto fingerprintDir = cacheDirectory() / "fingerprints";
+    auto optimizedDir = cacheDirectory() / "models";
+    auto fingerprints0 = readFiles(fingerprintDir, ".fp");
+    auto optimized0 = readFiles(optimizedDir, ".ort");
+    if (!openRunClose()) {
+        return false;
+    }
+    auto fingerprints1 = readFiles(fingerprintDir, ".fp");
+    if (fingerprints1.size() != fingerprints0.size() + 1) {
+        logger.critical("No fingerprint was written to %1", fingerprintDir);
+        return false;
+    }
+    auto optimized1 = readFiles(optimizedDir, ".ort");
+    if (optimized1.size() != optimized0.size() + 1) {
+        logger.critical("No optimized model was written to %1", optimizedDir);
+        return false;
+    }
+    fs::path fingerprintPath;
+    for (const auto &[path, content] : fingerprints1) {
+        if (fingerprints0.count(path) == 0) {
+            fingerprintPath = path;
+        }
+    }
+    fs::path optimizedPath;
+    for (const auto &[path, content] : optimized1) {
+        if (optimized0.count(path) == 0) {
+            optimizedPath = path;
+        }
+    }
+    auto fingerprintTime = fs::last_write_time(fingerprintPath, ec);
+    auto optimizedTime = fs::last_write_time(optimizedPath, ec);
+
+    // Opening it again reads both instead of replacing them
+    if (!openRunClose()) {
+        return false;
+    }
+    if (readFiles(fingerprintDir, ".fp") != fingerprints1 ||
+        fs::last_write_time(fingerprintPath, ec) != fingerprintTime) {
+        logger.critical("The cached fingerprint of %1 was not used", modelPath);
+        return false;
+    }
+    if (readFiles(optimizedDir, ".ort") != optimized1 ||
+        fs::last_write_time(optimizedPath, ec) != optimizedTime) {
+        logger.critical("The cached optimized model of %1 was not used", modelPath);
+        return false;
+    }
+
+    // A changed modification time makes it hash the model again, the unchanged content still
+    // has the same optimized model
+    fs::last_write_time(modelPath, fs::last_write_time(modelPath, ec) + std::chrono::seconds(10),
+                        ec);
+    if (!openRunClose()) {
+        return false;
+    }
+    auto fingerprints2 = readFiles(fingerprintDir, ".fp");
+    if (fingerprints2.size() != fingerprints1.size() ||
+        fingerprints2[fingerprintPath] == fingerprints1[fingerprintPath]) {
+        logger.critical("The fingerprint of the modified %1 was not replaced", modelPath);
+        return false;
+    }
+    if (fs::last_write_time(optimizedPath, ec) != optimizedTime) {
+        logger.critical("The optimized model of %1 was saved again", modelPath);
+        return false;
+    }
+
+    fs::remove_all(modelDir, ec);
+    return true;
+}
@@ -13,6 +13,13 @@ public:
     bool initDriver();
     bool initDriver(const char *ep);
     bool testTask();
+    bool testAsyncTasks(int taskCount, bool batching = false);
+    bool testBucketing(int runCount);
+    bool testBucketingDurations(int runCount);
+    bool testWarmup();
+    bool testPreload();
+    bool testIdleCache();
+    bool testCacheDirectory();
 protected:
     class Impl;
     std::unique_ptr<Impl> _impl;
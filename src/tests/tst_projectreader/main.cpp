@@ -0,0 +1,29 @@
+#include <cstdlib>
+
+#include <dsinfer/log.h>
+
+#include "projecttest.h"
+
+namespace DS = dsinfer;
+
+int main(int argc, char *argv[]) {
+    DS::Log::Category logger("projecttest");
+
+    bool ok = true;
+    ProjectTest test(logger);
+
+    ok = test.testReadSegments();
+    if (!ok) {
+        logger.critical("testReadSegments - test failed");
+        return EXIT_FAILURE;
+    }
+
+    ok = test.testReadErrors();
+    if (!ok) {
+        logger.critical("testReadErrors - test failed");
+        return EXIT_FAILURE;
+    }
+
+    logger.info("All tests completed");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "projecttest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "project_reader.h"
+
+#define ENSURE(cond)                                                                               \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            logger.critical("%1:%2: check failed: %3", __FILE__, __LINE__, #cond);                 \
+            return false;                                                                          \
+        }                                                                                          \
+    } while (false)
+
+namespace DS = dsinfer;
+
+// A segment of one word whose phoneme token is `token`
+static std::string segmentText(int context, const std::string &token) {
+    return R"({"context":)" + std::to_string(context) + R"(,"words":[{"phones":[{"token":")" +
+           token + R"(","start":0.0}],"notes":[{"key":60,"duration":0.5,"is_rest":false}]}],)" +
+           R"("parameters":[{"tag":"pitch","dynamic":true,"interval":0.01,"values":[60,61]}]})";
+}
+
+ProjectTest::ProjectTest(DS::Log::Category &logger) : logger(logger) {
+}
+
+bool ProjectTest::testReadSegments() {
+    const auto segment0 = segmentText(0, "a]");
+    const auto segment1 = segmentText(1, "b\\\"");
+    for (const auto &text : {
+             "[" + segment0 + ", " + segment1 + "]",
+             R"({"version":"2.3","name":"{x","segments":[)" + segment0 + "," + segment1 +
+                 R"(],"tail":[1]})",
+         }) {
+        std::istringstream stream(text);
+        DS::dsinterp::ProjectReader reader(stream);
+        std::vector<DS::dsinterp::Segment> segments;
+        for (auto &segment : reader) {
+            segments.push_back(std::move(segment));
+        }
+        ENSURE(reader.error().ok());
+        ENSURE(segments.size() == 2);
+        ENSURE(segments[0].context == 0);
+        ENSURE(segments[0].words.size() == 1);
+        ENSURE(segments[0].words[0].phones[0].token == "a]");
+        ENSURE(segments[0].words[0].notes[0].key == 60);
+        ENSURE(segments[0].words[0].duration() == 0.5);
+        ENSURE(segments[0].parameters.at("pitch").sample_curve.samples ==
+               (std::vector<double>{60, 61}));
+        ENSURE(segments[1].context == 1);
+        ENSURE(segments[1].words[0].phones[0].token == "b\"");
+    }
+
+    // Segments are decoded as they are reached, the input after them is left unread
+    {
+        std::istringstream stream("[" + segment0 + ", " + segment1 + "] tail");
+        DS::dsinterp::ProjectReader reader(stream);
+        DS::dsinterp::Segment segment;
+        DS::Error error;
+        ENSURE(reader.readNext(segment, &error));
+        ENSURE(segment.context == 0);
+        ENSURE(stream.tellg() == std::streamoff(1 + segment0.size()));
+        ENSURE(reader.readNext(segment, &error));
+        ENSURE(segment.context == 1);
+        ENSURE(!reader.readNext(segment, &error));
+        ENSURE(error.ok());
+        std::string rest;
+        std::getline(stream, rest);
+        ENSURE(rest == " tail");
+    }
+
+    // An empty project has no segments
+    {
+        std::istringstream stream(R"({"segments":[]})");
+        DS::dsinterp::ProjectReader reader(stream);
+        ENSURE(reader.begin() == reader.end());
+        ENSURE(reader.error().ok());
+    }
+    return true;
+}
+
+bool ProjectTest::testReadErrors() {
+    const auto segment0 = segmentText(0, "a");
+
+    // Iteration stops at the first invalid segment, the ones before it are delivered
+    for (const auto &[text, message] : std::vector<std::pair<std::string, std::string>>{
+             {"[" + segment0 + R"(, {"words":1}, )" + segment0 + "]", "[segment 1]"},
+             {"[" + segment0 + R"(, {"words":[{"phones":[]}]}])", "[segment 1]"},
+             {"[" + segment0 + R"(, {"words":[)", "element 1"},
+             {"[" + segment0 + ", " + segment0.substr(0, 40), "element 1"},
+             {"[" + segment0 + " " + segment0 + "]", "element 1"},
+         }) {
+        std::istringstream stream(text);
+        DS::dsinterp::ProjectReader reader(stream);
+        size_t count = 0;
+        for (const auto &segment : reader) {
+            ENSURE(segment.words.size() == 1);
+            count++;
+        }
+        ENSURE(count == 1);
+        ENSURE(reader.error().type() == DS::Error::InvalidFormat);
+        ENSURE(reader.error().message().find(message) != std::string::npos);
+    }
+
+    // Documents that are not projects fail before the first segment
+    for (const auto &text : {
+             std::string(),
+             std::string(R"({"name":"x"})"),
+             std::string(R"({"segments":{}})"),
+             std::string("1"),
+         }) {
+        std::istringstream stream(text);
+        DS::dsinterp::ProjectReader reader(stream);
+        DS::dsinterp::Segment segment;
+        DS::Error error;
+        ENSURE(!reader.readNext(segment, &error));
+        ENSURE(error.type() == DS::Error::InvalidFormat);
+    }
+    return true;
+}
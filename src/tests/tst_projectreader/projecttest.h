@@ -0,0 +1,15 @@
+#ifndef TST_PROJECTREADER_PROJECTTEST_H
+#define TST_PROJECTREADER_PROJECTTEST_H
+
+#include <dsinfer/log.h>
+
+class ProjectTest {
+public:
+    explicit ProjectTest(dsinfer::Log::Category &logger);
+    bool testReadSegments();
+    bool testReadErrors();
+protected:
+    dsinfer::Log::Category &logger;
+};
+
+#endif // TST_PROJECTREADER_PROJECTTEST_H